@@ -17,7 +17,8 @@ void App::run() {
     initWindow();
     initVulkan();
     m_pCamera = new Camera();
-    mainLoop();
+    if (isBenchTextureSets) m_pGraphicMain->benchTextureSets();
+    else                    mainLoop();
     cleanup();
 }
 
@@ -27,10 +28,15 @@ void App::cleanup() {
     m_pComputeInterference->cleanup();
     m_pWindow->cleanup();
     m_pRenderer->cleanUp();
+    m_pThreadPool->cleanup();
 }
 
 void App::initVulkan() {
     LOG("App::initVulkan");
+    m_pThreadPool = new ThreadPool();
+    m_pThreadPool->create();
+    System::Instance().m_pThreadPool = m_pThreadPool;
+    
     m_pRenderer = new Renderer();
     System::Instance().m_pRenderer = m_pRenderer;
     
@@ -45,15 +51,25 @@ void App::initVulkan() {
     m_pRenderer->createLogicalDevice();
     m_pRenderer->createDeviceQueue();
     m_pRenderer->createCommander();
+    m_pRenderer->createAllocator();
+    m_pRenderer->createUploader();
+    m_pRenderer->createDeletionQueue();
+    m_pRenderer->createDownsampler();
+    m_pRenderer->createSamplerCache();
+    m_pRenderer->createTextureTable();
 
     createPipelineCompute();
     createPipelineGraphic();
     createGUI();
+    m_pRenderer->getAllocator()->printStats();
 }
 
 void App::createGUI() {
     m_pSettings = new Settings();
     m_pSettings->setWindow(m_pWindow);
+    m_pSettings->setTextureSets(m_pGraphicMain->m_pTextureSets);
+    m_pSettings->TextureSet = m_pGraphicMain->m_textureSet;
+    m_pSettings->TextureSetLocked = m_pGraphicMain->m_pVirtualTexture != nullptr;
     m_pSettings->initGUI(m_pGraphicMain->m_pSwapchain->m_renderPass);
     System::Instance().m_pSettings = m_pSettings;
 }
@@ -84,10 +100,17 @@ void App::createPipelineCompute() {
 void App::createPipelineGraphic() {
     LOG("App::createPipelineGraphic");
     
+    // The bindless variant reads its textures from the texture table by material ID, the virtual one
+    // looks its albedo up through a page table
+    const char* fragShader = System::TextureTable() != nullptr ? "shaders/main1d_bindless.frag.spv" :
+                             VirtualTexture::IsSupported()     ? "shaders/main1d_virtual.frag.spv"  :
+                                                                 "shaders/main1d.frag.spv";
+    // The vertex shader variant decodes the normals of the layout meshes are packed in
+    std::string vertShader = std::string("shaders/main1d") + MeshVertexLayout::GetInfo().shaderSuffix + ".vert.spv";
     GraphicMain* graphic1 = new GraphicMain();
     graphic1->setShaders({
-        new Shader("shaders/main1d.vert.spv", VK_SHADER_STAGE_VERTEX_BIT),
-        new Shader("shaders/main1d.frag.spv", VK_SHADER_STAGE_FRAGMENT_BIT)
+        new Shader(vertShader, VK_SHADER_STAGE_VERTEX_BIT),
+        new Shader(fragShader, VK_SHADER_STAGE_FRAGMENT_BIT)
     });
     graphic1->setShaderCubemap({
         new Shader("shaders/skybox.vert.spv", VK_SHADER_STAGE_VERTEX_BIT),
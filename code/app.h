@@ -8,6 +8,7 @@
 #include "camera/camera.h"
 #include "mesh/mesh.h"
 
+#include "thread_pool.h"
 #include "renderer/renderer.h"
 #include "renderer/commander.h"
 #include "renderer/swapchain.h"
@@ -27,6 +28,8 @@ public:
     const char* SHADER_COMPILER_PATH = "shaders/compile.sh";
     
     void run();
+    // Loads the texture set catalogue, prints its timings and quits instead of opening the main loop
+    bool isBenchTextureSets = false;
     float duration1 = 0;
     float duration2 = 0;
 
@@ -35,6 +38,7 @@ private:
     Settings* m_pSettings;
     Camera* m_pCamera;
     Renderer* m_pRenderer;
+    ThreadPool* m_pThreadPool;
     GraphicMain* m_pGraphicMain;
     ComputeInterference* m_pComputeInterference;
     
@@ -27,6 +27,12 @@
 #define IS_DEBUG true
 #endif
 
+// Opt-in: one update-after-bind texture array for every draw, on devices with VK_EXT_descriptor_indexing
+#define USE_BINDLESS_TEXTURES false
+
+// Opt-in: the albedo map streams as a virtual texture, paged in from a tiled file as the GPU asks for pages
+#define USE_VIRTUAL_TEXTURE false
+
 #define USE_VAR(v) {}
 #define USE_FUNC(f) {}
 
@@ -75,6 +75,11 @@ std::vector<char> ReadBinaryFile(const std::string filename) {
     return buffer;
 }
 
+bool FileExists(const std::string filename) {
+    std::ifstream file(filename);
+    return file.good();
+}
+
 unsigned char* LoadImage(const std::string filename, int* width, int* height, int* channels) {
     unsigned char *data = stbi_load(filename.c_str(), width, height, channels, STBI_rgb_alpha);
     if (data) return data;
@@ -89,6 +94,10 @@ float* LoadHDR(const std::string filename, int* width, int* height, int* channel
     return nullptr;
 }
 
+void FreeImage(void* data) {
+    stbi_image_free(data);
+}
+
 uint32_t MaxMipLevel(int width, int height) {
     return UINT32(std::floor(std::log2(std::max(width, height)))) + 1;
 }
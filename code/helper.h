@@ -13,7 +13,9 @@ VkFormat   ChooseDepthFormat(VkPhysicalDevice physicalDevice);
 VkExtent2D ChooseSwapExtent(const VkSurfaceCapabilitiesKHR& capabilities, Size<int> size);
 
 std::vector<char> ReadBinaryFile (const std::string filename);
+bool FileExists(const std::string filename);
 unsigned char* LoadImage(const std::string filename, int* width, int* height, int* channels);
 float* LoadHDR(const std::string filename, int* width, int* height, int* channels);
+void   FreeImage(void* data);
 
 uint32_t MaxMipLevel(int width, int height);
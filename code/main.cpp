@@ -1,7 +1,8 @@
 #include "app.h"
 
-int main() {
+int main(int argc, char* argv[]) {
     App app;
+    app.isBenchTextureSets = argc > 1 && std::string(argv[1]) == "--bench-texture-sets";
 
     try {
         app.run();
@@ -5,14 +5,16 @@
 #define GLM_FORCE_DEPTH_ZERO_TO_ONE
 #define GLM_ENABLE_EXPERIMENTAL
 
-#include <glm/gtx/hash.hpp>
 #include <glm/gtc/matrix_transform.hpp>
 
-#include <unordered_map>
-
-#include "../libraries/tiny_obj_loader/tiny_obj_loader.h"
+#include <algorithm>
+#include <cstring>
 
 #include "mesh.h"
+#include "mesh_cache.h"
+#include "mesh_optimizer.h"
+#include "obj_parser.h"
+#include "vertex_weld.h"
 
 #include "../system.h"
 
@@ -114,121 +116,195 @@ void Mesh::createSphere(int wedge, int segment) {
             m_indices.insert(m_indices.end(), { w1+d, w2+j, w2+d });
         }
     }
+    optimize();
 }
 
 void Mesh::loadModel(const char* filename) {
-    tinyobj::attrib_t attrib;
-    std::vector<tinyobj::shape_t> shapes;
-    std::vector<tinyobj::material_t> materials;
-    std::unordered_map<size_t, uint32_t> uniqueVertices;
-    std::string warn, err;
-    
-    if (!tinyobj::LoadObj(&attrib, &shapes, &materials, &warn, &err, filename)) {
-        throw std::runtime_error(warn + err);
-    }
+    uint64_t sourceHash = 0, sourceSize = 0;
+    std::string cachePath = GetMeshCachePath(filename, &sourceHash, &sourceSize);
     
-    for (const auto& shape : shapes) {
-        for (const auto& index : shape.mesh.indices) {
-            glm::vec3 position = glm::vec3(
-                attrib.vertices[3 * index.vertex_index + 0],
-                attrib.vertices[3 * index.vertex_index + 1],
-                attrib.vertices[3 * index.vertex_index + 2]
-            );
-            
-            glm::vec3 normal = glm::vec3(
-                 attrib.normals[3 * index.normal_index + 0],
-                 attrib.normals[3 * index.normal_index + 1],
-                 attrib.normals[3 * index.normal_index + 2]
-            );
-            
-            glm::vec2 texCoord = glm::vec2(
-                attrib.texcoords[2 * index.texcoord_index + 0],
-                1.0f - attrib.texcoords[2 * index.texcoord_index + 1]
-            );
-
-            size_t hash = std::hash<glm::vec3>()(position) ^
-                         (std::hash<glm::vec2>()(texCoord) << 1);
-            if (uniqueVertices.count(hash) == 0) {
-                uniqueVertices[hash] = UINT32(m_positions.size());
-                m_positions.emplace_back(glm::vec3(position.x, position.y, position.z));
-                m_normals  .emplace_back(glm::vec3(normal.x, normal.y, normal.z));
-                m_texCoords.emplace_back(glm::vec2(texCoord.x, texCoord.y));
-            }
-
-            m_indices.push_back(uniqueVertices[hash]);
+    CachedMesh cached;
+    if (MapCachedMesh(cachePath, sourceHash, sourceSize, &cached)) {
+        // A corrupt blob must not turn into out of bounds vertex fetches, so it is parsed again instead
+        std::vector<uint32_t> indices(cached.indexCount);
+        memcpy(indices.data(), cached.indices, cached.indexCount * sizeof(uint32_t));
+        uint32_t maxIndex = 0;
+        for (uint32_t index : indices) maxIndex = std::max(maxIndex, index);
+        bool isValid = cached.vertexStride == sizeof(Vertex) && (indices.empty() || maxIndex < cached.vertexCount);
+        if (isValid) {
+            unpackVertices(cached.vertices, cached.vertexCount);
+            m_indices   = indices;
+            m_boundsMin = cached.boundsMin;
+            m_boundsMax = cached.boundsMax;
         }
+        UnmapCachedMesh(&cached);
+        if (isValid) return;
+    }
+    
+    parseModel(filename);
+    optimize();
+    glm::vec3 boundsMin = glm::vec3( INFINITY);
+    glm::vec3 boundsMax = glm::vec3(-INFINITY);
+    for (const glm::vec3& position : m_positions) {
+        boundsMin = glm::min(boundsMin, position);
+        boundsMax = glm::max(boundsMax, position);
     }
+    if (m_positions.empty()) boundsMin = boundsMax = glm::vec3(0.f);
+    m_boundsMin = boundsMin;
+    m_boundsMax = boundsMax;
+    
+    std::vector<char> vertices(m_positions.size() * sizeof(Vertex));
+    FloatVertexLayout::Pack(getStreams(), VertexDequantize(), vertices.data());
+    WriteCachedMesh(cachePath, sourceHash, sourceSize, vertices.data(), UINT32(m_positions.size()), sizeof(Vertex),
+                    m_indices, boundsMin, boundsMax);
 }
 
-void Mesh::cmdCreateVertexBuffer() {
-    VkDeviceSize bufferSize = sizeofPositions() + sizeofNormals() + sizeofTexCoords();
-    
-    Buffer* tempBuffer = new Buffer();
-    tempBuffer->setup(bufferSize, VK_BUFFER_USAGE_TRANSFER_SRC_BIT);
-    tempBuffer->create();
-    
-    uint32_t shift = 0;
-    for (int i = 0; i < m_positions.size(); i++) {
-        tempBuffer->fillBuffer(&m_positions[i], sizeofPosition, shift);
-        shift += sizeofPosition;
-        tempBuffer->fillBuffer(&m_normals  [i], sizeofNormal  , shift);
-        shift += sizeofNormal;
-        tempBuffer->fillBuffer(&m_texCoords[i], sizeofTexCoord, shift);
-        shift += sizeofTexCoord;
+// Corners weld on their attribute indices first, and only the unique ones become vertices for the exact weld.
+// Both keep every vertex's first appearance in order
+void Mesh::parseModel(const char* filename) {
+    ObjModel model;
+    ParseObj(filename, &model, System::ThreadPool());
+    
+    uint32_t cornerCount = UINT32(model.corners.size());
+    std::vector<uint32_t> cornerIndices(cornerCount);
+    std::vector<uint32_t> uniqueCorners = WeldVerticesParallel(System::ThreadPool(), model.corners.data(), cornerCount,
+                                                               sizeof(ObjCorner), cornerIndices.data());
+    
+    uint32_t vertexCount = UINT32(uniqueCorners.size());
+    std::vector<Vertex> vertices(vertexCount);
+    for (uint32_t i = 0; i < vertexCount; i++) {
+        const ObjCorner& corner = model.corners[uniqueCorners[i]];
+        Vertex& vertex  = vertices[i];
+        vertex.position = model.positions[corner.position];
+        vertex.normal   = corner.normal   >= 0 ? model.normals[corner.normal] : glm::vec3(0.f);
+        vertex.texCoord = corner.texCoord >= 0 ? glm::vec2(model.texCoords[corner.texCoord].x,
+                                                           1.0f - model.texCoords[corner.texCoord].y) : glm::vec2(0.f);
+    }
+    std::vector<uint32_t> vertexIndices(vertexCount);
+    std::vector<uint32_t> uniqueVertices = WeldVerticesParallel(System::ThreadPool(), vertices.data(), vertexCount,
+                                                                sizeof(Vertex), vertexIndices.data());
+    
+    if (IS_DEBUG) {
+        uint32_t mismatch = VerifyWeld(model.corners.data(), cornerCount, sizeof(ObjCorner), cornerIndices.data(),
+                                       uniqueCorners);
+        CHECK_BOOL((mismatch == cornerCount), "corner weld changed a corner!");
+        mismatch = VerifyWeld(vertices.data(), vertexCount, sizeof(Vertex), vertexIndices.data(), uniqueVertices);
+        CHECK_BOOL((mismatch == vertexCount), "vertex weld changed a vertex!");
+    }
+    
+    uint32_t base = UINT32(m_positions.size());
+    for (uint32_t vertex : uniqueVertices) {
+        m_positions.emplace_back(vertices[vertex].position);
+        m_normals  .emplace_back(vertices[vertex].normal);
+        m_texCoords.emplace_back(vertices[vertex].texCoord);
+    }
+    m_indices.reserve(m_indices.size() + cornerCount);
+    for (uint32_t index : cornerIndices) m_indices.push_back(base + vertexIndices[index]);
+}
+
+void Mesh::optimize() {
+    uint32_t vertexCount = UINT32(m_positions.size());
+    std::vector<uint32_t> indices = m_indices;
+    std::vector<uint32_t> remap   = OptimizeMesh(&indices, m_positions);
+    
+    std::vector<glm::vec3> positions(vertexCount);
+    std::vector<glm::vec3> normals  (vertexCount);
+    std::vector<glm::vec2> texCoords(vertexCount);
+    for (uint32_t i = 0; i < vertexCount; i++) {
+        positions[remap[i]] = m_positions[i];
+        normals  [remap[i]] = m_normals  [i];
+        texCoords[remap[i]] = m_texCoords[i];
+    }
+    
+    {
+        m_positions = positions;
+        m_normals   = normals;
+        m_texCoords = texCoords;
+        m_indices   = indices;
     }
+}
+
+// Vertex and index copies join the shared upload batch; buffers are ready when its token completes
+void Mesh::cmdCreateVertexBuffer() {
+    VkDeviceSize bufferSize = VkDeviceSize(m_vertexLayout.stride) * m_positions.size();
+    Uploader*    uploader   = System::Uploader();
     
     Buffer* vertexBuffer = new Buffer();
-    vertexBuffer->setup(bufferSize, VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT);
+    vertexBuffer->setup(bufferSize, VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT,
+                        Allocator::GpuOnly);
     vertexBuffer->create();
-    vertexBuffer->cmdCopyFromBuffer(tempBuffer->m_buffer, bufferSize);
-    
     
-    tempBuffer->cleanup();
+    Uploader::Staging staging = uploader->reserve(bufferSize);
+    packVertices(staging.mapped);
+    uploader->copyToBuffer(staging, vertexBuffer->getBuffer(), bufferSize);
     
     { m_vertexBuffer = vertexBuffer; }
 }
 
 void Mesh::cmdCreateIndexBuffer() {
     VkDeviceSize bufferSize = sizeofIndices();
-    
-    Buffer* tempBuffer = new Buffer();
-    tempBuffer->setup(bufferSize, VK_BUFFER_USAGE_TRANSFER_SRC_BIT);
-    tempBuffer->create();
-    tempBuffer->fillBufferFull(m_indices.data());
+    Uploader*    uploader   = System::Uploader();
     
     Buffer* indexBuffer = new Buffer();
-    indexBuffer->setup(bufferSize, VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_INDEX_BUFFER_BIT);
+    indexBuffer->setup(bufferSize, VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_INDEX_BUFFER_BIT,
+                       Allocator::GpuOnly);
     indexBuffer->create();
-    indexBuffer->cmdCopyFromBuffer(tempBuffer->m_buffer, bufferSize);
     
-    tempBuffer->cleanup();
+    Uploader::Staging staging = uploader->stage(m_indices.data(), bufferSize);
+    uploader->copyToBuffer(staging, indexBuffer->getBuffer(), bufferSize);
     
     { m_indexBuffer = indexBuffer; }
 }
 
+void Mesh::packVertices(void* address) {
+    VertexLayoutInfo layout     = m_vertexLayout;
+    VertexStreams    streams    = getStreams();
+    VertexDequantize dequantize = layout.getDequantize(streams);
+    layout.pack(streams, dequantize, address);
+    { m_dequantize = dequantize; }
+}
+
+VertexStreams Mesh::getStreams() {
+    VertexStreams streams;
+    streams.positions = m_positions.data();
+    streams.normals   = m_normals  .data();
+    streams.texCoords = m_texCoords.data();
+    streams.count     = m_positions.size();
+    return streams;
+}
+
+void Mesh::unpackVertices(const void* address, size_t count) {
+    const Vertex* vertices = static_cast<const Vertex*>(address);
+    m_positions.resize(count);
+    m_normals  .resize(count);
+    m_texCoords.resize(count);
+    
+    glm::vec3* positions = m_positions.data();
+    glm::vec3* normals   = m_normals  .data();
+    glm::vec2* texCoords = m_texCoords.data();
+    for (size_t i = 0; i < count; i++) {
+        positions[i] = vertices[i].position;
+        normals  [i] = vertices[i].normal;
+        texCoords[i] = vertices[i].texCoord;
+    }
+}
+
+// Formats past the float ones are optional for vertex buffers, so each is checked against the device
 VkPipelineVertexInputStateCreateInfo* Mesh::createVertexInputInfo() {
-    uint32_t stride = sizeofPosition + sizeofNormal + sizeofTexCoord;
+    VkPhysicalDevice physicalDevice = System::Renderer()->getPhysicalDevice();
+    VertexLayoutInfo layout         = m_vertexLayout;
+    for (const VkVertexInputAttributeDescription& attribute : layout.attributes) {
+        VkFormatProperties properties;
+        vkGetPhysicalDeviceFormatProperties(physicalDevice, attribute.format, &properties);
+        CHECK_BOOL((properties.bufferFeatures & VK_FORMAT_FEATURE_VERTEX_BUFFER_BIT),
+                   "vertex layout uses a format the device cannot fetch!");
+    }
     
     bindingDescription.binding = 0;
-    bindingDescription.stride = stride;
+    bindingDescription.stride = layout.stride;
     bindingDescription.inputRate = VK_VERTEX_INPUT_RATE_VERTEX;
     
-    attributeDescriptions.resize(3);
-    
-    attributeDescriptions[0].binding = 0;
-    attributeDescriptions[0].location = 0;
-    attributeDescriptions[0].format = VK_FORMAT_R32G32B32_SFLOAT;
-    attributeDescriptions[0].offset = 0;
-    
-    attributeDescriptions[1].binding = 0;
-    attributeDescriptions[1].location = 1;
-    attributeDescriptions[1].format = VK_FORMAT_R32G32B32_SFLOAT;
-    attributeDescriptions[1].offset = sizeofPosition;
-    
-    attributeDescriptions[2].binding = 0;
-    attributeDescriptions[2].location = 2;
-    attributeDescriptions[2].format = VK_FORMAT_R32G32_SFLOAT;
-    attributeDescriptions[2].offset = sizeofPosition + sizeofNormal;
+    attributeDescriptions = layout.attributes;
     
     stateCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
     stateCreateInfo.vertexBindingDescriptionCount = 1;
@@ -244,6 +320,10 @@ void Mesh::rotate(float angle, glm::vec3 axis) { m_model = glm::rotate(m_model,
 void Mesh::translate(glm::vec3 translation)    { m_model = glm::translate(m_model, translation); }
 glm::mat4 Mesh::getMatrix() { return m_model; }
 
+void             Mesh::setVertexLayout(VertexLayoutInfo layout) { m_vertexLayout = layout; }
+VertexLayoutInfo Mesh::getVertexLayout() { return m_vertexLayout; }
+VertexDequantize Mesh::getDequantize  () { return m_dequantize; }
+
 uint32_t Mesh::sizeofPositions() { return sizeofPosition * (uint32_t) m_positions.size(); }
 uint32_t Mesh::sizeofNormals  () { return sizeofNormal   * (uint32_t) m_normals.size(); }
 uint32_t Mesh::sizeofTexCoords() { return sizeofTexCoord * (uint32_t) m_texCoords.size(); }
@@ -5,6 +5,7 @@
 
 #include "../common.h"
 #include "../resources/buffer.h"
+#include "vertex_layout.h"
 
 class Mesh {
     
@@ -17,17 +18,28 @@ public:
     std::vector<glm::vec2> m_texCoords;
     std::vector<uint32_t>  m_indices;
     
+    // Filled by loadModel
+    glm::vec3 m_boundsMin = glm::vec3(0.f);
+    glm::vec3 m_boundsMax = glm::vec3(0.f);
+    
     void cleanup();
     void createPlane();
     void createQuad();
     void createCube();
     void createSphere(int wedge = 10, int segment = 20);
     void loadModel(const char* filename);
+    void optimize();
     
     Buffer* m_vertexBuffer = nullptr;
     Buffer* m_indexBuffer  = nullptr;
     void cmdCreateVertexBuffer();
     void cmdCreateIndexBuffer ();
+    void packVertices(void* address);
+    
+    // Full precision floats until set
+    void             setVertexLayout(VertexLayoutInfo layout);
+    VertexLayoutInfo getVertexLayout();
+    VertexDequantize getDequantize();
     
     void scale(glm::vec3 size);
     void rotate(float angle, glm::vec3 axis);
@@ -43,6 +55,12 @@ public:
     VkPipelineVertexInputStateCreateInfo* createVertexInputInfo();
     
 private:
+    // Full precision vertices for parsing, welding and the mesh cache
+    typedef FloatVertexLayout::Vertex Vertex;
+    
+    VertexLayoutInfo m_vertexLayout = FloatVertexLayout::GetInfo();
+    VertexDequantize m_dequantize;
+    
     glm::mat4 m_model = glm::mat4(1.0f);
     std::vector<VkVertexInputAttributeDescription> attributeDescriptions;
     VkPipelineVertexInputStateCreateInfo stateCreateInfo{};
@@ -53,4 +71,8 @@ private:
     const uint32_t sizeofTexCoord = sizeof(glm::vec2);
     const uint32_t sizeofIndex    = sizeof(int);
     
+    VertexStreams getStreams();
+    void parseModel(const char* filename);
+    void unpackVertices(const void* address, size_t count);
+    
 };
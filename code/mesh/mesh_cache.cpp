@@ -0,0 +1,126 @@
+//  Copyright © 2021 Subph. All rights reserved.
+//
+
+#include <cstring>
+#include <sstream>
+#include <iomanip>
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "mesh_cache.h"
+#include "../resources/texture_cache.h"
+
+#define MESH_CACHE_VERSION   4
+#define MESH_CACHE_ALIGNMENT 16
+
+static const char MESH_CACHE_MAGIC[4] = { 'M', 'S', 'C', 'H' };
+
+struct MeshCacheHeader {
+    char     magic[4];
+    uint32_t version;
+    uint64_t sourceHash;
+    uint64_t sourceSize;
+    uint32_t vertexCount;
+    uint32_t vertexStride;
+    uint32_t indexCount;
+    float    boundsMin[3];
+    float    boundsMax[3];
+    uint32_t padding;
+    uint64_t vertexOffset;
+    uint64_t indexOffset;
+};
+
+static uint64_t AlignCacheOffset(uint64_t offset) {
+    return (offset + MESH_CACHE_ALIGNMENT - 1) / MESH_CACHE_ALIGNMENT * MESH_CACHE_ALIGNMENT;
+}
+
+std::string GetMeshCachePath(const std::string filepath, uint64_t* sourceHash, uint64_t* sourceSize) {
+    uint64_t fileSize = 0;
+    uint64_t hash     = HashFile(filepath, &fileSize, MESH_CACHE_VERSION);
+    *sourceHash = hash;
+    *sourceSize = fileSize;
+
+    std::stringstream stream;
+    stream << MESH_CACHE_DIRECTORY << std::hex << std::setfill('0')
+           << std::setw(16) << hash << "_" << fileSize << ".mesh";
+    return stream.str();
+}
+
+bool MapCachedMesh(const std::string cachePath, uint64_t sourceHash, uint64_t sourceSize, CachedMesh* mesh) {
+    int file = open(cachePath.c_str(), O_RDONLY);
+    if (file < 0) return false;
+
+    struct stat status;
+    void* mapped = MAP_FAILED;
+    if (fstat(file, &status) == 0 && status.st_size >= (off_t) sizeof(MeshCacheHeader))
+        mapped = mmap(nullptr, status.st_size, PROT_READ, MAP_PRIVATE, file, 0);
+    close(file);
+    if (mapped == MAP_FAILED) return false;
+
+    const char* data    = (const char*) mapped;
+    size_t      mapSize = (size_t) status.st_size;
+    madvise(mapped, mapSize, MADV_SEQUENTIAL);
+
+    MeshCacheHeader header;
+    memcpy(&header, data, sizeof(MeshCacheHeader));
+    uint64_t vertexBytes = uint64_t(header.vertexCount) * header.vertexStride;
+    uint64_t indexBytes  = uint64_t(header.indexCount) * sizeof(uint32_t);
+    bool isValid = memcmp(header.magic, MESH_CACHE_MAGIC, 4) == 0 &&
+                   header.version    == MESH_CACHE_VERSION &&
+                   header.sourceHash == sourceHash && header.sourceSize == sourceSize &&
+                   header.vertexOffset >= sizeof(MeshCacheHeader) &&
+                   header.vertexOffset + vertexBytes <= mapSize &&
+                   header.indexOffset  >= header.vertexOffset + vertexBytes &&
+                   header.indexOffset  + indexBytes  <= mapSize;
+    if (!isValid) {
+        munmap(mapped, mapSize);
+        return false;
+    }
+
+    mesh->vertexCount  = header.vertexCount;
+    mesh->vertexStride = header.vertexStride;
+    mesh->indexCount   = header.indexCount;
+    mesh->boundsMin    = glm::vec3(header.boundsMin[0], header.boundsMin[1], header.boundsMin[2]);
+    mesh->boundsMax    = glm::vec3(header.boundsMax[0], header.boundsMax[1], header.boundsMax[2]);
+    mesh->vertices     = data + header.vertexOffset;
+    mesh->indices      = data + header.indexOffset;
+    mesh->data         = data;
+    mesh->mapSize      = mapSize;
+    return true;
+}
+
+void UnmapCachedMesh(CachedMesh* mesh) {
+    if (mesh->data != nullptr) munmap((void*) mesh->data, mesh->mapSize);
+    *mesh = CachedMesh{};
+}
+
+void WriteCachedMesh(const std::string cachePath, uint64_t sourceHash, uint64_t sourceSize,
+                     const void* vertices, uint32_t vertexCount, uint32_t vertexStride,
+                     const std::vector<uint32_t>& indices, glm::vec3 boundsMin, glm::vec3 boundsMax) {
+    uint64_t vertexBytes = uint64_t(vertexCount) * vertexStride;
+    uint64_t indexBytes  = indices.size() * sizeof(uint32_t);
+
+    MeshCacheHeader header{};
+    memcpy(header.magic, MESH_CACHE_MAGIC, 4);
+    header.version      = MESH_CACHE_VERSION;
+    header.sourceHash   = sourceHash;
+    header.sourceSize   = sourceSize;
+    header.vertexCount  = vertexCount;
+    header.vertexStride = vertexStride;
+    header.indexCount   = UINT32(indices.size());
+    memcpy(header.boundsMin, &boundsMin, sizeof(header.boundsMin));
+    memcpy(header.boundsMax, &boundsMax, sizeof(header.boundsMax));
+    header.vertexOffset = AlignCacheOffset(sizeof(MeshCacheHeader));
+    header.indexOffset  = AlignCacheOffset(header.vertexOffset + vertexBytes);
+
+    std::vector<char> blob(header.indexOffset + indexBytes, 0);
+    memcpy(blob.data(), &header, sizeof(MeshCacheHeader));
+    memcpy(blob.data() + header.vertexOffset, vertices, vertexBytes);
+    memcpy(blob.data() + header.indexOffset, indices.data(), indexBytes);
+
+    CreateCacheDirectory(MESH_CACHE_DIRECTORY);
+    WriteCacheFile(cachePath, blob);
+}
@@ -0,0 +1,32 @@
+//  Copyright © 2021 Subph. All rights reserved.
+//
+
+#pragma once
+
+#include "../common.h"
+
+#define MESH_CACHE_DIRECTORY "cache/meshes/"
+
+// A cache blob mapped read-only; vertices are the full precision FloatVertexLayout stream, quantized
+// again on upload so changing the mesh layout never invalidates the cache
+struct CachedMesh {
+    uint32_t    vertexCount  = 0;
+    uint32_t    vertexStride = 0;
+    uint32_t    indexCount   = 0;
+    glm::vec3   boundsMin    = glm::vec3(0.f);
+    glm::vec3   boundsMax    = glm::vec3(0.f);
+    const char* vertices     = nullptr;
+    const char* indices      = nullptr;
+    const char* data         = nullptr;
+    size_t      mapSize      = 0;
+};
+
+// Keyed by a hash of the source file contents; the header repeats hash and size to check the mapping
+std::string GetMeshCachePath(const std::string filepath, uint64_t* sourceHash, uint64_t* sourceSize);
+
+bool MapCachedMesh  (const std::string cachePath, uint64_t sourceHash, uint64_t sourceSize, CachedMesh* mesh);
+void UnmapCachedMesh(CachedMesh* mesh);
+
+void WriteCachedMesh(const std::string cachePath, uint64_t sourceHash, uint64_t sourceSize,
+                     const void* vertices, uint32_t vertexCount, uint32_t vertexStride,
+                     const std::vector<uint32_t>& indices, glm::vec3 boundsMin, glm::vec3 boundsMax);
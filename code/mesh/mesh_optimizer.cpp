@@ -0,0 +1,223 @@
+//  Copyright © 2021 Subph. All rights reserved.
+//
+
+#include <algorithm>
+#include <numeric>
+
+#include "mesh_optimizer.h"
+
+#define NO_VERTEX 0xFFFFFFFFu
+
+// A FIFO cache held as the time each vertex entered it; entries older than the cache size have left
+class FifoCache {
+
+public:
+    FifoCache(uint32_t vertexCount, uint32_t cacheSize) : m_times(vertexCount, 0), m_cacheSize(cacheSize) {}
+
+    bool access(uint32_t vertex) {
+        if (m_times[vertex] != 0 && m_time - m_times[vertex] < m_cacheSize) return true;
+        m_times[vertex] = ++m_time;
+        return false;
+    }
+
+    void reset() { m_time += m_cacheSize; }
+
+private:
+    std::vector<uint32_t> m_times;
+    uint32_t              m_cacheSize;
+    uint32_t              m_time = 0;
+};
+
+struct TriangleAdjacency {
+    std::vector<uint32_t> offsets;
+    std::vector<uint32_t> triangles;
+};
+
+static TriangleAdjacency BuildAdjacency(const std::vector<uint32_t>& indices, uint32_t vertexCount) {
+    TriangleAdjacency adjacency;
+    adjacency.offsets.assign(vertexCount + 1, 0);
+    for (uint32_t index : indices) adjacency.offsets[index + 1]++;
+    std::partial_sum(adjacency.offsets.begin(), adjacency.offsets.end(), adjacency.offsets.begin());
+
+    std::vector<uint32_t> fill(adjacency.offsets.begin(), adjacency.offsets.end() - 1);
+    adjacency.triangles.resize(indices.size());
+    for (size_t i = 0; i < indices.size(); i++) adjacency.triangles[fill[indices[i]]++] = UINT32(i / 3);
+    return adjacency;
+}
+
+VertexCacheStats AnalyzeVertexCache(const std::vector<uint32_t>& indices, uint32_t vertexCount, uint32_t cacheSize) {
+    VertexCacheStats stats;
+    if (indices.empty()) return stats;
+
+    FifoCache         cache(vertexCount, cacheSize);
+    std::vector<bool> isReferenced(vertexCount, false);
+    uint32_t misses = 0, referenced = 0;
+    for (uint32_t index : indices) {
+        misses += !cache.access(index);
+        if (!isReferenced[index]) referenced++;
+        isReferenced[index] = true;
+    }
+    stats.acmr = float(misses) / float(indices.size() / 3);
+    stats.atvr = float(misses) / float(referenced);
+    return stats;
+}
+
+// Sander, Nehab and Barczak, "Fast Triangle Reordering for Vertex Locality and Reduced Overdraw", 2007
+std::vector<uint32_t> OptimizeVertexCache(const std::vector<uint32_t>& indices, uint32_t vertexCount,
+                                          uint32_t cacheSize, std::vector<uint32_t>* clusters) {
+    CHECK_BOOL((indices.size() % 3 == 0), "mesh indices must form triangles!");
+    TriangleAdjacency adjacency = BuildAdjacency(indices, vertexCount);
+    uint32_t triangleCount = UINT32(indices.size() / 3);
+
+    std::vector<uint32_t> live(vertexCount);
+    for (uint32_t v = 0; v < vertexCount; v++) live[v] = adjacency.offsets[v + 1] - adjacency.offsets[v];
+    std::vector<uint32_t> cacheTimes(vertexCount, 0);
+    std::vector<bool>     isEmitted(triangleCount, false);
+    std::vector<uint32_t> deadEnds;
+    std::vector<uint32_t> candidates;
+    std::vector<uint32_t> output;
+    output.reserve(indices.size());
+    clusters->clear();
+
+    uint32_t time   = cacheSize + 1;
+    uint32_t cursor = 0;
+    uint32_t fan    = NO_VERTEX;
+    for (uint32_t v = 0; v < vertexCount && fan == NO_VERTEX; v++) if (live[v] > 0) fan = v;
+    if (fan != NO_VERTEX) clusters->push_back(0);
+
+    while (fan != NO_VERTEX) {
+        candidates.clear();
+        for (uint32_t i = adjacency.offsets[fan]; i < adjacency.offsets[fan + 1]; i++) {
+            uint32_t triangle = adjacency.triangles[i];
+            if (isEmitted[triangle]) continue;
+            isEmitted[triangle] = true;
+            for (uint32_t corner = 0; corner < 3; corner++) {
+                uint32_t v = indices[triangle * 3 + corner];
+                output.push_back(v);
+                deadEnds.push_back(v);
+                candidates.push_back(v);
+                live[v]--;
+                if (time - cacheTimes[v] > cacheSize) cacheTimes[v] = time++;
+            }
+        }
+
+        // The candidate that stays cached longest and still has triangles left, if fanning it fits in the cache
+        uint32_t next = NO_VERTEX;
+        int32_t  bestPriority = -1;
+        for (uint32_t v : candidates) {
+            if (live[v] == 0) continue;
+            int32_t priority = 0;
+            if (time - cacheTimes[v] + 2 * live[v] <= cacheSize) priority = int32_t(time - cacheTimes[v]);
+            if (priority > bestPriority) {
+                bestPriority = priority;
+                next         = v;
+            }
+        }
+
+        // Dead end: back to the most recently used vertex with triangles left, else the next one in input order
+        if (next == NO_VERTEX) {
+            while (!deadEnds.empty() && next == NO_VERTEX) {
+                uint32_t v = deadEnds.back();
+                deadEnds.pop_back();
+                if (live[v] > 0) next = v;
+            }
+            for (; cursor < vertexCount && next == NO_VERTEX; cursor++) if (live[cursor] > 0) next = cursor;
+            if (next != NO_VERTEX && output.size() < indices.size()) clusters->push_back(UINT32(output.size()));
+        }
+        fan = next;
+    }
+    return output;
+}
+
+std::vector<uint32_t> OptimizeOverdraw(const std::vector<uint32_t>& indices, const std::vector<glm::vec3>& positions,
+                                       const std::vector<uint32_t>& clusters, uint32_t cacheSize, float threshold) {
+    if (indices.empty()) return indices;
+    uint32_t vertexCount = UINT32(positions.size());
+
+    // Soft boundaries: a cluster closes once its own miss rate is within threshold of its hard cluster's
+    std::vector<uint32_t> softClusters;
+    FifoCache cache(vertexCount, cacheSize);
+    for (size_t c = 0; c < clusters.size(); c++) {
+        size_t begin = clusters[c];
+        size_t end   = c + 1 < clusters.size() ? clusters[c + 1] : indices.size();
+        uint32_t clusterMisses = 0;
+        cache.reset();
+        for (size_t i = begin; i < end; i++) clusterMisses += !cache.access(indices[i]);
+        float clusterThreshold = threshold * float(clusterMisses) / float((end - begin) / 3);
+
+        uint32_t misses = 0;
+        size_t   start  = begin;
+        cache.reset();
+        softClusters.push_back(UINT32(begin));
+        for (size_t i = begin; i < end; i += 3) {
+            for (size_t corner = 0; corner < 3; corner++) misses += !cache.access(indices[i + corner]);
+            size_t triangles = (i + 3 - start) / 3;
+            if (i + 3 < end && float(misses) / float(triangles) <= clusterThreshold) {
+                softClusters.push_back(UINT32(i + 3));
+                start  = i + 3;
+                misses = 0;
+                cache.reset();
+            }
+        }
+    }
+
+    glm::vec3 meshCenter = glm::vec3(0.f);
+    for (const glm::vec3& position : positions) meshCenter += position;
+    meshCenter /= float(std::max(vertexCount, 1u));
+
+    // Area weighted centroid and normal per cluster; the sort key is how far the cluster faces outward
+    std::vector<float> keys(softClusters.size());
+    for (size_t c = 0; c < softClusters.size(); c++) {
+        size_t begin = softClusters[c];
+        size_t end   = c + 1 < softClusters.size() ? softClusters[c + 1] : indices.size();
+        glm::vec3 centroid = glm::vec3(0.f);
+        glm::vec3 normal   = glm::vec3(0.f);
+        float     area     = 0.f;
+        for (size_t i = begin; i < end; i += 3) {
+            glm::vec3 p0 = positions[indices[i]], p1 = positions[indices[i + 1]], p2 = positions[indices[i + 2]];
+            glm::vec3 cross = glm::cross(p1 - p0, p2 - p0);
+            float     triangleArea = glm::length(cross);
+            centroid += (p0 + p1 + p2) * (triangleArea / 3.f);
+            normal   += cross;
+            area     += triangleArea;
+        }
+        float normalLength = glm::length(normal);
+        if (area > 0.f) centroid /= area;
+        if (normalLength > 0.f) normal /= normalLength;
+        keys[c] = glm::dot(centroid - meshCenter, normal);
+    }
+
+    std::vector<uint32_t> order(softClusters.size());
+    std::iota(order.begin(), order.end(), 0);
+    std::stable_sort(order.begin(), order.end(), [&keys](uint32_t a, uint32_t b) { return keys[a] > keys[b]; });
+
+    std::vector<uint32_t> output;
+    output.reserve(indices.size());
+    for (uint32_t c : order) {
+        size_t begin = softClusters[c];
+        size_t end   = c + 1 < softClusters.size() ? softClusters[c + 1] : indices.size();
+        output.insert(output.end(), indices.begin() + begin, indices.begin() + end);
+    }
+    return output;
+}
+
+std::vector<uint32_t> OptimizeVertexFetch(std::vector<uint32_t>* indices, uint32_t vertexCount) {
+    std::vector<uint32_t> remap(vertexCount, NO_VERTEX);
+    uint32_t next = 0;
+    for (uint32_t& index : *indices) {
+        if (remap[index] == NO_VERTEX) remap[index] = next++;
+        index = remap[index];
+    }
+    for (uint32_t& position : remap) if (position == NO_VERTEX) position = next++;
+    return remap;
+}
+
+std::vector<uint32_t> OptimizeMesh(std::vector<uint32_t>* indices, const std::vector<glm::vec3>& positions) {
+    uint32_t vertexCount = uint32_t(positions.size());
+    std::vector<uint32_t> clusters;
+    std::vector<uint32_t> ordered = OptimizeVertexCache(*indices, vertexCount, VERTEX_CACHE_SIZE, &clusters);
+    ordered = OptimizeOverdraw(ordered, positions, clusters, VERTEX_CACHE_SIZE, OVERDRAW_THRESHOLD);
+    std::vector<uint32_t> remap = OptimizeVertexFetch(&ordered, vertexCount);
+    { *indices = ordered; }
+    return remap;
+}
@@ -0,0 +1,35 @@
+//  Copyright © 2021 Subph. All rights reserved.
+//
+
+#pragma once
+
+#include "../common.h"
+
+#define VERTEX_CACHE_SIZE  16
+#define OVERDRAW_THRESHOLD 1.05f
+
+// ACMR is cache misses per triangle, ATVR misses per referenced vertex; 1.0 is the best ATVR can reach
+struct VertexCacheStats {
+    float acmr = 0.f;
+    float atvr = 0.f;
+};
+
+VertexCacheStats AnalyzeVertexCache(const std::vector<uint32_t>& indices, uint32_t vertexCount, uint32_t cacheSize);
+
+// Tipsify: fans around the vertex that stays cached longest, jumping back to recent vertices at dead ends.
+// Each jump starts a new cluster; clusters holds the first index of every one
+std::vector<uint32_t> OptimizeVertexCache(const std::vector<uint32_t>& indices, uint32_t vertexCount,
+                                          uint32_t cacheSize, std::vector<uint32_t>* clusters);
+
+// Splits clusters while they stay within threshold of their cache efficiency, then sorts them so the ones
+// facing away from the mesh center draw first
+std::vector<uint32_t> OptimizeOverdraw(const std::vector<uint32_t>& indices, const std::vector<glm::vec3>& positions,
+                                       const std::vector<uint32_t>& clusters, uint32_t cacheSize, float threshold);
+
+// Renumbers vertices in first use order and rewrites indices; unreferenced vertices move to the end.
+// Returns the new position of every old vertex
+std::vector<uint32_t> OptimizeVertexFetch(std::vector<uint32_t>* indices, uint32_t vertexCount);
+
+// Cache order, then overdraw, then fetch order, as Mesh::optimize applies them. Rewrites indices and returns
+// the new position of every old vertex
+std::vector<uint32_t> OptimizeMesh(std::vector<uint32_t>* indices, const std::vector<glm::vec3>& positions);
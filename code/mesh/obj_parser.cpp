@@ -0,0 +1,382 @@
+//  Copyright © 2021 Subph. All rights reserved.
+//
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <limits>
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "obj_parser.h"
+
+#include "../thread_pool.h"
+
+#define OBJ_MIN_CHUNK_SIZE    (1 << 20)
+#define OBJ_CHUNKS_PER_WORKER 4
+
+// A face of more than three corners, fanned in place until every position is read
+struct ObjPolygon {
+    size_t   firstCorner;
+    uint32_t cornerCount;
+};
+
+// One slice of the file. A counting pass gives every chunk its offsets into the merged attribute arrays
+// before parsing, so negative indices resolve straight to global ones and attributes land in place
+struct ObjChunk {
+    const char*            begin          = nullptr;
+    const char*            end            = nullptr;
+    size_t                 positionCount  = 0;
+    size_t                 texCoordCount  = 0;
+    size_t                 normalCount    = 0;
+    size_t                 positionOffset = 0;
+    size_t                 texCoordOffset = 0;
+    size_t                 normalOffset   = 0;
+    std::vector<ObjCorner>  corners;
+    std::vector<ObjPolygon> polygons;
+};
+
+static const double DECIMAL_PLACES[] = { 1.0, 0.1, 0.01, 0.001, 0.0001, 0.00001, 0.000001, 0.0000001 };
+
+static inline bool IsSpace(char c) { return c == ' ' || c == '\t'; }
+static inline bool IsDigit(char c) { return c >= '0' && c <= '9'; }
+
+static inline bool IsLineEnd(const char* p, const char* end) {
+    return p == end || *p == '\n' || *p == '\r' || *p == '#';
+}
+
+static inline const char* SkipSpaces(const char* p, const char* end) {
+    while (p < end && IsSpace(*p)) p++;
+    return p;
+}
+
+static inline const char* SkipLine(const char* p, const char* end) {
+    const char* newline = (const char*) memchr(p, '\n', end - p);
+    return newline != nullptr ? newline + 1 : end;
+}
+
+// tiny_obj_loader's tryParseDouble operation for operation in the same double math, so every value has the
+// bits tiny_obj_loader would give it and the exact weld sees the same vertices. It is not correctly rounded,
+// strtof can differ in the last bit
+static const char* ParseFloat(const char* p, const char* end, float* value) {
+    p = SkipSpaces(p, end);
+    bool isNegative = p < end && *p == '-';
+    if (p < end && (*p == '-' || *p == '+')) p++;
+
+    double  mantissa = 0.0;
+    int32_t exponent = 0;
+    bool    hasDigit = false;
+    for (; p < end && IsDigit(*p); p++, hasDigit = true) {
+        mantissa *= 10;
+        mantissa += int32_t(*p - '0');
+    }
+    if (p < end && *p == '.') {
+        int32_t place = 1;
+        for (p++; p < end && IsDigit(*p); p++, place++, hasDigit = true)
+            mantissa += int32_t(*p - '0') * (place < 8 ? DECIMAL_PLACES[place] : std::pow(10.0, -place));
+    }
+    if (!hasDigit) return nullptr;
+    if (p < end && (*p == 'e' || *p == 'E')) {
+        p++;
+        bool isExponentNegative = p < end && *p == '-';
+        if (p < end && (*p == '-' || *p == '+')) p++;
+        if (p == end || !IsDigit(*p)) return nullptr;
+        for (; p < end && IsDigit(*p); p++) exponent = std::min(exponent * 10 + (*p - '0'), 9999);
+        if (isExponentNegative) exponent = -exponent;
+    }
+
+    double result = exponent ? std::ldexp(mantissa * std::pow(5.0, exponent), exponent) : mantissa;
+    *value = float(isNegative ? -result : result);
+    return p;
+}
+
+static const char* ParseIndex(const char* p, const char* end, int32_t* value) {
+    bool isNegative = p < end && *p == '-';
+    if (p < end && (*p == '-' || *p == '+')) p++;
+    if (p == end || !IsDigit(*p)) return nullptr;
+    int64_t result = 0;
+    for (; p < end && IsDigit(*p); p++) result = std::min<int64_t>(result * 10 + (*p - '0'), INT32_MAX);
+    *value = int32_t(isNegative ? -result : result);
+    return p;
+}
+
+// OBJ indices are 1-based, negative ones count back from the attributes read before the line
+static inline bool ResolveIndex(int32_t index, size_t readCount, size_t totalCount, int32_t* resolved) {
+    int64_t result = index > 0 ? int64_t(index) - 1 : int64_t(readCount) + index;
+    *resolved = int32_t(result);
+    return index != 0 && result >= 0 && result < int64_t(totalCount);
+}
+
+// "v", "v/vt", "v//vn" or "v/vt/vn"; read holds the position, texcoord and normal counts before the line
+static const char* ParseCorner(const char* p, const char* end, const size_t read[3], const size_t total[3],
+                               ObjCorner* corner) {
+    int32_t index;
+    *corner = { -1, -1, -1 };
+    if (!(p = ParseIndex(p, end, &index)) || !ResolveIndex(index, read[0], total[0], &corner->position)) return nullptr;
+    if (p == end || *p != '/') return p;
+    p++;
+    if (p < end && *p != '/') {
+        if (!(p = ParseIndex(p, end, &index)) || !ResolveIndex(index, read[1], total[1], &corner->texCoord)) return nullptr;
+    }
+    if (p == end || *p != '/') return p;
+    p++;
+    if (!(p = ParseIndex(p, end, &index)) || !ResolveIndex(index, read[2], total[2], &corner->normal)) return nullptr;
+    return p;
+}
+
+static inline bool IsRecord(const char* p, const char* end, const char* tag, size_t length) {
+    return size_t(end - p) > length && memcmp(p, tag, length) == 0 && IsSpace(p[length]);
+}
+
+static void CountChunk(ObjChunk* chunk) {
+    const char* end = chunk->end;
+    for (const char* p = chunk->begin; p < end; p = SkipLine(p, end)) {
+        p = SkipSpaces(p, end);
+        if      (IsRecord(p, end, "v",  1)) chunk->positionCount++;
+        else if (IsRecord(p, end, "vt", 2)) chunk->texCoordCount++;
+        else if (IsRecord(p, end, "vn", 2)) chunk->normalCount++;
+    }
+}
+
+// Polygons fan out from their first corner for now; TriangulateChunk redoes them once all positions are read
+static void ParseChunk(ObjChunk* chunk, ObjModel* model) {
+    glm::vec3* positions = model->positions.data() + chunk->positionOffset;
+    glm::vec2* texCoords = model->texCoords.data() + chunk->texCoordOffset;
+    glm::vec3* normals   = model->normals  .data() + chunk->normalOffset;
+    size_t read[3]  = { chunk->positionOffset, chunk->texCoordOffset, chunk->normalOffset };
+    size_t total[3] = { model->positions.size(), model->texCoords.size(), model->normals.size() };
+
+    const char* end = chunk->end;
+    for (const char* p = chunk->begin; p < end; p = SkipLine(p, end)) {
+        const char* line = p = SkipSpaces(p, end);
+        if (IsRecord(p, end, "v", 1)) {
+            glm::vec3& position = positions[read[0]++ - chunk->positionOffset];
+            p = ParseFloat(p + 1, end, &position.x);
+            if (p) p = ParseFloat(p, end, &position.y);
+            if (p) p = ParseFloat(p, end, &position.z);
+        } else if (IsRecord(p, end, "vt", 2)) {
+            glm::vec2& texCoord = texCoords[read[1]++ - chunk->texCoordOffset];
+            p = ParseFloat(p + 2, end, &texCoord.x);
+            texCoord.y = 0.f;
+            // A missing v reads as 0, as tiny_obj_loader does
+            if (p && !IsLineEnd(SkipSpaces(p, end), end)) p = ParseFloat(p, end, &texCoord.y);
+        } else if (IsRecord(p, end, "vn", 2)) {
+            glm::vec3& normal = normals[read[2]++ - chunk->normalOffset];
+            p = ParseFloat(p + 2, end, &normal.x);
+            if (p) p = ParseFloat(p, end, &normal.y);
+            if (p) p = ParseFloat(p, end, &normal.z);
+        } else if (IsRecord(p, end, "f", 1)) {
+            // Faces with fewer than three corners add no triangles
+            ObjCorner first, previous, corner;
+            uint32_t  count       = 0;
+            size_t    firstCorner = chunk->corners.size();
+            for (p++; p && !IsLineEnd(p = SkipSpaces(p, end), end); count++) {
+                if (!(p = ParseCorner(p, end, read, total, &corner))) break;
+                if (count >= 2) chunk->corners.insert(chunk->corners.end(), { first, previous, corner });
+                if (count == 0) first = corner;
+                previous = corner;
+            }
+            if (p && count > 3) chunk->polygons.push_back({ firstCorner, count });
+        }
+        if (p == nullptr) {
+            const char* lineEnd = line;
+            while (lineEnd < end && *lineEnd != '\n' && *lineEnd != '\r') lineEnd++;
+            RUNTIME_ERROR("malformed obj line: " + std::string(line, lineEnd - line));
+        }
+    }
+}
+
+// From tiny_obj_loader, which takes it from https://wrf.ecse.rpi.edu//Research/Short_Notes/pnpoly.html
+static bool IsInTriangle(const float x[3], const float y[3], float testX, float testY) {
+    bool isInside = false;
+    for (int i = 0, j = 2; i < 3; j = i++) {
+        if (((y[i] > testY) != (y[j] > testY)) && (testX < (x[j] - x[i]) * (testY - y[i]) / (y[j] - y[i]) + x[i]))
+            isInside = !isInside;
+    }
+    return isInside;
+}
+
+// tiny_obj_loader's ear clipping step for step, in the same float math, so concave polygons split into the
+// same triangles. It projects onto the two axes of the first non-degenerate corner and cuts ears in turn
+static uint32_t ClipEars(const std::vector<glm::vec3>& positions, std::vector<ObjCorner> polygon,
+                         ObjCorner* triangles) {
+    size_t cornerCount = polygon.size();
+    size_t axes[2]     = { 1, 2 };
+    for (size_t k = 0; k < cornerCount; k++) {
+        const glm::vec3& v0 = positions[polygon[(k + 0) % cornerCount].position];
+        const glm::vec3& v1 = positions[polygon[(k + 1) % cornerCount].position];
+        const glm::vec3& v2 = positions[polygon[(k + 2) % cornerCount].position];
+        float e0x = v1.x - v0.x, e0y = v1.y - v0.y, e0z = v1.z - v0.z;
+        float e1x = v2.x - v1.x, e1y = v2.y - v1.y, e1z = v2.z - v1.z;
+        float cx  = std::fabs(e0y * e1z - e0z * e1y);
+        float cy  = std::fabs(e0z * e1x - e0x * e1z);
+        float cz  = std::fabs(e0x * e1y - e0y * e1x);
+        const float epsilon = std::numeric_limits<float>::epsilon();
+        if (cx > epsilon || cy > epsilon || cz > epsilon) {
+            if (!(cx > cy && cx > cz)) {
+                axes[0] = 0;
+                if (cz > cx && cz > cy) axes[1] = 1;
+            }
+            break;
+        }
+    }
+    
+    float area = 0;
+    for (size_t k = 0; k < cornerCount; k++) {
+        const glm::vec3& v0 = positions[polygon[(k + 0) % cornerCount].position];
+        const glm::vec3& v1 = positions[polygon[(k + 1) % cornerCount].position];
+        area += (v0[axes[0]] * v1[axes[1]] - v0[axes[1]] * v1[axes[0]]) * 0.5f;
+    }
+    
+    // Gives up like tiny_obj_loader once a full lap over the remaining corners finds no ear
+    uint32_t triangleCount     = 0;
+    size_t   guess             = 0;
+    size_t   remainingLaps     = cornerCount;
+    size_t   previousRemaining = cornerCount;
+    while (polygon.size() > 3 && remainingLaps > 0) {
+        size_t remaining = polygon.size();
+        if (guess >= remaining) guess -= remaining;
+        if (previousRemaining != remaining) {
+            previousRemaining = remaining;
+            remainingLaps     = remaining;
+        } else {
+            remainingLaps--;
+        }
+        
+        ObjCorner ear[3];
+        float     x[3], y[3];
+        for (size_t k = 0; k < 3; k++) {
+            ear[k] = polygon[(guess + k) % remaining];
+            x[k]   = positions[ear[k].position][axes[0]];
+            y[k]   = positions[ear[k].position][axes[1]];
+        }
+        float e0x = x[1] - x[0], e0y = y[1] - y[0];
+        float e1x = x[2] - x[1], e1y = y[2] - y[1];
+        float cross = e0x * e1y - e0y * e1x;
+        if (cross * area < 0.f) {
+            guess++;
+            continue;
+        }
+        
+        bool isOverlapping = false;
+        for (size_t other = 3; other < remaining && !isOverlapping; other++) {
+            const glm::vec3& position = positions[polygon[(guess + other) % remaining].position];
+            isOverlapping = IsInTriangle(x, y, position[axes[0]], position[axes[1]]);
+        }
+        if (isOverlapping) {
+            guess++;
+            continue;
+        }
+        
+        std::copy(ear, ear + 3, triangles + triangleCount++ * 3);
+        polygon.erase(polygon.begin() + (guess + 1) % remaining);
+    }
+    if (polygon.size() == 3) std::copy(polygon.begin(), polygon.end(), triangles + triangleCount++ * 3);
+    return triangleCount;
+}
+
+// Rebuilds each polygon's corners from its fan and clips it into the same triangle slots. Like tiny_obj_loader,
+// a polygon the ear clipping cannot fully split keeps the triangles it got and drops the rest
+static void TriangulateChunk(ObjChunk* chunk, const ObjModel* model) {
+    bool hasDropped = false;
+    for (const ObjPolygon& polygon : chunk->polygons) {
+        ObjCorner* fan = chunk->corners.data() + polygon.firstCorner;
+        std::vector<ObjCorner> corners = { fan[0], fan[1] };
+        for (uint32_t i = 0; i + 2 < polygon.cornerCount; i++) corners.push_back(fan[i * 3 + 2]);
+        
+        uint32_t triangleCount = ClipEars(model->positions, corners, fan);
+        for (uint32_t i = triangleCount * 3; i < (polygon.cornerCount - 2) * 3; i++) fan[i].position = -1;
+        hasDropped |= triangleCount != polygon.cornerCount - 2;
+    }
+    if (hasDropped) {
+        auto isDropped = [](const ObjCorner& corner) { return corner.position < 0; };
+        chunk->corners.erase(std::remove_if(chunk->corners.begin(), chunk->corners.end(), isDropped),
+                             chunk->corners.end());
+    }
+}
+
+void ParseObj(const std::string filepath, ObjModel* model, ThreadPool* pThreadPool) {
+    int file = open(filepath.c_str(), O_RDONLY);
+    if (file < 0) RUNTIME_ERROR("failed to open obj file: " + filepath);
+    struct stat status;
+    void* mapped = MAP_FAILED;
+    if (fstat(file, &status) == 0 && status.st_size > 0)
+        mapped = mmap(nullptr, status.st_size, PROT_READ, MAP_PRIVATE, file, 0);
+    close(file);
+    if (mapped == MAP_FAILED) RUNTIME_ERROR("failed to map obj file: " + filepath);
+    const char* data    = (const char*) mapped;
+    size_t      mapSize = (size_t) status.st_size;
+    madvise(mapped, mapSize, MADV_SEQUENTIAL);
+
+    // Several chunks per worker even out lines of different cost; each boundary moves past its newline
+    ThreadPool* threadPool = pThreadPool;
+    size_t chunkCount = std::max<size_t>(1, std::min<size_t>(mapSize / OBJ_MIN_CHUNK_SIZE,
+                                                             (threadPool->getWorkerCount() + 1) * OBJ_CHUNKS_PER_WORKER));
+    std::vector<ObjChunk> chunks(chunkCount);
+    const char* begin = data;
+    for (size_t i = 0; i < chunkCount; i++) {
+        const char* end = i + 1 == chunkCount ? data + mapSize : data + mapSize * (i + 1) / chunkCount;
+        if (end < begin) end = begin;
+        if (end < data + mapSize) end = SkipLine(end, data + mapSize);
+        chunks[i].begin = begin;
+        chunks[i].end   = end;
+        begin = end;
+    }
+
+    auto runChunks = [&](std::function<void(ObjChunk*)> task) {
+        std::vector<std::future<void>> futures;
+        for (ObjChunk& chunk : chunks) futures.push_back(threadPool->push([&chunk, &task]() { task(&chunk); }));
+        for (std::future<void>& future : futures) threadPool->wait(future);
+    };
+
+    runChunks([](ObjChunk* chunk) { CountChunk(chunk); });
+    size_t positionCount = 0, texCoordCount = 0, normalCount = 0;
+    for (ObjChunk& chunk : chunks) {
+        chunk.positionOffset = positionCount;
+        chunk.texCoordOffset = texCoordCount;
+        chunk.normalOffset   = normalCount;
+        positionCount += chunk.positionCount;
+        texCoordCount += chunk.texCoordCount;
+        normalCount   += chunk.normalCount;
+    }
+    CHECK_BOOL((positionCount <= INT32_MAX && texCoordCount <= INT32_MAX && normalCount <= INT32_MAX),
+               "obj has too many attributes!");
+    model->positions.resize(positionCount);
+    model->texCoords.resize(texCoordCount);
+    model->normals  .resize(normalCount);
+
+    // An error in any chunk still waits for the rest before the file is unmapped and it is rethrown
+    std::exception_ptr error;
+    std::mutex         errorMutex;
+    runChunks([model, &error, &errorMutex](ObjChunk* chunk) {
+        try { ParseChunk(chunk, model); }
+        catch (...) {
+            std::lock_guard<std::mutex> lock(errorMutex);
+            if (!error) error = std::current_exception();
+        }
+    });
+    munmap(mapped, mapSize);
+    if (error) std::rethrow_exception(error);
+    
+    // Ear clipping may read positions of any chunk, so it waits for every chunk's parse
+    runChunks([model, &error, &errorMutex](ObjChunk* chunk) {
+        try { TriangulateChunk(chunk, model); }
+        catch (...) {
+            std::lock_guard<std::mutex> lock(errorMutex);
+            if (!error) error = std::current_exception();
+        }
+    });
+    if (error) std::rethrow_exception(error);
+
+    size_t cornerCount = 0;
+    for (ObjChunk& chunk : chunks) cornerCount += chunk.corners.size();
+    model->corners.clear();
+    model->corners.reserve(cornerCount);
+    for (ObjChunk& chunk : chunks) {
+        model->corners.insert(model->corners.end(), chunk.corners.begin(), chunk.corners.end());
+        std::vector<ObjCorner>().swap(chunk.corners);
+    }
+}
@@ -0,0 +1,28 @@
+//  Copyright © 2021 Subph. All rights reserved.
+//
+
+#pragma once
+
+#include "../common.h"
+
+class ThreadPool;
+
+// A face corner's attribute indices, 0-based into the model's arrays; -1 where it has no texcoord or normal
+struct ObjCorner {
+    int32_t position;
+    int32_t texCoord;
+    int32_t normal;
+};
+
+// Floats read with the same bits and polygons are ear clipped into the same triangles as tiny_obj_loader,
+// three corners each, in file order
+struct ObjModel {
+    std::vector<glm::vec3> positions;
+    std::vector<glm::vec3> normals;
+    std::vector<glm::vec2> texCoords;
+    std::vector<ObjCorner> corners;
+};
+
+// Splits the file at line boundaries and parses the chunks on the thread pool. Only v, vt, vn and f
+// records are read; materials, groups and the rest are skipped
+void ParseObj(const std::string filepath, ObjModel* model, ThreadPool* pThreadPool);
@@ -0,0 +1,253 @@
+//  Copyright © 2021 Subph. All rights reserved.
+//
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <cstring>
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <immintrin.h>
+#define VERTEX_SSE
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+#include <arm_neon.h>
+#define VERTEX_NEON
+#endif
+
+#include "vertex_layout.h"
+#include "../resources/hdr.h"
+
+// Four vertices per register, one lane each ==================================================
+
+#if defined(VERTEX_SSE)
+typedef __m128 Float4;
+typedef __m128 Mask4;
+static inline Float4 Load4   (const float* lanes)         { return _mm_loadu_ps(lanes); }
+static inline Float4 Set4    (float value)                { return _mm_set1_ps(value); }
+static inline Float4 Add     (Float4 a, Float4 b)         { return _mm_add_ps(a, b); }
+static inline Float4 Sub     (Float4 a, Float4 b)         { return _mm_sub_ps(a, b); }
+static inline Float4 Mul     (Float4 a, Float4 b)         { return _mm_mul_ps(a, b); }
+static inline Float4 Div     (Float4 a, Float4 b)         { return _mm_div_ps(a, b); }
+static inline Float4 Min     (Float4 a, Float4 b)         { return _mm_min_ps(a, b); }
+static inline Float4 Max     (Float4 a, Float4 b)         { return _mm_max_ps(a, b); }
+static inline Float4 Abs     (Float4 a)                   { return _mm_andnot_ps(_mm_set1_ps(-0.f), a); }
+static inline Float4 CopySign(Float4 a, Float4 sign)      { return _mm_or_ps(Abs(a), _mm_and_ps(_mm_set1_ps(-0.f), sign)); }
+static inline Mask4  Less    (Float4 a, Float4 b)         { return _mm_cmplt_ps(a, b); }
+static inline Float4 Select  (Mask4 m, Float4 a, Float4 b) { return _mm_or_ps(_mm_and_ps(m, a), _mm_andnot_ps(m, b)); }
+static inline void   StoreRounded(Float4 a, int32_t lanes[4]) { _mm_storeu_si128((__m128i*) lanes, _mm_cvtps_epi32(a)); }
+#elif defined(VERTEX_NEON)
+typedef float32x4_t Float4;
+typedef uint32x4_t  Mask4;
+static inline Float4 Load4   (const float* lanes)         { return vld1q_f32(lanes); }
+static inline Float4 Set4    (float value)                { return vdupq_n_f32(value); }
+static inline Float4 Add     (Float4 a, Float4 b)         { return vaddq_f32(a, b); }
+static inline Float4 Sub     (Float4 a, Float4 b)         { return vsubq_f32(a, b); }
+static inline Float4 Mul     (Float4 a, Float4 b)         { return vmulq_f32(a, b); }
+static inline Float4 Div     (Float4 a, Float4 b)         { return vdivq_f32(a, b); }
+static inline Float4 Min     (Float4 a, Float4 b)         { return vminq_f32(a, b); }
+static inline Float4 Max     (Float4 a, Float4 b)         { return vmaxq_f32(a, b); }
+static inline Float4 Abs     (Float4 a)                   { return vabsq_f32(a); }
+static inline Float4 CopySign(Float4 a, Float4 sign)      { return vbslq_f32(vdupq_n_u32(0x80000000u), sign, a); }
+static inline Mask4  Less    (Float4 a, Float4 b)         { return vcltq_f32(a, b); }
+static inline Float4 Select  (Mask4 m, Float4 a, Float4 b) { return vbslq_f32(m, a, b); }
+static inline void   StoreRounded(Float4 a, int32_t lanes[4]) { vst1q_s32(lanes, vcvtnq_s32_f32(a)); }
+#else
+struct Float4 { float lane[4]; };
+struct Mask4  { bool  lane[4]; };
+template <class Op> static inline Float4 Map(Float4 a, Float4 b, Op op) {
+    Float4 result;
+    for (int l = 0; l < 4; l++) result.lane[l] = op(a.lane[l], b.lane[l]);
+    return result;
+}
+static inline Float4 Load4   (const float* lanes)         { return { lanes[0], lanes[1], lanes[2], lanes[3] }; }
+static inline Float4 Set4    (float value)                { return { value, value, value, value }; }
+static inline Float4 Add     (Float4 a, Float4 b)         { return Map(a, b, [](float x, float y) { return x + y; }); }
+static inline Float4 Sub     (Float4 a, Float4 b)         { return Map(a, b, [](float x, float y) { return x - y; }); }
+static inline Float4 Mul     (Float4 a, Float4 b)         { return Map(a, b, [](float x, float y) { return x * y; }); }
+static inline Float4 Div     (Float4 a, Float4 b)         { return Map(a, b, [](float x, float y) { return x / y; }); }
+static inline Float4 Min     (Float4 a, Float4 b)         { return Map(a, b, [](float x, float y) { return std::min(x, y); }); }
+static inline Float4 Max     (Float4 a, Float4 b)         { return Map(a, b, [](float x, float y) { return std::max(x, y); }); }
+static inline Float4 Abs     (Float4 a)                   { return Map(a, a, [](float x, float) { return std::fabs(x); }); }
+static inline Float4 CopySign(Float4 a, Float4 sign)      { return Map(a, sign, [](float x, float y) { return std::copysign(x, y); }); }
+static inline Mask4  Less    (Float4 a, Float4 b) {
+    Mask4 result;
+    for (int l = 0; l < 4; l++) result.lane[l] = a.lane[l] < b.lane[l];
+    return result;
+}
+static inline Float4 Select  (Mask4 m, Float4 a, Float4 b) {
+    for (int l = 0; l < 4; l++) if (!m.lane[l]) a.lane[l] = b.lane[l];
+    return a;
+}
+static inline void   StoreRounded(Float4 a, int32_t lanes[4]) {
+    for (int l = 0; l < 4; l++) lanes[l] = int32_t(std::lrint(a.lane[l]));
+}
+#endif
+
+// Reads one component of up to four elements of a strided stream; the lanes past a short group stay zero
+static inline Float4 Gather(const float* values, size_t valueStride, size_t count) {
+    float lanes[4] = {};
+    for (size_t l = 0; l < count; l++) lanes[l] = values[l * valueStride];
+    return Load4(lanes);
+}
+
+static inline Float4 ScaleSnorm(Float4 value, float range) {
+    return Mul(Min(Max(value, Set4(-1.f)), Set4(1.f)), Set4(range));
+}
+
+template <class T> static inline void WriteStrided(char* output, size_t outputStride, size_t index, T value) {
+    memcpy(output + index * outputStride, &value, sizeof(T));
+}
+
+// Stream encoders ==================================================
+
+void QuantizeUnorm16(const float* values, size_t valueStride, size_t count, float offset, float inverseScale,
+                     void* output, size_t outputStride) {
+    char*  address = static_cast<char*>(output);
+    Float4 shift   = Set4(offset);
+    Float4 scale   = Set4(inverseScale * 65535.f);
+    for (size_t i = 0; i < count; i += 4) {
+        size_t  lanes = std::min(count - i, size_t(4));
+        Float4  value = Mul(Sub(Gather(values + i * valueStride, valueStride, lanes), shift), scale);
+        int32_t quantized[4];
+        StoreRounded(Min(Max(value, Set4(0.f)), Set4(65535.f)), quantized);
+        for (size_t l = 0; l < lanes; l++) WriteStrided(address, outputStride, i + l, uint16_t(quantized[l]));
+    }
+}
+
+// Projects onto the octahedron |x| + |y| + |z| = 1 and folds the lower half over the diagonals. A zero
+// normal divides by the smallest float instead and encodes as zero
+template <class Write> static void EncodeOctahedral(const glm::vec3* normals, size_t count, float range, Write write) {
+    for (size_t i = 0; i < count; i += 4) {
+        size_t       lanes  = std::min(count - i, size_t(4));
+        const float* first  = &normals[i].x;
+        Float4       x      = Gather(first,     3, lanes);
+        Float4       y      = Gather(first + 1, 3, lanes);
+        Float4       z      = Gather(first + 2, 3, lanes);
+        Float4       length = Max(Add(Add(Abs(x), Abs(y)), Abs(z)), Set4(FLT_MIN));
+        Float4       u      = Div(x, length);
+        Float4       v      = Div(y, length);
+        Mask4        isLower = Less(z, Set4(0.f));
+        Float4       foldedU = CopySign(Sub(Set4(1.f), Abs(v)), u);
+        Float4       foldedV = CopySign(Sub(Set4(1.f), Abs(u)), v);
+        int32_t encodedX[4], encodedY[4];
+        StoreRounded(ScaleSnorm(Select(isLower, foldedU, u), range), encodedX);
+        StoreRounded(ScaleSnorm(Select(isLower, foldedV, v), range), encodedY);
+        for (size_t l = 0; l < lanes; l++) write(i + l, encodedX[l], encodedY[l]);
+    }
+}
+
+void EncodeOctahedral16(const glm::vec3* normals, size_t count, void* output, size_t outputStride) {
+    char* address = static_cast<char*>(output);
+    EncodeOctahedral(normals, count, 32767.f, [&](size_t index, int32_t x, int32_t y) {
+        WriteStrided(address, outputStride, index, uint32_t(uint16_t(x)) | uint32_t(uint16_t(y)) << 16);
+    });
+}
+
+void EncodeOctahedral8(const glm::vec3* normals, size_t count, void* output, size_t outputStride) {
+    char* address = static_cast<char*>(output);
+    EncodeOctahedral(normals, count, 127.f, [&](size_t index, int32_t x, int32_t y) {
+        WriteStrided(address, outputStride, index, uint16_t(uint8_t(x) | uint8_t(y) << 8));
+    });
+}
+
+void PackSnorm1010102(const glm::vec3* normals, size_t count, void* output, size_t outputStride) {
+    char* address = static_cast<char*>(output);
+    for (size_t i = 0; i < count; i += 4) {
+        size_t       lanes = std::min(count - i, size_t(4));
+        const float* first = &normals[i].x;
+        int32_t x[4], y[4], z[4];
+        StoreRounded(ScaleSnorm(Gather(first,     3, lanes), 511.f), x);
+        StoreRounded(ScaleSnorm(Gather(first + 1, 3, lanes), 511.f), y);
+        StoreRounded(ScaleSnorm(Gather(first + 2, 3, lanes), 511.f), z);
+        for (size_t l = 0; l < lanes; l++)
+            WriteStrided(address, outputStride, i + l, (uint32_t(x[l]) & 0x3FF)       |
+                                                       (uint32_t(y[l]) & 0x3FF) << 10 |
+                                                       (uint32_t(z[l]) & 0x3FF) << 20);
+    }
+}
+
+void CopyStream(const void* values, size_t valueSize, size_t count, void* output, size_t outputStride) {
+    const char* source  = static_cast<const char*>(values);
+    char*       address = static_cast<char*>(output);
+    for (size_t i = 0; i < count; i++) memcpy(address + i * outputStride, source + i * valueSize, valueSize);
+}
+
+// Attribute encodings ==================================================
+
+// A flat axis keeps a unit scale, so quantizing it never divides by zero
+static glm::vec3 GetPositionExtent(const VertexStreams& streams, glm::vec3* boundsMin) {
+    glm::vec3 minimum = glm::vec3( INFINITY);
+    glm::vec3 maximum = glm::vec3(-INFINITY);
+    for (size_t i = 0; i < streams.count; i++) {
+        minimum = glm::min(minimum, streams.positions[i]);
+        maximum = glm::max(maximum, streams.positions[i]);
+    }
+    if (streams.count == 0) minimum = maximum = glm::vec3(0.f);
+    glm::vec3 extent = maximum - minimum;
+    for (int c = 0; c < 3; c++) if (extent[c] <= 0.f) extent[c] = 1.f;
+    *boundsMin = minimum;
+    return extent;
+}
+
+void PositionUnorm16::SetupDequantize(const VertexStreams& streams, VertexDequantize* dequantize) {
+    glm::vec3 boundsMin;
+    glm::vec3 extent = GetPositionExtent(streams, &boundsMin);
+    dequantize->positionScale  = glm::vec4(extent, 1.f);
+    dequantize->positionOffset = glm::vec4(boundsMin, 0.f);
+}
+
+void PositionUnorm16::Encode(const glm::vec3* positions, size_t count, const VertexDequantize& dequantize,
+                             void* output, size_t stride) {
+    char* address = static_cast<char*>(output);
+    for (int c = 0; c < 3; c++)
+        QuantizeUnorm16(&positions[0].x + c, 3, count, dequantize.positionOffset[c], 1.f / dequantize.positionScale[c],
+                        address + c * sizeof(uint16_t), stride);
+    for (size_t i = 0; i < count; i++) WriteStrided(address + 3 * sizeof(uint16_t), stride, i, uint16_t(0));
+}
+
+void PositionHalf::SetupDequantize(const VertexStreams& streams, VertexDequantize* dequantize) {
+    glm::vec3 boundsMin;
+    glm::vec3 extent = GetPositionExtent(streams, &boundsMin);
+    dequantize->positionScale  = glm::vec4(1.f);
+    dequantize->positionOffset = glm::vec4(boundsMin + extent * 0.5f, 0.f);
+}
+
+void PositionHalf::Encode(const glm::vec3* positions, size_t count, const VertexDequantize& dequantize,
+                          void* output, size_t stride) {
+    const size_t BATCH_SIZE = 64;
+    char*    address = static_cast<char*>(output);
+    float    centered[BATCH_SIZE * 4];
+    uint16_t halves  [BATCH_SIZE * 4];
+    for (size_t i = 0; i < count; i += BATCH_SIZE) {
+        size_t batchCount = std::min(count - i, BATCH_SIZE);
+        for (size_t v = 0; v < batchCount; v++) {
+            centered[v * 4 + 0] = positions[i + v].x - dequantize.positionOffset.x;
+            centered[v * 4 + 1] = positions[i + v].y - dequantize.positionOffset.y;
+            centered[v * 4 + 2] = positions[i + v].z - dequantize.positionOffset.z;
+            centered[v * 4 + 3] = 1.f;
+        }
+        ConvertHDR(centered, 4, batchCount, VK_FORMAT_R16G16B16A16_SFLOAT, halves);
+        for (size_t v = 0; v < batchCount; v++) memcpy(address + (i + v) * stride, &halves[v * 4], sizeof(Type));
+    }
+}
+
+void TexCoordUnorm16::SetupDequantize(const VertexStreams& streams, VertexDequantize* dequantize) {
+    glm::vec2 minimum = glm::vec2( INFINITY);
+    glm::vec2 maximum = glm::vec2(-INFINITY);
+    for (size_t i = 0; i < streams.count; i++) {
+        minimum = glm::min(minimum, streams.texCoords[i]);
+        maximum = glm::max(maximum, streams.texCoords[i]);
+    }
+    if (streams.count == 0) minimum = maximum = glm::vec2(0.f);
+    glm::vec2 extent = maximum - minimum;
+    for (int c = 0; c < 2; c++) if (extent[c] <= 0.f) extent[c] = 1.f;
+    dequantize->texCoordTransform = glm::vec4(extent, minimum);
+}
+
+void TexCoordUnorm16::Encode(const glm::vec2* texCoords, size_t count, const VertexDequantize& dequantize,
+                             void* output, size_t stride) {
+    const glm::vec4& transform = dequantize.texCoordTransform;
+    char* address = static_cast<char*>(output);
+    QuantizeUnorm16(&texCoords[0].x, 2, count, transform.z, 1.f / transform.x, address, stride);
+    QuantizeUnorm16(&texCoords[0].y, 2, count, transform.w, 1.f / transform.y, address + sizeof(uint16_t), stride);
+}
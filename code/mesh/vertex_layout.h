@@ -0,0 +1,184 @@
+//  Copyright © 2021 Subph. All rights reserved.
+//
+
+#pragma once
+
+#include <cstddef>
+#include <type_traits>
+
+#include "../common.h"
+
+// Vertex stage push constant: position = stored * scale + offset, texCoord = stored * xy + zw
+struct VertexDequantize {
+    glm::vec4 positionScale     = glm::vec4(1.f);
+    glm::vec4 positionOffset    = glm::vec4(0.f);
+    glm::vec4 texCoordTransform = glm::vec4(1.f, 1.f, 0.f, 0.f);
+};
+
+struct VertexStreams {
+    const glm::vec3* positions = nullptr;
+    const glm::vec3* normals   = nullptr;
+    const glm::vec2* texCoords = nullptr;
+    size_t           count     = 0;
+};
+
+// Stream encoders. Each writes one encoded element every outputStride bytes, so a call fills one attribute
+// across interleaved vertices
+
+// round((value - offset) * inverseScale * 65535), clamped; the values are every valueStride floats
+void QuantizeUnorm16   (const float* values, size_t valueStride, size_t count, float offset, float inverseScale,
+                        void* output, size_t outputStride);
+void EncodeOctahedral16(const glm::vec3* normals, size_t count, void* output, size_t outputStride); // snorm16 x, y
+void EncodeOctahedral8 (const glm::vec3* normals, size_t count, void* output, size_t outputStride); // snorm8 x, y
+void PackSnorm1010102  (const glm::vec3* normals, size_t count, void* output, size_t outputStride);
+void CopyStream        (const void* values, size_t valueSize, size_t count, void* output, size_t outputStride);
+
+// Attribute encodings ==================================================
+
+struct PositionFloat {
+    typedef glm::vec3 Type;
+    static constexpr VkFormat FORMAT = VK_FORMAT_R32G32B32_SFLOAT;
+    static void SetupDequantize(const VertexStreams&, VertexDequantize*) {}
+    static void Encode(const glm::vec3* positions, size_t count, const VertexDequantize&, void* output, size_t stride) {
+        CopyStream(positions, sizeof(glm::vec3), count, output, stride);
+    }
+};
+
+// Normalized over the mesh bounds
+struct PositionUnorm16 {
+    typedef std::array<uint16_t, 4> Type;
+    static constexpr VkFormat FORMAT = VK_FORMAT_R16G16B16A16_UNORM;
+    static void SetupDequantize(const VertexStreams& streams, VertexDequantize* dequantize);
+    static void Encode(const glm::vec3* positions, size_t count, const VertexDequantize& dequantize,
+                       void* output, size_t stride);
+};
+
+// Relative to the bounds center
+struct PositionHalf {
+    typedef std::array<uint16_t, 4> Type;
+    static constexpr VkFormat FORMAT = VK_FORMAT_R16G16B16A16_SFLOAT;
+    static void SetupDequantize(const VertexStreams& streams, VertexDequantize* dequantize);
+    static void Encode(const glm::vec3* positions, size_t count, const VertexDequantize& dequantize,
+                       void* output, size_t stride);
+};
+
+struct NormalFloat {
+    typedef glm::vec3 Type;
+    static constexpr VkFormat    FORMAT        = VK_FORMAT_R32G32B32_SFLOAT;
+    static constexpr const char* SHADER_SUFFIX = "";
+    static void Encode(const glm::vec3* normals, size_t count, void* output, size_t stride) {
+        CopyStream(normals, sizeof(glm::vec3), count, output, stride);
+    }
+};
+
+struct NormalOct16 {
+    typedef uint32_t Type;
+    static constexpr VkFormat    FORMAT        = VK_FORMAT_R16G16_SNORM;
+    static constexpr const char* SHADER_SUFFIX = "_oct";
+    static void Encode(const glm::vec3* normals, size_t count, void* output, size_t stride) {
+        EncodeOctahedral16(normals, count, output, stride);
+    }
+};
+
+struct NormalPacked {
+    typedef uint32_t Type;
+    static constexpr VkFormat    FORMAT        = VK_FORMAT_A2B10G10R10_SNORM_PACK32;
+    static constexpr const char* SHADER_SUFFIX = "";
+    static void Encode(const glm::vec3* normals, size_t count, void* output, size_t stride) {
+        PackSnorm1010102(normals, count, output, stride);
+    }
+};
+
+// Two 8-bit octahedral coordinates in the unused w lane of a PositionUnorm16; no attribute of its own
+struct NormalOct8InPosition {
+    static constexpr const char* SHADER_SUFFIX = "_octw";
+};
+
+struct TexCoordFloat {
+    typedef glm::vec2 Type;
+    static constexpr VkFormat FORMAT = VK_FORMAT_R32G32_SFLOAT;
+    static void SetupDequantize(const VertexStreams&, VertexDequantize*) {}
+    static void Encode(const glm::vec2* texCoords, size_t count, const VertexDequantize&, void* output, size_t stride) {
+        CopyStream(texCoords, sizeof(glm::vec2), count, output, stride);
+    }
+};
+
+// Normalized over the mesh's texcoord bounds, so tiling texcoords outside 0 to 1 survive
+struct TexCoordUnorm16 {
+    typedef uint32_t Type;
+    static constexpr VkFormat FORMAT = VK_FORMAT_R16G16_UNORM;
+    static void SetupDequantize(const VertexStreams& streams, VertexDequantize* dequantize);
+    static void Encode(const glm::vec2* texCoords, size_t count, const VertexDequantize& dequantize,
+                       void* output, size_t stride);
+};
+
+// Layouts ==================================================
+
+template <class Position, class Normal, class TexCoord> struct VertexStorage {
+    typename Position::Type position;
+    typename Normal  ::Type normal;
+    typename TexCoord::Type texCoord;
+};
+
+template <class Position, class TexCoord> struct VertexStorage<Position, NormalOct8InPosition, TexCoord> {
+    typename Position::Type position;
+    typename TexCoord::Type texCoord;
+};
+
+struct VertexLayoutInfo {
+    uint32_t stride;
+    std::vector<VkVertexInputAttributeDescription> attributes;
+    VertexDequantize (*getDequantize)(const VertexStreams& streams);
+    void             (*pack)(const VertexStreams& streams, const VertexDequantize& dequantize, void* address);
+    const char*      shaderSuffix;
+};
+
+// Locations 0, 1 and 2 hold position, normal and texcoord; the vertex shader variant named by the normal
+// encoding declares the same inputs
+template <class Position, class Normal, class TexCoord> struct VertexLayout {
+    typedef VertexStorage<Position, Normal, TexCoord> Vertex;
+    static constexpr bool IS_NORMAL_IN_POSITION = std::is_same<Normal, NormalOct8InPosition>::value;
+    static_assert(!IS_NORMAL_IN_POSITION || std::is_same<Position, PositionUnorm16>::value,
+                  "the normal rides in the w lane of 16-bit unorm positions only");
+
+    static std::vector<VkVertexInputAttributeDescription> GetAttributes() {
+        std::vector<VkVertexInputAttributeDescription> attributes;
+        attributes.push_back({ 0, 0, Position::FORMAT, UINT32(offsetof(Vertex, position)) });
+        if constexpr (!IS_NORMAL_IN_POSITION)
+            attributes.push_back({ 1, 0, Normal::FORMAT, UINT32(offsetof(Vertex, normal)) });
+        attributes.push_back({ 2, 0, TexCoord::FORMAT, UINT32(offsetof(Vertex, texCoord)) });
+        return attributes;
+    }
+
+    static VertexDequantize GetDequantize(const VertexStreams& streams) {
+        VertexDequantize dequantize;
+        Position::SetupDequantize(streams, &dequantize);
+        TexCoord::SetupDequantize(streams, &dequantize);
+        return dequantize;
+    }
+
+    // One stream encoder call per attribute; the normal riding in position goes after it, into the w lane
+    static void Pack(const VertexStreams& streams, const VertexDequantize& dequantize, void* address) {
+        if (streams.count == 0) return;
+        char*  vertices = static_cast<char*>(address);
+        size_t stride   = sizeof(Vertex);
+        Position::Encode(streams.positions, streams.count, dequantize, vertices + offsetof(Vertex, position), stride);
+        if constexpr (IS_NORMAL_IN_POSITION)
+            EncodeOctahedral8(streams.normals, streams.count, vertices + offsetof(Vertex, position) + 6, stride);
+        else
+            Normal::Encode(streams.normals, streams.count, vertices + offsetof(Vertex, normal), stride);
+        TexCoord::Encode(streams.texCoords, streams.count, dequantize, vertices + offsetof(Vertex, texCoord), stride);
+    }
+
+    static VertexLayoutInfo GetInfo() {
+        return { UINT32(sizeof(Vertex)), GetAttributes(), GetDequantize, Pack, Normal::SHADER_SUFFIX };
+    }
+};
+
+typedef VertexLayout<PositionFloat,   NormalFloat,          TexCoordFloat>   FloatVertexLayout;    // 32 bytes
+typedef VertexLayout<PositionUnorm16, NormalOct16,          TexCoordUnorm16> CompactVertexLayout;  // 16 bytes
+typedef VertexLayout<PositionHalf,    NormalPacked,         TexCoordUnorm16> HalfVertexLayout;     // 16 bytes
+typedef VertexLayout<PositionUnorm16, NormalOct8InPosition, TexCoordUnorm16> PackedVertexLayout;   // 12 bytes
+
+// Layout of loaded models; the main vertex shader variant follows from it
+typedef CompactVertexLayout MeshVertexLayout;
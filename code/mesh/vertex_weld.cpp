@@ -0,0 +1,127 @@
+//  Copyright © 2021 Subph. All rights reserved.
+//
+
+#include <algorithm>
+#include <cstring>
+
+#include "vertex_weld.h"
+
+#include "../thread_pool.h"
+
+#define WELD_EMPTY_SLOT        0xFFFFFFFFu
+#define WELD_MIN_RANGE_SIZE    (1 << 16)
+#define WELD_RANGES_PER_WORKER 2
+
+// Multiply-xor over the vertex's 32-bit words with a murmur finish, so the low bits index well
+static inline uint32_t HashVertex(const char* vertex, uint32_t stride) {
+    uint64_t hash = 0xCBF29CE484222325ull;
+    for (uint32_t i = 0; i < stride; i += 4) {
+        uint32_t word;
+        memcpy(&word, vertex + i, 4);
+        hash = (hash ^ word) * 0x100000001B3ull;
+    }
+    hash ^= hash >> 33;
+    hash *= 0xFF51AFD7ED558CCDull;
+    hash ^= hash >> 33;
+    return uint32_t(hash);
+}
+
+// Linear probing in a table of twice the corner count, so it never rehashes. Slots keep the full hash, so
+// most probes past other vertices skip the byte comparison
+std::vector<uint32_t> WeldVertices(const void* corners, uint32_t count, uint32_t stride, uint32_t* indices) {
+    CHECK_BOOL((stride % 4 == 0), "weld stride must be a multiple of 4 bytes!");
+    CHECK_BOOL((count <= (1u << 30)), "too many corners to weld!");
+    const char* vertices = static_cast<const char*>(corners);
+    
+    // The slot's corner already has its index written, which is the welded vertex
+    struct Slot {
+        uint32_t hash;
+        uint32_t corner;
+    };
+    uint32_t capacity = 16;
+    while (capacity < uint64_t(count) * 2) capacity <<= 1;
+    uint32_t mask = capacity - 1;
+    std::vector<Slot> table(capacity, { 0, WELD_EMPTY_SLOT });
+    
+    std::vector<uint32_t> uniqueCorners;
+    uniqueCorners.reserve(count);
+    for (uint32_t i = 0; i < count; i++) {
+        const char* vertex = vertices + size_t(i) * stride;
+        uint32_t hash = HashVertex(vertex, stride);
+        uint32_t slot = hash & mask;
+        while (table[slot].corner != WELD_EMPTY_SLOT) {
+            const char* other = vertices + size_t(table[slot].corner) * stride;
+            if (table[slot].hash == hash && memcmp(other, vertex, stride) == 0) break;
+            slot = (slot + 1) & mask;
+        }
+        
+        if (table[slot].corner == WELD_EMPTY_SLOT) {
+            table[slot] = { hash, i };
+            indices[i]  = UINT32(uniqueCorners.size());
+            uniqueCorners.push_back(i);
+        } else {
+            indices[i] = indices[table[slot].corner];
+        }
+    }
+    return uniqueCorners;
+}
+
+std::vector<uint32_t> WeldVerticesParallel(ThreadPool* pThreadPool, const void* corners, uint32_t count,
+                                           uint32_t stride, uint32_t* indices) {
+    uint32_t rangeCount = std::max(1u, std::min(count / WELD_MIN_RANGE_SIZE,
+                                                (pThreadPool->getWorkerCount() + 1) * WELD_RANGES_PER_WORKER));
+    if (rangeCount == 1) return WeldVertices(corners, count, stride, indices);
+    const char* vertices = static_cast<const char*>(corners);
+    
+    auto runRanges = [pThreadPool, rangeCount, count](std::function<void(uint32_t, uint32_t, uint32_t)> task) {
+        std::vector<std::future<void>> futures;
+        for (uint32_t i = 0; i < rangeCount; i++) {
+            uint32_t begin = uint32_t(uint64_t(count) * i / rangeCount);
+            uint32_t end   = uint32_t(uint64_t(count) * (i + 1) / rangeCount);
+            futures.push_back(pThreadPool->push([&task, i, begin, end]() { task(i, begin, end); }));
+        }
+        for (std::future<void>& future : futures) pThreadPool->wait(future);
+    };
+    
+    // Each range writes indices local to its own unique corners
+    std::vector<std::vector<uint32_t>> rangeUniques(rangeCount);
+    runRanges([&](uint32_t range, uint32_t begin, uint32_t end) {
+        rangeUniques[range] = WeldVertices(vertices + size_t(begin) * stride, end - begin, stride, indices + begin);
+        for (uint32_t& corner : rangeUniques[range]) corner += begin;
+    });
+    
+    // The ranges' unique corners in range order, packed so the merge welds them like any other corners
+    std::vector<uint32_t> rangeBases(rangeCount);
+    std::vector<uint32_t> candidates;
+    for (uint32_t i = 0; i < rangeCount; i++) {
+        rangeBases[i] = UINT32(candidates.size());
+        candidates.insert(candidates.end(), rangeUniques[i].begin(), rangeUniques[i].end());
+    }
+    uint32_t candidateCount = UINT32(candidates.size());
+    std::vector<char> packed(size_t(candidateCount) * stride);
+    for (uint32_t i = 0; i < candidateCount; i++)
+        memcpy(packed.data() + size_t(i) * stride, vertices + size_t(candidates[i]) * stride, stride);
+    
+    std::vector<uint32_t> candidateIndices(candidateCount);
+    std::vector<uint32_t> uniqueCandidates = WeldVertices(packed.data(), candidateCount, stride, candidateIndices.data());
+    
+    runRanges([&](uint32_t range, uint32_t begin, uint32_t end) {
+        const uint32_t* merged = candidateIndices.data() + rangeBases[range];
+        for (uint32_t i = begin; i < end; i++) indices[i] = merged[indices[i]];
+    });
+    
+    std::vector<uint32_t> uniqueCorners(uniqueCandidates.size());
+    for (size_t i = 0; i < uniqueCandidates.size(); i++) uniqueCorners[i] = candidates[uniqueCandidates[i]];
+    return uniqueCorners;
+}
+
+uint32_t VerifyWeld(const void* corners, uint32_t count, uint32_t stride, const uint32_t* indices,
+                    const std::vector<uint32_t>& uniqueCorners) {
+    const char* vertices = static_cast<const char*>(corners);
+    for (uint32_t i = 0; i < count; i++) {
+        if (indices[i] >= uniqueCorners.size()) return i;
+        const char* welded = vertices + size_t(uniqueCorners[indices[i]]) * stride;
+        if (memcmp(welded, vertices + size_t(i) * stride, stride) != 0) return i;
+    }
+    return count;
+}
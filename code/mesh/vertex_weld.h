@@ -0,0 +1,21 @@
+//  Copyright © 2021 Subph. All rights reserved.
+//
+
+#pragma once
+
+#include "../common.h"
+
+class ThreadPool;
+
+// Vertices are equal only when every byte matches, so distinct normals or texcoords never merge. Writes one
+// index per corner and returns the first corner of each unique vertex, in the order they first appear
+std::vector<uint32_t> WeldVertices(const void* corners, uint32_t count, uint32_t stride, uint32_t* indices);
+
+// Welds ranges of corners on the pool, then welds their unique corners together. Gives the same result as
+// WeldVertices, since a vertex first appears in the earliest range holding it
+std::vector<uint32_t> WeldVerticesParallel(ThreadPool* pThreadPool, const void* corners, uint32_t count,
+                                           uint32_t stride, uint32_t* indices);
+
+// Checks every corner against the vertex its index points at; returns the first mismatching corner or count
+uint32_t VerifyWeld(const void* corners, uint32_t count, uint32_t stride, const uint32_t* indices,
+                    const std::vector<uint32_t>& uniqueCorners);
@@ -71,8 +71,9 @@ void ComputeEquirectangular::createCubemap() {
     LOG("ComputeEquirectangular::createCubemap");
     m_pCubemap = new Image();
     m_pCubemap->setupForCubemap({ m_details.width, m_details.height });
-    m_pCubemap->m_imageInfo.format = VK_FORMAT_R32G32B32A32_SFLOAT;
-    m_pCubemap->m_imageViewInfo.format = VK_FORMAT_R32G32B32A32_SFLOAT;
+    // rgba16f is a core storage format; the packed 32-bit HDR formats need extended storage support
+    m_pCubemap->m_imageInfo.format = VK_FORMAT_R16G16B16A16_SFLOAT;
+    m_pCubemap->m_imageViewInfo.format = VK_FORMAT_R16G16B16A16_SFLOAT;
     m_pCubemap->createForCubemap();
 }
 
@@ -82,6 +83,7 @@ void ComputeEquirectangular::createEquirectangular() {
     m_pEquirectangular->setupForHDRTexture(TEXTURE_PATH);
     m_pEquirectangular->createForTexture();
     m_pEquirectangular->copyRawDataToImage();
+    System::Uploader()->wait();
 }
 
 void ComputeEquirectangular::createOutputBuffer() {
@@ -90,7 +92,8 @@ void ComputeEquirectangular::createOutputBuffer() {
     uint lengthSize = m_details.mapSize * m_details.mapSize;
     uint outputSize = 6 * lengthSize * CHANNEL * sizeof(float);
 
-    pOutput->setup(outputSize, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_SRC_BIT);
+    pOutput->setup(outputSize, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+                   Allocator::GpuOnly);
     pOutput->create();
     
     { m_pOutputBuffer = pOutput; }
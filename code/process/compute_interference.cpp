@@ -72,12 +72,13 @@ void ComputeInterference::createBuffers() {
     Size<uint> size = m_size;
     uint lengthSize = size.width * size.height;
     uint outputSize = lengthSize * CHANNEL * sizeof(float);
-    std::vector<float> outputData(lengthSize, 0.0f);
     
     Buffer* pOutput = new Buffer();
-    pOutput->setup(outputSize, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_SRC_BIT);
+    pOutput->setup(outputSize, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT |
+                               VK_BUFFER_USAGE_TRANSFER_SRC_BIT   |
+                               VK_BUFFER_USAGE_TRANSFER_DST_BIT, Allocator::GpuOnly);
     pOutput->create();
-    pOutput->fillBufferFull(outputData.data());
+    pOutput->cmdFillBuffer(0);
     
     { m_pBufferOutput = pOutput; }
 }
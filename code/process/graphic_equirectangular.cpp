@@ -13,6 +13,7 @@ void GraphicEquirectangular::cleanup() { m_cleaner.flush(); }
 void GraphicEquirectangular::createAssets()  {
     createHDR();
     createCube();
+    System::Uploader()->wait();
 }
 
 void GraphicEquirectangular::setup()  {
@@ -62,7 +63,7 @@ void GraphicEquirectangular::createRenderPass() {
     VkDevice device = System::Renderer()->getDevice();
     
     VkAttachmentDescription colorAttachment{};
-    colorAttachment.format          = VK_FORMAT_R32G32B32_SFLOAT;
+    colorAttachment.format          = VK_FORMAT_R16G16B16A16_SFLOAT;
     colorAttachment.samples         = VK_SAMPLE_COUNT_1_BIT;
     colorAttachment.loadOp          = VK_ATTACHMENT_LOAD_OP_CLEAR;
     colorAttachment.storeOp         = VK_ATTACHMENT_STORE_OP_STORE;
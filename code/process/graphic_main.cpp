@@ -4,6 +4,7 @@
 #include "graphic_main.h"
 
 #include "../system.h"
+#include "../helper.h"
 
 GraphicMain::~GraphicMain() {}
 GraphicMain::GraphicMain() {
@@ -13,12 +14,13 @@ GraphicMain::GraphicMain() {
 void GraphicMain::cleanup() {
     LOG("GraphicMain::cleanup");
     
-    for (Image* texture : m_pTextures) texture->cleanup();
+    m_pTextureSets->cleanup();
     for (Shader* shader : m_pShaders ) shader->cleanup();
     for (Shader* shader : m_pShaderCubemap ) shader->cleanup();
     m_pCubemap->cleanup();
+    if (m_pVirtualTexture != nullptr) m_pVirtualTexture->cleanup();
     
-    m_pMiscBuffer->cleanup();
+    m_pUniformRing->cleanup();
     m_pMesh->cleanup();
     m_pMeshCube->cleanup();
     m_pSwapchain->cleanup();
@@ -32,20 +34,54 @@ void GraphicMain::setup(Window* pWindow) {
     LOG("GraphicMain::setup");
     m_pWindow = pWindow;
     fillInput();
+    auto start = Time::now();
+    auto lap   = start;
+    auto split = [&lap]() {
+        auto now = Time::now();
+        float ms = TimeDif(now - lap).count() * 1000.f;
+        lap = now;
+        return ms;
+    };
+    
     createTexture();
     createCubemap();
+    uploadTextures();
+    m_pTextureTable = System::TextureTable();
+    if (m_pTextureTable != nullptr) m_materialId = m_pTextureTable->addMaterial(m_pTextures);
+    if (VirtualTexture::IsSupported()) createVirtualTexture();
+    float textureTime = split();
     createModel();
+    Uploader::Token token = System::Uploader()->submit();
+    float modelTime = split();
     createBuffers();
     reset();
+    float pipelineTime = split();
+    System::Uploader()->wait(token);
+    float uploadWaitTime = split();
+    
+    // Summed task times undercount the serial cost a little, since the cubemap task already splits its faces
+    float decodeTime = (m_decodeMicroseconds + m_pTextureSets->getDecodeMicroseconds()) / 1000.f;
+    PRINTLN1("GraphicMain::setup timing ===========================");
+    PRINTLN4("  decode + stage", textureTime, "ms, images:", m_pTextures.size() + 1);
+    PRINTLN4("  decode summed over tasks", decodeTime, "ms, workers:", System::ThreadPool()->getWorkerCount());
+    PRINTLN2("  decode speedup vs serial", (textureTime > 0.f ? decodeTime / textureTime : 0.f));
+    PRINTLN3("  meshes", modelTime, "ms");
+    PRINTLN3("  buffers + swapchain + pipelines", pipelineTime, "ms");
+    PRINTLN3("  waiting on GPU upload", uploadWaitTime, "ms");
+    PRINTLN3("  total", TimeDif(Time::now() - start).count() * 1000.f, "ms");
 }
 
 void GraphicMain::reset() {
     LOG("GraphicMain::reset");
-    if (m_pSwapchain  != nullptr) m_pSwapchain->cleanup();
-    if (m_pPipeline   != nullptr) m_pPipeline->cleanup();
-    if (m_pDescriptor != nullptr) m_pDescriptor->cleanup();
-    if (m_pPipelineCubemap != nullptr) m_pPipelineCubemap->cleanup();
-    if (m_pDescriptorCubemap != nullptr) m_pDescriptorCubemap->cleanup();
+    DeletionQueue* pDeletionQueue = System::DeletionQueue();
+    
+    // Frames already submitted keep using these; they go once those frames retire
+    pDeletionQueue->retire(m_pSwapchain);
+    pDeletionQueue->retire(m_pPipeline);
+    pDeletionQueue->retire(m_pDescriptor);
+    pDeletionQueue->retire(m_pPipelineCubemap);
+    pDeletionQueue->retire(m_pDescriptorCubemap);
+    m_currentFrame = 0;
     createSwapchain();
     createDescriptor();
     createPipeline();
@@ -53,7 +89,7 @@ void GraphicMain::reset() {
     createPipelineCubemap();
 }
 
-void GraphicMain::drawCommand(Frame* pFrame) {
+void GraphicMain::drawCommand(VkCommandBuffer commandBuffer, Frame* pFrame, uint32_t frameIndex) {
     Settings*        settings       = System::Settings();
     PipelineGraphic* pPipeline      = m_pPipeline;
     VkPipeline       pipeline       = pPipeline->m_pipeline;
@@ -68,21 +104,30 @@ void GraphicMain::drawCommand(Frame* pFrame) {
     VkBuffer vertexBuffers[] = {pMesh->m_vertexBuffer->m_buffer};
     VkBuffer indexBuffers    =  pMesh->m_indexBuffer->m_buffer;
     uint32_t indexSize       = UINT32(pMesh->m_indices.size());
+    VertexDequantize dequantize = pMesh->getDequantize();
     
     Mesh* pMeshCube = m_pMeshCube;
     VkBuffer vertexBuffersCube[] = {pMeshCube->m_vertexBuffer->m_buffer};
     VkBuffer indexBuffersCube    =  pMeshCube->m_indexBuffer->m_buffer;
     uint32_t indexSizeCube       = UINT32(pMeshCube->m_indices.size());
     
+    TextureTable*   pTextureTable   = m_pTextureTable;
+    uint32_t        materialId      = m_materialId;
+    VirtualTexture* pVirtualTexture = m_pVirtualTexture;
+    
     Descriptor* pDescriptor = m_pDescriptor;
     VkDescriptorSet bufferDescSet  = pDescriptor->getDescriptorSets(L1)[0];
-    VkDescriptorSet textureDescSet = pDescriptor->getDescriptorSets(L2)[0];
-    VkDescriptorSet frameDescSet   = pFrame->m_descriptorSet;
-    VkCommandBuffer commandBuffer  = pFrame->m_commandBuffer;
+    VkDescriptorSet textureDescSet = pTextureTable != nullptr ? pTextureTable->getDescriptorSet(frameIndex)
+                                                              : pDescriptor->getDescriptorSets(L2)[0];
+    VkDescriptorSet frameDescSet   = pDescriptor->getDescriptorSets(L0)[0];
     
     Descriptor* pDescriptorCube = m_pDescriptorCubemap;
+    VkDescriptorSet frameDescSetCube   = pDescriptorCube->getDescriptorSets(L0)[0];
     VkDescriptorSet textureDescSetCube = pDescriptorCube->getDescriptorSets(L1)[0];
     
+    uint32_t cameraOffset = UINT32(frameIndex * m_frameStride);
+    uint32_t miscOffset   = UINT32(frameIndex * m_frameStride + m_cameraRange);
+    
     float* clearColor = settings->ClearColor;
     std::array<VkClearValue, 2> clearValues{};
     clearValues[0].color = {clearColor[0], clearColor[1], clearColor[2], clearColor[3]};
@@ -92,6 +137,7 @@ void GraphicMain::drawCommand(Frame* pFrame) {
     commandBeginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
     VkResult result = vkBeginCommandBuffer(commandBuffer, &commandBeginInfo);
     CHECK_VKRESULT(result, "failed to begin recording command buffer!");
+    if (pVirtualTexture != nullptr) pVirtualTexture->cmdUpload(commandBuffer, frameIndex);
     {
         VkRenderPassBeginInfo renderBeginInfo = m_pSwapchain->getRenderBeginInfo();
         renderBeginInfo.framebuffer     = pFrame->m_framebuffer;
@@ -99,27 +145,27 @@ void GraphicMain::drawCommand(Frame* pFrame) {
         renderBeginInfo.pClearValues    = clearValues.data();
         vkCmdBeginRenderPass(commandBuffer, &renderBeginInfo, VK_SUBPASS_CONTENTS_INLINE);
         
-        VkViewport* viewport = new VkViewport();
-        viewport->x = 0.0f;
-        viewport->y = 0.0f;
-        viewport->width  = (float) m_size.width;
-        viewport->height = (float) m_size.height;
-        viewport->minDepth = 0.0f;
-        viewport->maxDepth = 1.0f;
+        VkViewport viewport{};
+        viewport.x = 0.0f;
+        viewport.y = 0.0f;
+        viewport.width  = (float) m_size.width;
+        viewport.height = (float) m_size.height;
+        viewport.minDepth = 0.0f;
+        viewport.maxDepth = 1.0f;
         
-        VkRect2D* scissor = new VkRect2D();
-        scissor->offset = {0, 0};
-        scissor->extent = extent;
+        VkRect2D scissor{};
+        scissor.offset = {0, 0};
+        scissor.extent = extent;
         
-        vkCmdSetViewport(commandBuffer, 0, 1, viewport);
-        vkCmdSetScissor (commandBuffer, 0, 1, scissor);
+        vkCmdSetViewport(commandBuffer, 0, 1, &viewport);
+        vkCmdSetScissor (commandBuffer, 0, 1, &scissor);
         
         vkCmdSetLineWidth(commandBuffer, 1.0f);
         {
             vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipelineCube);
                 
             vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS,
-                                    pipelineLayoutCube, L0, 1, &frameDescSet, 0, nullptr);
+                                    pipelineLayoutCube, L0, 1, &frameDescSetCube, 1, &cameraOffset);
             vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS,
                                     pipelineLayoutCube, L1, 1, &textureDescSetCube, 0, nullptr);
             
@@ -132,11 +178,25 @@ void GraphicMain::drawCommand(Frame* pFrame) {
             vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline);
                 
             vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS,
-                                    pipelineLayout, L0, 1, &frameDescSet, 0, nullptr);
-            vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS,
-                                    pipelineLayout, L1, 1, &bufferDescSet, 0, nullptr);
+                                    pipelineLayout, L0, 1, &frameDescSet, 1, &cameraOffset);
             vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS,
-                                    pipelineLayout, L2, 1, &textureDescSet, 0, nullptr);
+                                    pipelineLayout, L1, 1, &bufferDescSet, 1, &miscOffset);
+            if (pVirtualTexture != nullptr) {
+                uint32_t feedbackOffset = pVirtualTexture->getFeedbackOffset(frameIndex);
+                vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS,
+                                        pipelineLayout, L2, 1, &textureDescSet, 1, &feedbackOffset);
+            } else {
+                vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS,
+                                        pipelineLayout, L2, 1, &textureDescSet, 0, nullptr);
+            }
+            // One range serves both stages, so every push names both
+            VkShaderStageFlags constantStages = VK_SHADER_STAGE_VERTEX_BIT |
+                                                (pTextureTable != nullptr ? VK_SHADER_STAGE_FRAGMENT_BIT : 0);
+            vkCmdPushConstants(commandBuffer, pipelineLayout, constantStages,
+                               0, sizeof(VertexDequantize), &dequantize);
+            if (pTextureTable != nullptr)
+                vkCmdPushConstants(commandBuffer, pipelineLayout, constantStages,
+                                   sizeof(VertexDequantize), sizeof(uint32_t), &materialId);
                 
             vkCmdBindVertexBuffers(commandBuffer, 0, 1, vertexBuffers, offsets);
             vkCmdBindIndexBuffer  (commandBuffer, indexBuffers, 0, VK_INDEX_TYPE_UINT32);
@@ -147,6 +207,7 @@ void GraphicMain::drawCommand(Frame* pFrame) {
 
         vkCmdEndRenderPass(commandBuffer);
     }
+    if (pVirtualTexture != nullptr) pVirtualTexture->cmdFinishFeedback(commandBuffer);
     result = vkEndCommandBuffer(commandBuffer);
     CHECK_VKRESULT(result, "failed to record command buffer!");
 }
@@ -155,7 +216,13 @@ void GraphicMain::draw() {
     Renderer*   pRenderer  = System::Renderer();
     VkDevice    device     = pRenderer->getDevice();
     Swapchain*  pSwapchain = m_pSwapchain;
-    VkSemaphore imageSemaphore = pSwapchain->m_imageSemaphores[m_currentFrame];
+    uint32_t    frameIndex     = UINT32(m_currentFrame);
+    VkSemaphore imageSemaphore = pSwapchain->m_imageSemaphores[frameIndex];
+    VkFence     commandFence   = pSwapchain->m_commandFences  [frameIndex];
+    VkCommandBuffer commandBuffer = pSwapchain->m_commandBuffers[frameIndex];
+    
+    // The slot of this frame in flight is free once its previous submission retires
+    vkWaitForFences(device, 1, &commandFence, VK_TRUE, UINT64_MAX);
     
     uint32_t imageIndex;
     VkResult result =  vkAcquireNextImageKHR(device, pSwapchain->m_swapchain,
@@ -167,19 +234,51 @@ void GraphicMain::draw() {
     }
     
     Frame*          frame           = pSwapchain->m_frames[imageIndex];
-    VkCommandBuffer commandBuffer   = frame->m_commandBuffer;
-    VkFence         commandFence    = frame->m_commandFence;
     VkSemaphore     renderSemaphore = frame->m_renderSemaphore;
+    VkFence         imageFence      = pSwapchain->m_imageFences[imageIndex];
     CameraMatrix    cameraMatrix    = m_cameraMatrix;
     Misc            misc            = m_misc;
-    Buffer*         miscBuffer      = m_pMiscBuffer;
+    Buffer*         uniformRing     = m_pUniformRing;
+    
+    // A frame in flight may still be rendering into the image the swapchain handed back
+    if (imageFence != VK_NULL_HANDLE && imageFence != commandFence)
+        vkWaitForFences(device, 1, &imageFence, VK_TRUE, UINT64_MAX);
+    pSwapchain->m_imageFences[imageIndex] = commandFence;
+    System::Uploader()->reclaim();
+    System::DeletionQueue()->collect();
+    if (m_pVirtualTexture != nullptr) m_pVirtualTexture->update(frameIndex);
+    
+    // Keeps showing the current set until the selected one turns resident. The virtual albedo belongs to
+    // the startup set, so that set stays while it is active
+    Settings*        settings     = System::Settings();
+    TextureSetCache* pTextureSets = m_pTextureSets;
+    uint32_t         textureSet   = m_pVirtualTexture != nullptr ? m_textureSet : UINT32(settings->TextureSet);
+    bool             isTextureChanged = false;
+    pTextureSets->setBudget(VkDeviceSize(settings->TextureBudgetMB) << 20);
+    pTextureSets->request(textureSet);
+    pTextureSets->update(m_textureSet);
+    if (textureSet != m_textureSet && pTextureSets->isResident(textureSet)) {
+        m_textureSet = textureSet;
+        m_pTextures  = pTextureSets->getTextures(textureSet);
+        isTextureChanged = true;
+    }
     
-    vkWaitForFences(device, 1, &commandFence, VK_TRUE, UINT64_MAX);
+    // A finer level landed, so the texture set gets rebuilt around the unclamped views. The texture
+    // table only rewrites the material's slots, one frame set at a time
+    isTextureChanged |= Image::StreamImages(m_pTextures);
+    if (isTextureChanged) {
+        if (m_pTextureTable != nullptr) m_pTextureTable->updateMaterial(m_materialId, m_pTextures);
+        else {
+            System::DeletionQueue()->retire(m_pDescriptor);
+            createDescriptor();
+        }
+    }
+    if (m_pTextureTable != nullptr) m_pTextureTable->flush(frameIndex);
     
-    drawCommand(frame);
+    uniformRing->fillBuffer(&cameraMatrix, sizeof(CameraMatrix), UINT32(frameIndex * m_frameStride));
+    uniformRing->fillBuffer(&misc, sizeof(Misc), UINT32(frameIndex * m_frameStride + m_cameraRange));
     
-    frame->updateUniformBuffer(&cameraMatrix, sizeof(CameraMatrix));
-    miscBuffer->fillBufferFull(&misc);
+    drawCommand(commandBuffer, frame, frameIndex);
 
     VkSemaphore waitSemaphore[]   = { imageSemaphore };
     VkSemaphore signalSemaphors[] = { renderSemaphore };
@@ -198,6 +297,7 @@ void GraphicMain::draw() {
     vkResetFences(device, 1, &commandFence);
     result = vkQueueSubmit(pRenderer->m_graphicQueue, 1, &submitInfo, commandFence);
     CHECK_VKRESULT(result, "failed to submit draw command buffer!");
+    System::DeletionQueue()->submit(commandFence);
 
     
     VkSwapchainKHR swapchains[] = { pSwapchain->m_swapchain };
@@ -215,7 +315,31 @@ void GraphicMain::draw() {
         reset();
     }
     
-    m_currentFrame = (m_currentFrame + 1) % pSwapchain->m_totalFrame;
+    m_currentFrame = (m_currentFrame + 1) % pSwapchain->m_framesInFlight;
+}
+
+// Loads the whole catalogue cold through a cache of its own, all sets decoding at once as at startup
+void GraphicMain::benchTextureSets() {
+    LOG("GraphicMain::benchTextureSets");
+    Uploader* uploader = System::Uploader();
+    TextureSetCache* pTextureSets = new TextureSetCache();
+    pTextureSets->setup(TEXTURES, VkDeviceSize(TEXTURE_SET_BUDGET_MB) << 20);
+    
+    auto start = Time::now();
+    for (uint i = 0; i < TEXTURES.size(); i++) pTextureSets->request(i);
+    for (uint i = 0; i < TEXTURES.size(); i++) {
+        pTextureSets->upload(i);
+        PRINTLN4("  staged", TEXTURES[i], TimeDif(Time::now() - start).count() * 1000.f, "ms");
+    }
+    uploader->wait();
+    float totalTime  = TimeDif(Time::now() - start).count() * 1000.f;
+    float decodeTime = pTextureSets->getDecodeMicroseconds() / 1000.f;
+    
+    PRINTLN3("GraphicMain::benchTextureSets sets:", TEXTURES.size(), "========================");
+    PRINTLN3("  decode + upload", totalTime, "ms");
+    PRINTLN4("  decode summed over tasks", decodeTime, "ms, workers:", System::ThreadPool()->getWorkerCount());
+    PRINTLN2("  resident size", Allocator::GetSizeString(pTextureSets->getCachedSize()));
+    pTextureSets->cleanup();
 }
 
 void GraphicMain::setInterBuffer(Buffer* buffer) { m_pInterBuffer = buffer; }
@@ -230,30 +354,51 @@ void GraphicMain::fillInput() {
 }
 
 void GraphicMain::createTexture() {
-    std::vector<Image*> pTextures;
-    for (std::string path : TEXURES_PATH) {
-        Image* pTexture = new Image();
-        pTexture->setupForTexture(path);
-        pTexture->createForTexture();
-        pTexture->copyRawDataToImage();
-        pTextures.push_back(pTexture);
+    TextureSetCache* pTextureSets = new TextureSetCache();
+    pTextureSets->setup(TEXTURES, VkDeviceSize(TEXTURE_SET_BUDGET_MB) << 20, !VirtualTexture::IsSupported());
+    pTextureSets->request(TEX_IDX);
+    
+    {
+        m_pTextureSets = pTextureSets;
+        m_textureSet   = TEX_IDX;
+        m_pTextures    = pTextureSets->getTextures(TEX_IDX);
     }
-    { m_pTextures = pTextures; }
 }
 
 void GraphicMain::createCubemap() {
+    ThreadPool* pool = System::ThreadPool();
+    std::atomic<int64_t>* pDecodeTime  = &m_decodeMicroseconds;
+    const std::string*    cubemapPaths = CUBEMAP_PATH;
+    
     Image* pCubemap = new Image();
-    pCubemap->setupForCubemap(CUBEMAP_PATH);
-    pCubemap->createForCubemap();
-    pCubemap->copyCubemapToImage();
+    m_decodes.push_back(pool->push([pCubemap, cubemapPaths, pDecodeTime]() {
+        auto start = Time::now();
+        pCubemap->setupForCubemap(cubemapPaths);
+        *pDecodeTime += std::chrono::duration_cast<std::chrono::microseconds>(Time::now() - start).count();
+    }));
     { m_pCubemap = pCubemap; }
 }
 
+// The texture set goes up in a batch of its own, which the cache tracks; the cubemap rides the next one
+void GraphicMain::uploadTextures() {
+    m_pTextureSets->upload(m_textureSet);
+    Image::UploadImages({ m_pCubemap }, m_decodes);
+    m_decodes.clear();
+}
+
+void GraphicMain::createVirtualTexture() {
+    VirtualTexture* pVirtualTexture = new VirtualTexture();
+    pVirtualTexture->setup(VIRTUAL_TEXTURE_PATH, FRAMES_IN_FLIGHT);
+    pVirtualTexture->create();
+    { m_pVirtualTexture = pVirtualTexture; }
+}
+
 void GraphicMain::createModel() {
     m_pMesh = new Mesh();
 //    m_pMesh->createSphere(50, 50);
-    m_pMesh->createCube();
-//    m_pMesh->loadModel(MODEL_PATH.c_str());
+//    m_pMesh->createCube();
+    m_pMesh->loadModel(MODEL_PATH.c_str());
+    m_pMesh->setVertexLayout(MeshVertexLayout::GetInfo());
     m_pMesh->cmdCreateVertexBuffer();
     m_pMesh->cmdCreateIndexBuffer();
     
@@ -264,83 +409,124 @@ void GraphicMain::createModel() {
 }
 
 void GraphicMain::createBuffers() {
-    m_pMiscBuffer = new Buffer();
-    m_pMiscBuffer->setup(sizeof(Misc), VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT);
-    m_pMiscBuffer->create();
-    m_pMiscBuffer->fillBuffer(&m_misc, sizeof(Misc));
+    VkPhysicalDeviceProperties properties;
+    vkGetPhysicalDeviceProperties(System::Renderer()->getPhysicalDevice(), &properties);
+    VkDeviceSize alignment   = properties.limits.minUniformBufferOffsetAlignment;
+    VkDeviceSize cameraRange = (sizeof(CameraMatrix) + alignment - 1) / alignment * alignment;
+    VkDeviceSize miscRange   = (sizeof(Misc)         + alignment - 1) / alignment * alignment;
+    VkDeviceSize frameStride = cameraRange + miscRange;
+    
+    Buffer* pUniformRing = new Buffer();
+    pUniformRing->setup(frameStride * FRAMES_IN_FLIGHT, VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT,
+                        Allocator::DeviceMappable);
+    pUniformRing->create();
+    for (uint32_t i = 0; i < FRAMES_IN_FLIGHT; i++)
+        pUniformRing->fillBuffer(&m_misc, sizeof(Misc), UINT32(i * frameStride + cameraRange));
+    
+    {
+        m_pUniformRing = pUniformRing;
+        m_cameraRange  = cameraRange;
+        m_frameStride  = frameStride;
+    }
 }
 
 void GraphicMain::createSwapchain() {
+    VkSwapchainKHR oldSwapchain = m_pSwapchain != nullptr ? m_pSwapchain->m_swapchain : VK_NULL_HANDLE;
     m_size = m_pWindow->getFrameSize();
     m_pSwapchain = new Swapchain();
-    m_pSwapchain->setup(m_size, m_pWindow->getSurface());
+    m_pSwapchain->setup(m_size, m_pWindow->getSurface(), oldSwapchain);
     m_pSwapchain->create();
     m_pSwapchain->createRenderPass();
-    m_pSwapchain->createFrames(sizeof(CameraMatrix));
-    m_pSwapchain->createSyncObjects();
+    m_pSwapchain->createFrames();
+    m_pSwapchain->createSyncObjects(FRAMES_IN_FLIGHT);
 }
 
 void GraphicMain::createDescriptor() {
     LOG("GraphicMain::createDescriptor");
-    Buffer* pMiscBuffer = m_pMiscBuffer;
+    Buffer* pUniformRing = m_pUniformRing;
     Buffer* pInterBuffer = m_pInterBuffer;
-    Swapchain *swapchain = m_pSwapchain;
-    std::vector<Frame*> frames = swapchain->m_frames;
     std::vector<Image*> pTextures = m_pTextures;
+    VirtualTexture*     pVirtualTexture = m_pVirtualTexture;
+    bool hasTextureSet = m_pTextureTable == nullptr;
     
     Descriptor* pDescriptor = new Descriptor();
-    pDescriptor->setupLayout(L0, UINT32(frames.size()));
-    pDescriptor->addLayoutBindings(L0, B0, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER,
+    pDescriptor->setupLayout(L0);
+    pDescriptor->addLayoutBindings(L0, B0, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC,
                                    VK_SHADER_STAGE_VERTEX_BIT);
     pDescriptor->createLayout(L0);
     
     pDescriptor->setupLayout(L1);
     pDescriptor->addLayoutBindings(L1, B0, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
                                    VK_SHADER_STAGE_FRAGMENT_BIT);
-    pDescriptor->addLayoutBindings(L1, B1, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER,
+    pDescriptor->addLayoutBindings(L1, B1, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC,
                                    VK_SHADER_STAGE_FRAGMENT_BIT);
     pDescriptor->createLayout(L1);
     
-    pDescriptor->setupLayout(L2);
-    for (uint i = 0; i < pTextures.size(); i++) {
-        pDescriptor->addLayoutBindings(L2, i, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
-                                       VK_SHADER_STAGE_FRAGMENT_BIT);
+    // The page cache stands in for the albedo map; the set then starts at the normal map
+    uint firstBinding = pVirtualTexture != nullptr ? B1 : B0;
+    if (hasTextureSet) {
+        pDescriptor->setupLayout(L2);
+        for (uint i = 0; i < pTextures.size(); i++) {
+            pDescriptor->addLayoutBindings(L2, firstBinding + i, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
+                                           VK_SHADER_STAGE_FRAGMENT_BIT, pTextures[i]->getSampler());
+        }
+        if (pVirtualTexture != nullptr) {
+            pDescriptor->addLayoutBindings(L2, B0, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
+                                           VK_SHADER_STAGE_FRAGMENT_BIT, pVirtualTexture->getCacheInfo().sampler);
+            pDescriptor->addLayoutBindings(L2, B3, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
+                                           VK_SHADER_STAGE_FRAGMENT_BIT, pVirtualTexture->getPageTableSampler());
+            pDescriptor->addLayoutBindings(L2, B4, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER_DYNAMIC,
+                                           VK_SHADER_STAGE_FRAGMENT_BIT);
+        }
+        pDescriptor->createLayout(L2);
     }
-    pDescriptor->createLayout(L2);
     
     pDescriptor->createPool();
     pDescriptor->allocate(L0);
     pDescriptor->allocate(L1);
-    pDescriptor->allocate(L2);
+    if (hasTextureSet) pDescriptor->allocate(L2);
     
-    for (uint i = 0; i < frames.size(); i++) {
-        VkDescriptorBufferInfo bufferInfo = frames[i]->getBufferInfo();
-        pDescriptor->setupPointerBuffer(L0, i, B0, &bufferInfo);
-        pDescriptor->update(L0);
-        frames[i]->setDescriptorSet(pDescriptor->getDescriptorSets(L0)[i]);
-    }
+    VkDescriptorBufferInfo cameraBInfo = pUniformRing->getBufferInfo();
+    cameraBInfo.range = sizeof(CameraMatrix);
+    pDescriptor->setupPointerBuffer(L0, S0, B0, &cameraBInfo);
+    pDescriptor->update(L0);
     
     VkDescriptorBufferInfo outputBInfo = pInterBuffer->getBufferInfo();
-    VkDescriptorBufferInfo miscBInfo   = pMiscBuffer->getBufferInfo();
+    VkDescriptorBufferInfo miscBInfo   = pUniformRing->getBufferInfo();
+    miscBInfo.range = sizeof(Misc);
     pDescriptor->setupPointerBuffer(L1, S0, B0, &outputBInfo);
     pDescriptor->setupPointerBuffer(L1, S0, B1, &miscBInfo);
     pDescriptor->update(L1);
     
-    VkDescriptorImageInfo imageInfos[pTextures.size()];
-    for (uint i = 0; i < pTextures.size(); i++) {
-        imageInfos[i] = pTextures[i]->getImageInfo();
-        pDescriptor->setupPointerImage(L2, S0, i, &imageInfos[i]);
+    if (hasTextureSet) {
+        VkDescriptorImageInfo imageInfos[pTextures.size()];
+        for (uint i = 0; i < pTextures.size(); i++) {
+            imageInfos[i] = pTextures[i]->getImageInfo();
+            pDescriptor->setupPointerImage(L2, S0, firstBinding + i, &imageInfos[i]);
+        }
+        
+        VkDescriptorImageInfo  cacheInfo, pageTableInfo;
+        VkDescriptorBufferInfo feedbackInfo;
+        if (pVirtualTexture != nullptr) {
+            cacheInfo     = pVirtualTexture->getCacheInfo();
+            pageTableInfo = pVirtualTexture->getPageTableInfo();
+            feedbackInfo  = pVirtualTexture->getFeedbackInfo();
+            pDescriptor->setupPointerImage (L2, S0, B0, &cacheInfo);
+            pDescriptor->setupPointerImage (L2, S0, B3, &pageTableInfo);
+            pDescriptor->setupPointerBuffer(L2, S0, B4, &feedbackInfo);
+        }
+        pDescriptor->update(L2);
     }
-    pDescriptor->update(L2);
     
     { m_pDescriptor = pDescriptor; }
 }
 
 void GraphicMain::createPipeline() {
     LOG("GraphicMain::createPipeline");
-    Swapchain*  pSwapchain   = m_pSwapchain;
-    Descriptor* pDdescriptor = m_pDescriptor;
-    Mesh*       pMesh        = m_pMesh;
+    Swapchain*    pSwapchain    = m_pSwapchain;
+    Descriptor*   pDdescriptor  = m_pDescriptor;
+    Mesh*         pMesh         = m_pMesh;
+    TextureTable* pTextureTable = m_pTextureTable;
     
     std::vector<Shader*> shaders = m_pShaders;
     
@@ -349,10 +535,16 @@ void GraphicMain::createPipeline() {
     pPipeline->setVertexInputInfo(pMesh->createVertexInputInfo());
     
     pPipeline->setupViewportInfo(pSwapchain->m_extent);
+    // The dequantize transform for the vertex stage, followed by the bindless material id
+    if (pTextureTable != nullptr)
+        pPipeline->setupPushConstant(sizeof(VertexDequantize) + sizeof(uint32_t),
+                                     VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT);
+    else
+        pPipeline->setupPushConstant(sizeof(VertexDequantize), VK_SHADER_STAGE_VERTEX_BIT);
     pPipeline->createPipelineLayout({
         pDdescriptor->getDescriptorLayout(L0),
         pDdescriptor->getDescriptorLayout(L1),
-        pDdescriptor->getDescriptorLayout(L2)
+        pTextureTable != nullptr ? pTextureTable->getDescriptorLayout() : pDdescriptor->getDescriptorLayout(L2)
     });
     
     pPipeline->setupInputAssemblyInfo();
@@ -368,31 +560,28 @@ void GraphicMain::createPipeline() {
 
 void GraphicMain::createDescriptorCubemap() {
     LOG("GraphicMain::createDescriptorCubemap");
-    Swapchain *swapchain = m_pSwapchain;
-    std::vector<Frame*> frames = swapchain->m_frames;
-    Image* pCubemap = m_pCubemap;
+    Buffer* pUniformRing = m_pUniformRing;
+    Image*  pCubemap     = m_pCubemap;
     
     Descriptor* pDescriptor = new Descriptor();
-    pDescriptor->setupLayout(L0, UINT32(frames.size()));
-    pDescriptor->addLayoutBindings(L0, B0, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER,
+    pDescriptor->setupLayout(L0);
+    pDescriptor->addLayoutBindings(L0, B0, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC,
                                    VK_SHADER_STAGE_VERTEX_BIT);
     pDescriptor->createLayout(L0);
     
     pDescriptor->setupLayout(L1);
     pDescriptor->addLayoutBindings(L1, 0, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
-                                   VK_SHADER_STAGE_FRAGMENT_BIT);
+                                   VK_SHADER_STAGE_FRAGMENT_BIT, pCubemap->getSampler());
     pDescriptor->createLayout(L1);
     
     pDescriptor->createPool();
     pDescriptor->allocate(L0);
     pDescriptor->allocate(L1);
     
-    for (uint i = 0; i < frames.size(); i++) {
-        VkDescriptorBufferInfo bufferInfo = frames[i]->getBufferInfo();
-        pDescriptor->setupPointerBuffer(L0, i, B0, &bufferInfo);
-        pDescriptor->update(L0);
-        frames[i]->setDescriptorSet(pDescriptor->getDescriptorSets(L0)[i]);
-    }
+    VkDescriptorBufferInfo cameraBInfo = pUniformRing->getBufferInfo();
+    cameraBInfo.range = sizeof(CameraMatrix);
+    pDescriptor->setupPointerBuffer(L0, S0, B0, &cameraBInfo);
+    pDescriptor->update(L0);
     
     VkDescriptorImageInfo imageInfos = pCubemap->getImageInfo();
     pDescriptor->setupPointerImage(L1, S0, B0, &imageInfos);
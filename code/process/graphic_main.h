@@ -3,13 +3,19 @@
 
 #pragma once
 
+#include <atomic>
+#include <future>
+
 #include "../common.h"
 #include "../window/window.h"
 #include "../renderer/descriptor.h"
 #include "../renderer/swapchain.h"
 #include "../renderer/pipeline_graphic.h"
+#include "../renderer/texture_table.h"
 #include "../resources/shader.h"
 #include "../resources/buffer.h"
+#include "../resources/texture_set_cache.h"
+#include "../resources/virtual_texture.h"
 #include "../mesh/mesh.h"
 
 #define WORKGROUP_SIZE 16
@@ -30,17 +36,11 @@ class GraphicMain {
     
 public:
     const std::string MODEL_PATH = "models/bunny/bunny.obj";
-    const uint TEX_IDX = 6; // 3,4,
+    const uint TEX_IDX = 6; // 3,4, the set shown first; the rest switch in from the settings panel
     const std::vector<std::string> TEXTURES = {"cliffrockface", "cobblestylized", "greasypan", "layered-rock1", "limestone6",  "roughrockface", "rustediron", "slimy-slippery-rock1", "slipperystonework", "worn-wet-old-cobblestone"};
-    const std::string TEX_PATH = TEXTURES[TEX_IDX] + "/" + TEXTURES[TEX_IDX];
-    const std::string TEX_ALBEDO_PATH   = "textures/pbr/" + TEX_PATH + "_albedo.png";
-    const std::string TEX_AO_PATH       = "textures/pbr/" + TEX_PATH + "_ao.png";
-    const std::string TEX_METALLIC_PATH = "textures/pbr/" + TEX_PATH + "_metallic.png";
-    const std::string TEX_NORMAL_PATH   = "textures/pbr/" + TEX_PATH + "_normal.png";
-    const std::string TEX_ROUGNESS_PATH = "textures/pbr/" + TEX_PATH + "_roughness.png";
-    const std::vector<std::string> TEXURES_PATH = {
-        TEX_ALBEDO_PATH, TEX_AO_PATH, TEX_METALLIC_PATH,
-        TEX_NORMAL_PATH, TEX_ROUGNESS_PATH };
+    // With USE_VIRTUAL_TEXTURE this replaces the startup set's albedo, which is then never loaded, and the
+    // set stays fixed; any square power of two capture works
+    const std::string VIRTUAL_TEXTURE_PATH = TEXTURE_SET_DIRECTORY + TEXTURES[TEX_IDX] + "/" + TEXTURES[TEX_IDX] + "_albedo.png";
     
     const std::string CUBEMAP_PATH[6] = {
         "textures/cubemap/Lake/right.jpg",
@@ -51,6 +51,8 @@ public:
         "textures/cubemap/Lake/back.jpg"
     };
     
+    const uint32_t FRAMES_IN_FLIGHT = 2;
+    
     const VkClearValue CLEARCOLOR = {0.1f, 0.1f, 0.1f, 1.0f};
     const VkClearValue CLEARDS    = {1.0f, 0.0};
    
@@ -62,8 +64,9 @@ public:
     void setup(Window* pWindow);
     
     void draw();
+    void benchTextureSets();
     
-    void drawCommand(Frame* pFrame);
+    void drawCommand(VkCommandBuffer commandBuffer, Frame* pFrame, uint32_t frameIndex);
     
     void setInterBuffer(Buffer* buffer);
     void setShaders(std::vector<Shader*> shaders);
@@ -88,18 +91,38 @@ public:
     Mesh*  m_pMeshCube;
     Image* m_pCubemap;
     
+    // The displayed set's textures; switching swaps in another set once the cache has it resident
+    TextureSetCache*    m_pTextureSets = nullptr;
+    uint32_t            m_textureSet   = 0;
     std::vector<Image*> m_pTextures;
     
+    // Set only with the texture table; the material's textures are then read through it instead of set 2
+    TextureTable* m_pTextureTable = nullptr;
+    uint32_t      m_materialId    = 0;
+    
+    // Set only when the albedo is virtual; set 2 then holds its page cache, page table and feedback buffer
+    VirtualTexture* m_pVirtualTexture = nullptr;
+    
     Size<int> m_size;
     size_t m_currentFrame = 0;
-    Buffer* m_pMiscBuffer;
+    
+    // One slot per frame in flight: CameraMatrix then Misc, read through dynamic offsets
+    Buffer*      m_pUniformRing = nullptr;
+    VkDeviceSize m_cameraRange  = 0;
+    VkDeviceSize m_frameStride  = 0;
     Buffer* m_pInterBuffer;
     
     std::vector<Shader*> m_pShaders;
     std::vector<Shader*> m_pShaderCubemap;
     
+    // The cubemap decode in flight on the thread pool; texture sets decode through the cache
+    std::vector<std::future<void>> m_decodes;
+    std::atomic<int64_t>           m_decodeMicroseconds{0};
+    
     void createTexture();
     void createCubemap();
+    void uploadTextures();
+    void createVirtualTexture();
     void createModel();
     
     void fillInput();
@@ -0,0 +1,545 @@
+//  Copyright © 2021 Subph. All rights reserved.
+//
+
+#include <algorithm>
+#include <sstream>
+#include <iomanip>
+
+#include "allocator.h"
+
+#include "../system.h"
+
+#define SMALL_HEAP_SIZE (1024ull * 1024 * 1024)
+
+Allocator::~Allocator() {}
+Allocator::Allocator() {
+    Renderer* renderer = System::Renderer();
+    m_device           = renderer->getDevice();
+    m_physicalDevice   = renderer->getPhysicalDevice();
+}
+
+void Allocator::cleanup() {
+    LOG("Allocator::cleanup");
+    printStats();
+    printLeaks();
+    for (std::vector<MemoryBlock*>& blocks : m_blocks) {
+        for (MemoryBlock* block : blocks) destroyBlock(block);
+        blocks.clear();
+    }
+}
+
+void Allocator::setup(VkDeviceSize blockSize) {
+    m_blockSize = blockSize;
+}
+
+void Allocator::create() {
+    LOG("Allocator::create");
+    VkPhysicalDevice physicalDevice = m_physicalDevice;
+
+    VkPhysicalDeviceProperties properties;
+    vkGetPhysicalDeviceProperties(physicalDevice, &properties);
+
+    VkPhysicalDeviceMemoryProperties memoryProperties;
+    vkGetPhysicalDeviceMemoryProperties(physicalDevice, &memoryProperties);
+    
+    PFN_vkGetPhysicalDeviceMemoryProperties2KHR getMemoryProperties2 = nullptr;
+    if (System::Renderer()->hasMemoryBudget()) {
+        VkInstance instance  = System::Renderer()->getInstance();
+        getMemoryProperties2 = (PFN_vkGetPhysicalDeviceMemoryProperties2KHR)
+            vkGetInstanceProcAddr(instance, "vkGetPhysicalDeviceMemoryProperties2KHR");
+    }
+    PRINTLN2("Memory budget extension:", (getMemoryProperties2 != nullptr));
+
+    {
+        m_granularity      = std::max<VkDeviceSize>(properties.limits.bufferImageGranularity, 1);
+        m_atomSize         = std::max<VkDeviceSize>(properties.limits.nonCoherentAtomSize, 1);
+        m_memoryProperties = memoryProperties;
+        m_blocks.resize(memoryProperties.memoryTypeCount);
+        m_getMemoryProperties2 = getMemoryProperties2;
+    }
+}
+
+Allocation Allocator::allocate(VkMemoryRequirements requirements, MemoryUsage usage,
+                               bool isLinear, Strategy strategy, Category category) {
+    Allocation allocation = suballocate(requirements, usage, isLinear, strategy);
+    allocation.category   = category;
+    
+    CategoryStats& stats = m_categories[category];
+    stats.count++;
+    stats.size += allocation.size;
+    stats.peak  = std::max(stats.peak, stats.size);
+    return allocation;
+}
+
+Allocation Allocator::allocateBuffer(VkBuffer buffer, MemoryUsage usage, Strategy strategy, Category category) {
+    VkMemoryRequirements memoryRequirements;
+    vkGetBufferMemoryRequirements(m_device, buffer, &memoryRequirements);
+
+    Allocation allocation = allocate(memoryRequirements, usage, true, strategy, category);
+    vkBindBufferMemory(m_device, buffer, allocation.memory, allocation.offset);
+    return allocation;
+}
+
+Allocation Allocator::allocateImage(VkImage image, MemoryUsage usage, bool isLinear, Category category) {
+    VkMemoryRequirements memoryRequirements;
+    vkGetImageMemoryRequirements(m_device, image, &memoryRequirements);
+
+    Allocation allocation = allocate(memoryRequirements, usage, isLinear, FreeList, category);
+    vkBindImageMemory(m_device, image, allocation.memory, allocation.offset);
+    return allocation;
+}
+
+void Allocator::free(Allocation& allocation) {
+    MemoryBlock* block = allocation.block;
+    if (block == nullptr) return;
+
+    CategoryStats& stats = m_categories[allocation.category];
+    stats.count--;
+    stats.size -= allocation.size;
+
+    if (block->strategy == Linear) FreeFromLinear  (block, allocation.offset, allocation.size);
+    else                           FreeFromFreeList(block, allocation.offset);
+
+    std::vector<MemoryBlock*>& blocks = m_blocks[block->memoryTypeIndex];
+    bool isLastInPool = std::count_if(blocks.begin(), blocks.end(), [block](MemoryBlock* other) {
+        return other != block && !other->isDedicated && other->strategy == block->strategy;
+    }) == 0;
+
+    // Keep one empty block per pool so a load/unload cycle doesn't thrash vkAllocateMemory
+    if (block->count == 0 && (block->isDedicated || !isLastInPool)) {
+        blocks.erase(std::find(blocks.begin(), blocks.end(), block));
+        destroyBlock(block);
+    }
+
+    allocation = Allocation{};
+}
+
+void Allocator::flush(const Allocation& allocation, VkDeviceSize offset, VkDeviceSize size) {
+    if (allocation.block == nullptr || !isNonCoherent(allocation.block->memoryTypeIndex)) return;
+    VkMappedMemoryRange range = getMappedRange(allocation, offset, size);
+    VkResult result = vkFlushMappedMemoryRanges(m_device, 1, &range);
+    CHECK_VKRESULT(result, "failed to flush mapped memory!");
+}
+
+void Allocator::invalidate(const Allocation& allocation, VkDeviceSize offset, VkDeviceSize size) {
+    if (allocation.block == nullptr || !isNonCoherent(allocation.block->memoryTypeIndex)) return;
+    VkMappedMemoryRange range = getMappedRange(allocation, offset, size);
+    VkResult result = vkInvalidateMappedMemoryRanges(m_device, 1, &range);
+    CHECK_VKRESULT(result, "failed to invalidate mapped memory!");
+}
+
+Allocator::CategoryStats Allocator::getCategoryStats(Category category) { return m_categories[category]; }
+bool Allocator::hasMemoryBudget() { return m_getMemoryProperties2 != nullptr; }
+
+std::vector<Allocator::HeapBudget> Allocator::getHeapBudgets() {
+    const VkPhysicalDeviceMemoryProperties& properties = m_memoryProperties;
+    
+    std::vector<HeapBudget> budgets(properties.memoryHeapCount);
+    for (uint32_t i = 0; i < properties.memoryHeapCount; i++) {
+        budgets[i].size          = properties.memoryHeaps[i].size;
+        budgets[i].isDeviceLocal = properties.memoryHeaps[i].flags & VK_MEMORY_HEAP_DEVICE_LOCAL_BIT;
+    }
+    for (uint32_t i = 0; i < m_blocks.size(); i++) {
+        uint32_t heapIndex = properties.memoryTypes[i].heapIndex;
+        for (MemoryBlock* block : m_blocks[i]) budgets[heapIndex].allocated += block->size;
+    }
+    
+    if (m_getMemoryProperties2 != nullptr) {
+        VkPhysicalDeviceMemoryBudgetPropertiesEXT budgetProperties{};
+        budgetProperties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_MEMORY_BUDGET_PROPERTIES_EXT;
+        
+        VkPhysicalDeviceMemoryProperties2KHR memoryProperties{};
+        memoryProperties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_MEMORY_PROPERTIES_2_KHR;
+        memoryProperties.pNext = &budgetProperties;
+        m_getMemoryProperties2(m_physicalDevice, &memoryProperties);
+        
+        for (uint32_t i = 0; i < budgets.size(); i++) {
+            budgets[i].usage  = budgetProperties.heapUsage[i];
+            budgets[i].budget = budgetProperties.heapBudget[i];
+        }
+        return budgets;
+    }
+    
+    // Without the extension only our own blocks are visible, and drivers rarely grant more than ~80% of a heap
+    for (HeapBudget& budget : budgets) {
+        budget.usage  = budget.allocated;
+        budget.budget = budget.size / 10 * 8;
+    }
+    return budgets;
+}
+
+void Allocator::printStats() {
+    const VkPhysicalDeviceMemoryProperties& properties = m_memoryProperties;
+
+    uint32_t totalBlocks = 0;
+    PRINTLN1("Allocator::stats ==============================");
+    for (uint32_t i = 0; i < m_blocks.size(); i++) {
+        const std::vector<MemoryBlock*>& blocks = m_blocks[i];
+        if (blocks.empty()) continue;
+
+        VkDeviceSize totalSize = 0, usedSize = 0, largestFree = 0, largestFreeSum = 0;
+        uint32_t     allocations = 0, freeRanges = 0, dedicated = 0;
+        for (MemoryBlock* block : blocks) {
+            VkDeviceSize blockLargestFree = 0;
+            totalSize   += block->size;
+            usedSize    += block->used;
+            allocations += block->count;
+            dedicated   += block->isDedicated;
+            if (block->strategy == Linear) {
+                blockLargestFree = block->size - block->head;
+                freeRanges += blockLargestFree > 0;
+            }
+            else for (const MemoryRange& range : block->ranges) {
+                if (!range.isFree) continue;
+                freeRanges++;
+                blockLargestFree = std::max(blockLargestFree, range.size);
+            }
+            largestFree     = std::max(largestFree, blockLargestFree);
+            largestFreeSum += blockLargestFree;
+        }
+        // 0 when every block's free space is one contiguous range
+        VkDeviceSize freeSize      = totalSize - usedSize;
+        float        fragmentation = freeSize == 0 ? 0.f : 1.f - float(largestFreeSum) / float(freeSize);
+        totalBlocks += blocks.size();
+
+        std::stringstream stream;
+        stream << "  type " << i << " heap " << properties.memoryTypes[i].heapIndex
+               << " [" << GetPropertyString(properties.memoryTypes[i].propertyFlags) << "]"
+               << " blocks " << blocks.size() << " (" << dedicated << " dedicated)"
+               << ", allocations " << allocations
+               << ", used " << GetSizeString(usedSize) << " / " << GetSizeString(totalSize)
+               << ", free ranges " << freeRanges
+               << ", largest free " << GetSizeString(largestFree)
+               << ", fragmentation " << std::fixed << std::setprecision(3) << fragmentation;
+        PRINTLN1(stream.str());
+    }
+    PRINTLN4("  vkAllocateMemory calls", m_allocateCount, "vkFreeMemory calls", m_freeCount);
+    PRINTLN2("  live memory blocks", totalBlocks);
+    
+    for (uint32_t i = 0; i < CategoryCount; i++) {
+        const CategoryStats& stats = m_categories[i];
+        if (stats.peak == 0) continue;
+        std::stringstream stream;
+        stream << "  " << GetCategoryName(Category(i)) << ": " << stats.count << " allocations, "
+               << GetSizeString(stats.size) << " (peak " << GetSizeString(stats.peak) << ")";
+        PRINTLN1(stream.str());
+    }
+    
+    std::vector<HeapBudget> budgets = getHeapBudgets();
+    for (uint32_t i = 0; i < budgets.size(); i++) {
+        std::stringstream stream;
+        stream << "  heap " << i << (budgets[i].isDeviceLocal ? " [DeviceLocal]" : "")
+               << " usage " << GetSizeString(budgets[i].usage) << " / budget " << GetSizeString(budgets[i].budget)
+               << " (ours " << GetSizeString(budgets[i].allocated) << ", size " << GetSizeString(budgets[i].size) << ")";
+        PRINTLN1(stream.str());
+    }
+}
+
+void Allocator::printLeaks() {
+    uint32_t leakCount = 0;
+    PRINTLN1("Allocator::leaks ==============================");
+    for (uint32_t i = 0; i < CategoryCount; i++) {
+        const CategoryStats& stats = m_categories[i];
+        if (stats.count == 0) continue;
+        PRINTLN4(std::string("  ") + GetCategoryName(Category(i)), stats.count, "allocations", GetSizeString(stats.size));
+        leakCount += stats.count;
+    }
+    if (leakCount == 0) PRINTLN1("  no leaked allocations");
+    else                PRINTLN2("  total leaked allocations", leakCount);
+}
+
+
+// Private ==================================================
+
+
+Allocation Allocator::suballocate(VkMemoryRequirements requirements, MemoryUsage usage,
+                                  bool isLinear, Strategy strategy) {
+    uint32_t     memoryTypeIndex = findMemoryTypeIndex(requirements.memoryTypeBits, usage);
+    VkDeviceSize blockSize       = getBlockSize(memoryTypeIndex);
+    VkDeviceSize granularity     = m_granularity;
+    
+    // Keep non-coherent allocations on whole atoms so a flush never touches a neighbour
+    if (isNonCoherent(memoryTypeIndex)) {
+        requirements.alignment = std::max(requirements.alignment, m_atomSize);
+        requirements.size      = AlignUp(requirements.size, m_atomSize);
+    }
+
+    Allocation allocation{};
+    if (requirements.size > blockSize / 2) {
+        MemoryBlock* block = createBlock(memoryTypeIndex, requirements.size, strategy, true);
+        AllocateFromFreeList(block, requirements, isLinear, granularity, &allocation);
+        return allocation;
+    }
+
+    for (MemoryBlock* block : m_blocks[memoryTypeIndex]) {
+        if (block->isDedicated || block->strategy != strategy) continue;
+        bool found = strategy == Linear
+            ? AllocateFromLinear  (block, requirements, isLinear, granularity, &allocation)
+            : AllocateFromFreeList(block, requirements, isLinear, granularity, &allocation);
+        if (found) return allocation;
+    }
+
+    MemoryBlock* block = createBlock(memoryTypeIndex, blockSize, strategy, false);
+    bool found = strategy == Linear
+        ? AllocateFromLinear  (block, requirements, isLinear, granularity, &allocation)
+        : AllocateFromFreeList(block, requirements, isLinear, granularity, &allocation);
+    CHECK_BOOL(found, "failed to suballocate from new memory block!");
+    return allocation;
+}
+
+uint32_t Allocator::findMemoryTypeIndex(uint32_t typeBits, MemoryUsage usage) {
+    const VkPhysicalDeviceMemoryProperties& properties = m_memoryProperties;
+    
+    for (const MemoryPreference& preference : GetMemoryPreferences(usage)) {
+        int fallback = -1;
+        for (uint32_t i = 0; i < properties.memoryTypeCount; i++) {
+            VkMemoryPropertyFlags flags = properties.memoryTypes[i].propertyFlags;
+            if (!(typeBits & (1 << i)) || (flags & preference.required) != preference.required) continue;
+            if (!(flags & preference.avoided)) return i;
+            if (fallback < 0) fallback = i;
+        }
+        if (fallback > -1) return fallback;
+    }
+    
+    RUNTIME_ERROR("failed to find suitable memory type!");
+}
+
+bool Allocator::isNonCoherent(uint32_t memoryTypeIndex) {
+    VkMemoryPropertyFlags flags = m_memoryProperties.memoryTypes[memoryTypeIndex].propertyFlags;
+    return (flags & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT) && !(flags & VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+}
+
+VkMappedMemoryRange Allocator::getMappedRange(const Allocation& allocation, VkDeviceSize offset, VkDeviceSize size) {
+    VkDeviceSize atomSize = m_atomSize;
+    VkDeviceSize end      = size == VK_WHOLE_SIZE ? allocation.size : std::min(offset + size, allocation.size);
+    VkDeviceSize begin    = allocation.offset + offset;
+    
+    end   = std::min(AlignUp(allocation.offset + end, atomSize), allocation.block->size);
+    begin = begin / atomSize * atomSize;
+    
+    VkMappedMemoryRange range{};
+    range.sType  = VK_STRUCTURE_TYPE_MAPPED_MEMORY_RANGE;
+    range.memory = allocation.memory;
+    range.offset = begin;
+    range.size   = end - begin;
+    return range;
+}
+
+VkDeviceSize Allocator::getBlockSize(uint32_t memoryTypeIndex) {
+    uint32_t     heapIndex = m_memoryProperties.memoryTypes[memoryTypeIndex].heapIndex;
+    VkDeviceSize heapSize  = m_memoryProperties.memoryHeaps[heapIndex].size;
+    return heapSize <= SMALL_HEAP_SIZE ? std::min(m_blockSize, heapSize / 8) : m_blockSize;
+}
+
+MemoryBlock* Allocator::createBlock(uint32_t memoryTypeIndex, VkDeviceSize size, Strategy strategy, bool isDedicated) {
+    LOG("Allocator::createBlock");
+    VkDevice              device     = m_device;
+    VkMemoryPropertyFlags properties = m_memoryProperties.memoryTypes[memoryTypeIndex].propertyFlags;
+
+    VkMemoryAllocateInfo allocInfo{};
+    allocInfo.sType           = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+    allocInfo.allocationSize  = size;
+    allocInfo.memoryTypeIndex = memoryTypeIndex;
+
+    VkDeviceMemory memory;
+    VkResult       result = vkAllocateMemory(device, &allocInfo, nullptr, &memory);
+    CHECK_VKRESULT(result, "failed to allocate memory block!");
+
+    void* mapped = nullptr;
+    if (properties & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT) {
+        result = vkMapMemory(device, memory, 0, VK_WHOLE_SIZE, 0, &mapped);
+        CHECK_VKRESULT(result, "failed to map memory block!");
+    }
+
+    MemoryBlock* block = new MemoryBlock();
+    block->memory          = memory;
+    block->size            = size;
+    block->memoryTypeIndex = memoryTypeIndex;
+    block->strategy        = isDedicated ? FreeList : strategy;
+    block->isDedicated     = isDedicated;
+    block->mapped          = mapped;
+    block->ranges.push_back({ 0, size, true, true });
+
+    {
+        m_allocateCount++;
+        m_blocks[memoryTypeIndex].push_back(block);
+    }
+    return block;
+}
+
+void Allocator::destroyBlock(MemoryBlock* block) {
+    if (block->mapped != nullptr) vkUnmapMemory(m_device, block->memory);
+    vkFreeMemory(m_device, block->memory, nullptr);
+    delete block;
+    m_freeCount++;
+}
+
+bool Allocator::AllocateFromFreeList(MemoryBlock* block, VkMemoryRequirements requirements,
+                                     bool isLinear, VkDeviceSize granularity, Allocation* allocation) {
+    std::vector<MemoryRange>& ranges = block->ranges;
+
+    int          bestIndex  = -1;
+    VkDeviceSize bestOffset = 0;
+    for (int i = 0; i < ranges.size(); i++) {
+        const MemoryRange& range = ranges[i];
+        if (!range.isFree || range.size < requirements.size) continue;
+        if (bestIndex > -1 && range.size >= ranges[bestIndex].size) continue;
+
+        VkDeviceSize offset = AlignUp(range.offset, requirements.alignment);
+
+        // Neighbours of a free range are always in use, so only they can conflict on granularity
+        if (i > 0) {
+            const MemoryRange& prev = ranges[i - 1];
+            if (prev.isLinear != isLinear && OnSamePage(prev.offset + prev.size - 1, offset, granularity))
+                offset = AlignUp(offset, granularity);
+        }
+        VkDeviceSize end = offset + requirements.size;
+        if (end > range.offset + range.size) continue;
+
+        if (i + 1 < ranges.size()) {
+            const MemoryRange& next = ranges[i + 1];
+            if (next.isLinear != isLinear && OnSamePage(end - 1, next.offset, granularity)) continue;
+        }
+        bestIndex  = i;
+        bestOffset = offset;
+    }
+    if (bestIndex < 0) return false;
+
+    MemoryRange  range = ranges[bestIndex];
+    VkDeviceSize end   = bestOffset + requirements.size;
+
+    std::vector<MemoryRange> split;
+    if (bestOffset > range.offset)      split.push_back({ range.offset, bestOffset - range.offset, true, true });
+    split.push_back({ bestOffset, requirements.size, false, isLinear });
+    if (end < range.offset + range.size) split.push_back({ end, range.offset + range.size - end, true, true });
+
+    ranges.erase (ranges.begin() + bestIndex);
+    ranges.insert(ranges.begin() + bestIndex, split.begin(), split.end());
+
+    block->count++;
+    block->used += requirements.size;
+
+    allocation->memory = block->memory;
+    allocation->offset = bestOffset;
+    allocation->size   = requirements.size;
+    allocation->mapped = block->mapped ? static_cast<char*>(block->mapped) + bestOffset : nullptr;
+    allocation->block  = block;
+    return true;
+}
+
+bool Allocator::AllocateFromLinear(MemoryBlock* block, VkMemoryRequirements requirements,
+                                   bool isLinear, VkDeviceSize granularity, Allocation* allocation) {
+    VkDeviceSize offset = AlignUp(block->head, requirements.alignment);
+    if (block->count > 0 && block->lastLinear != isLinear && OnSamePage(block->head - 1, offset, granularity))
+        offset = AlignUp(offset, granularity);
+    if (offset + requirements.size > block->size) return false;
+
+    block->head       = offset + requirements.size;
+    block->lastLinear = isLinear;
+    block->count++;
+    block->used += requirements.size;
+
+    allocation->memory = block->memory;
+    allocation->offset = offset;
+    allocation->size   = requirements.size;
+    allocation->mapped = block->mapped ? static_cast<char*>(block->mapped) + offset : nullptr;
+    allocation->block  = block;
+    return true;
+}
+
+void Allocator::FreeFromFreeList(MemoryBlock* block, VkDeviceSize offset) {
+    std::vector<MemoryRange>& ranges = block->ranges;
+    auto it = std::lower_bound(ranges.begin(), ranges.end(), offset, [](const MemoryRange& range, VkDeviceSize value) {
+        return range.offset < value;
+    });
+    CHECK_BOOL((it != ranges.end() && it->offset == offset && !it->isFree), "freeing unknown allocation!");
+
+    block->count--;
+    block->used -= it->size;
+    it->isFree   = true;
+    it->isLinear = true;
+
+    if (it + 1 != ranges.end() && (it + 1)->isFree) {
+        it->size += (it + 1)->size;
+        ranges.erase(it + 1);
+    }
+    if (it != ranges.begin() && (it - 1)->isFree) {
+        (it - 1)->size += it->size;
+        ranges.erase(it);
+    }
+}
+
+void Allocator::FreeFromLinear(MemoryBlock* block, VkDeviceSize offset, VkDeviceSize size) {
+    block->count--;
+    block->used -= size;
+    if (block->count == 0)               block->head = 0;
+    else if (offset + size == block->head) block->head = offset;
+}
+
+// Ordered best first; a type carrying an avoided flag is only taken when nothing cleaner matches
+std::vector<Allocator::MemoryPreference> Allocator::GetMemoryPreferences(MemoryUsage usage) {
+    const VkMemoryPropertyFlags deviceLocal  = VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT;
+    const VkMemoryPropertyFlags hostVisible  = VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT;
+    const VkMemoryPropertyFlags hostCoherent = VK_MEMORY_PROPERTY_HOST_COHERENT_BIT;
+    const VkMemoryPropertyFlags hostCached   = VK_MEMORY_PROPERTY_HOST_CACHED_BIT;
+    
+    switch (usage) {
+        case GpuOnly: return {
+            { deviceLocal, hostVisible },
+            { 0          , 0           } };
+        case CpuToGpu: return {
+            { hostVisible | hostCoherent, deviceLocal },
+            { hostVisible               , deviceLocal } };
+        case GpuToCpu: return {
+            { hostVisible | hostCached  , 0 },
+            { hostVisible | hostCoherent, 0 },
+            { hostVisible               , 0 } };
+        case DeviceMappable: return {
+            { deviceLocal | hostVisible | hostCoherent, 0           },
+            { deviceLocal | hostVisible               , 0           },
+            { hostVisible | hostCoherent              , deviceLocal },
+            { hostVisible                             , deviceLocal } };
+    }
+    return {};
+}
+
+VkDeviceSize Allocator::AlignUp(VkDeviceSize value, VkDeviceSize alignment) {
+    if (alignment <= 1) return value;
+    return (value + alignment - 1) / alignment * alignment;
+}
+
+bool Allocator::OnSamePage(VkDeviceSize endOffset, VkDeviceSize startOffset, VkDeviceSize pageSize) {
+    if (pageSize <= 1) return false;
+    return (endOffset & ~(pageSize - 1)) == (startOffset & ~(pageSize - 1));
+}
+
+const char* Allocator::GetCategoryName(Category category) {
+    switch (category) {
+        case Texture   : return "Texture";
+        case Mesh      : return "Mesh";
+        case Staging   : return "Staging";
+        case Uniform   : return "Uniform";
+        case Compute   : return "Compute";
+        case Attachment: return "Attachment";
+        default        : return "Other";
+    }
+}
+
+std::string Allocator::GetSizeString(VkDeviceSize size) {
+    std::stringstream stream;
+    stream << std::fixed << std::setprecision(2);
+    if      (size >= 1024 * 1024) stream << size / (1024.0 * 1024.0) << "MB";
+    else if (size >= 1024)        stream << size / 1024.0 << "KB";
+    else                          stream << size << "B";
+    return stream.str();
+}
+
+std::string Allocator::GetPropertyString(VkMemoryPropertyFlags flags) {
+    std::string text;
+    if (flags & VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT ) text += "DeviceLocal ";
+    if (flags & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT ) text += "HostVisible ";
+    if (flags & VK_MEMORY_PROPERTY_HOST_COHERENT_BIT) text += "HostCoherent ";
+    if (flags & VK_MEMORY_PROPERTY_HOST_CACHED_BIT  ) text += "HostCached ";
+    if (!text.empty()) text.pop_back();
+    return text;
+}
@@ -0,0 +1,139 @@
+//  Copyright © 2021 Subph. All rights reserved.
+//
+
+#pragma once
+
+#include "../common.h"
+
+struct MemoryBlock;
+
+struct Allocation {
+    VkDeviceMemory memory = VK_NULL_HANDLE;
+    VkDeviceSize   offset = 0;
+    VkDeviceSize   size   = 0;
+    void*          mapped = nullptr;
+    MemoryBlock*   block  = nullptr;
+    uint32_t       category = 0;
+};
+
+class Allocator {
+
+public:
+    ~Allocator();
+    Allocator();
+
+    enum Strategy    { FreeList = 0, Linear = 1 };
+    enum MemoryUsage { GpuOnly = 0, CpuToGpu = 1, GpuToCpu = 2, DeviceMappable = 3 };
+    enum Category    { Other = 0, Texture = 1, Mesh = 2, Staging = 3, Uniform = 4, Compute = 5,
+                       Attachment = 6, CategoryCount = 7 };
+
+    struct CategoryStats {
+        uint32_t     count = 0;
+        VkDeviceSize size  = 0;
+        VkDeviceSize peak  = 0;
+    };
+
+    struct HeapBudget {
+        VkDeviceSize size          = 0;
+        VkDeviceSize usage         = 0;
+        VkDeviceSize budget        = 0;
+        VkDeviceSize allocated     = 0;
+        bool         isDeviceLocal = false;
+    };
+
+    void cleanup();
+
+    void setup(VkDeviceSize blockSize);
+    void create();
+
+    Allocation allocate(VkMemoryRequirements requirements, MemoryUsage usage,
+                        bool isLinear, Strategy strategy = FreeList, Category category = Other);
+    Allocation allocateBuffer(VkBuffer buffer, MemoryUsage usage, Strategy strategy = FreeList,
+                              Category category = Other);
+    Allocation allocateImage (VkImage  image , MemoryUsage usage, bool isLinear = false,
+                              Category category = Other);
+    void free(Allocation& allocation);
+    
+    void flush     (const Allocation& allocation, VkDeviceSize offset, VkDeviceSize size);
+    void invalidate(const Allocation& allocation, VkDeviceSize offset, VkDeviceSize size);
+
+    CategoryStats           getCategoryStats(Category category);
+    std::vector<HeapBudget> getHeapBudgets();
+    bool                    hasMemoryBudget();
+
+    void printStats();
+    void printLeaks();
+
+    static const char* GetCategoryName(Category category);
+    static std::string GetSizeString(VkDeviceSize size);
+
+private:
+
+    VkDevice         m_device         = VK_NULL_HANDLE;
+    VkPhysicalDevice m_physicalDevice = VK_NULL_HANDLE;
+
+    VkDeviceSize m_blockSize   = 64 * 1024 * 1024;
+    VkDeviceSize m_granularity = 1;
+    VkDeviceSize m_atomSize    = 1;
+    VkPhysicalDeviceMemoryProperties m_memoryProperties{};
+
+    std::vector<std::vector<MemoryBlock*>> m_blocks;
+
+    uint32_t m_allocateCount = 0;
+    uint32_t m_freeCount     = 0;
+
+    CategoryStats m_categories[CategoryCount];
+    PFN_vkGetPhysicalDeviceMemoryProperties2KHR m_getMemoryProperties2 = nullptr;
+
+    struct MemoryPreference {
+        VkMemoryPropertyFlags required;
+        VkMemoryPropertyFlags avoided;
+    };
+
+    Allocation   suballocate(VkMemoryRequirements requirements, MemoryUsage usage,
+                             bool isLinear, Strategy strategy);
+    uint32_t     findMemoryTypeIndex(uint32_t typeBits, MemoryUsage usage);
+    bool         isNonCoherent(uint32_t memoryTypeIndex);
+    VkMappedMemoryRange getMappedRange(const Allocation& allocation, VkDeviceSize offset, VkDeviceSize size);
+    VkDeviceSize getBlockSize(uint32_t memoryTypeIndex);
+    MemoryBlock* createBlock (uint32_t memoryTypeIndex, VkDeviceSize size, Strategy strategy, bool isDedicated);
+    void         destroyBlock(MemoryBlock* block);
+
+    static bool AllocateFromFreeList(MemoryBlock* block, VkMemoryRequirements requirements,
+                                     bool isLinear, VkDeviceSize granularity, Allocation* allocation);
+    static bool AllocateFromLinear  (MemoryBlock* block, VkMemoryRequirements requirements,
+                                     bool isLinear, VkDeviceSize granularity, Allocation* allocation);
+    static void FreeFromFreeList(MemoryBlock* block, VkDeviceSize offset);
+    static void FreeFromLinear  (MemoryBlock* block, VkDeviceSize offset, VkDeviceSize size);
+
+    static std::vector<MemoryPreference> GetMemoryPreferences(MemoryUsage usage);
+    static VkDeviceSize AlignUp(VkDeviceSize value, VkDeviceSize alignment);
+    static bool OnSamePage(VkDeviceSize endOffset, VkDeviceSize startOffset, VkDeviceSize pageSize);
+    static std::string GetPropertyString(VkMemoryPropertyFlags flags);
+};
+
+struct MemoryRange {
+    VkDeviceSize offset   = 0;
+    VkDeviceSize size     = 0;
+    bool         isFree   = true;
+    bool         isLinear = true;
+};
+
+struct MemoryBlock {
+    VkDeviceMemory     memory          = VK_NULL_HANDLE;
+    VkDeviceSize       size            = 0;
+    uint32_t           memoryTypeIndex = 0;
+    Allocator::Strategy strategy       = Allocator::FreeList;
+    bool               isDedicated     = false;
+    void*              mapped          = nullptr;
+
+    // FreeList: sorted by offset, covers the whole block
+    std::vector<MemoryRange> ranges;
+
+    // Linear: bump pointer, rewinds when the block drains
+    VkDeviceSize head       = 0;
+    bool         lastLinear = true;
+
+    uint32_t     count      = 0;
+    VkDeviceSize used       = 0;
+};
@@ -92,3 +92,31 @@ void Commander::endSingleTimeCommands(VkCommandBuffer commandBuffer) {
     
     vkFreeCommandBuffers(device, commandPool, 1, &commandBuffer);
 }
+
+void Commander::submitCommands(VkCommandBuffer commandBuffer, VkFence fence,
+                               VkSemaphore waitSemaphore, VkSemaphore signalSemaphore,
+                               VkPipelineStageFlags waitStage) {
+    LOG("submitCommands");
+    vkEndCommandBuffer(commandBuffer);
+    
+    VkSubmitInfo submitInfo{};
+    submitInfo.sType              = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+    submitInfo.commandBufferCount = 1;
+    submitInfo.pCommandBuffers    = &commandBuffer;
+    if (waitSemaphore != VK_NULL_HANDLE) {
+        submitInfo.waitSemaphoreCount = 1;
+        submitInfo.pWaitSemaphores    = &waitSemaphore;
+        submitInfo.pWaitDstStageMask  = &waitStage;
+    }
+    if (signalSemaphore != VK_NULL_HANDLE) {
+        submitInfo.signalSemaphoreCount = 1;
+        submitInfo.pSignalSemaphores    = &signalSemaphore;
+    }
+    
+    VkResult result = vkQueueSubmit(m_queue, 1, &submitInfo, fence);
+    CHECK_VKRESULT(result, "failed to submit command buffer!");
+}
+
+void Commander::freeCommandBuffer(VkCommandBuffer commandBuffer) {
+    vkFreeCommandBuffers(m_device, m_commandPool, 1, &commandBuffer);
+}
@@ -22,6 +22,12 @@ public:
     void beginSingleTimeCommands(VkCommandBuffer commandBuffer);
     void endSingleTimeCommands  (VkCommandBuffer commandBuffer);
     
+    void submitCommands   (VkCommandBuffer commandBuffer, VkFence fence,
+                           VkSemaphore waitSemaphore   = VK_NULL_HANDLE,
+                           VkSemaphore signalSemaphore = VK_NULL_HANDLE,
+                           VkPipelineStageFlags waitStage = VK_PIPELINE_STAGE_ALL_COMMANDS_BIT);
+    void freeCommandBuffer(VkCommandBuffer commandBuffer);
+    
 private:
     
     VkDevice      m_device      = VK_NULL_HANDLE;
@@ -0,0 +1,66 @@
+//  Copyright © 2021 Subph. All rights reserved.
+//
+
+#include "deletion_queue.h"
+
+#include "../system.h"
+
+DeletionQueue::~DeletionQueue() {}
+DeletionQueue::DeletionQueue() {
+    m_device = System::Renderer()->getDevice();
+}
+
+void DeletionQueue::cleanup() {
+    LOG("DeletionQueue::cleanup");
+    flush();
+    PRINTLN4("DeletionQueue retired", m_retiredCount, "destroyed", m_destroyedCount);
+}
+
+// Call right after queueing work that signals the fence, before the fence is reset again
+DeletionQueue::Serial DeletionQueue::submit(VkFence fence) {
+    Serial serial = ++m_submitted;
+    m_submissions.push_back({ serial, fence });
+    m_inFlight.insert(serial);
+    return serial;
+}
+
+// Whatever is being recorded now lands in the next submission, so wait for that one too
+void DeletionQueue::retire(std::function<void()>&& destroy) {
+    m_retired.push_back({ m_submitted + 1, destroy });
+    m_retiredCount++;
+}
+
+void DeletionQueue::collect() {
+    VkDevice device = m_device;
+
+    // A reset fence reads unsignaled until its next submission finishes, which only delays the collect
+    for (auto it = m_submissions.begin(); it != m_submissions.end();) {
+        if (vkGetFenceStatus(device, it->fence) != VK_SUCCESS) { it++; continue; }
+        m_inFlight.erase(it->serial);
+        it = m_submissions.erase(it);
+    }
+
+    Serial completed = m_inFlight.empty() ? m_submitted : *m_inFlight.begin() - 1;
+    while (!m_retired.empty() && m_retired.front().serial <= completed) {
+        m_retired.front().destroy();
+        m_retired.pop_front();
+        m_destroyedCount++;
+    }
+
+    { m_completed = completed; }
+}
+
+// Only for teardown: the caller must have idled the device first
+void DeletionQueue::flush() {
+    m_submissions.clear();
+    m_inFlight.clear();
+    while (!m_retired.empty()) {
+        m_retired.front().destroy();
+        m_retired.pop_front();
+        m_destroyedCount++;
+    }
+    m_completed = m_submitted;
+}
+
+DeletionQueue::Serial DeletionQueue::getSubmitted() { return m_submitted; }
+DeletionQueue::Serial DeletionQueue::getCompleted() { return m_completed; }
@@ -0,0 +1,57 @@
+//  Copyright © 2021 Subph. All rights reserved.
+//
+
+#pragma once
+
+#include <deque>
+#include <set>
+
+#include "../common.h"
+
+class DeletionQueue {
+
+public:
+    ~DeletionQueue();
+    DeletionQueue();
+
+    typedef uint64_t Serial;
+
+    void cleanup();
+
+    Serial submit (VkFence fence);
+    void   retire (std::function<void()>&& destroy);
+    void   collect();
+    void   flush  ();
+
+    template <class T> void retire(T* pObject) {
+        if (pObject == nullptr) return;
+        retire([pObject]() { pObject->cleanup(); delete pObject; });
+    }
+
+    Serial getSubmitted();
+    Serial getCompleted();
+
+private:
+
+    VkDevice m_device = VK_NULL_HANDLE;
+
+    struct Submission {
+        Serial  serial;
+        VkFence fence;
+    };
+
+    struct Retired {
+        Serial                serial;
+        std::function<void()> destroy;
+    };
+
+    Serial m_submitted = 0;
+    Serial m_completed = 0;
+
+    std::deque<Submission> m_submissions;
+    std::set<Serial>       m_inFlight;
+    std::deque<Retired>    m_retired;
+
+    uint32_t m_retiredCount   = 0;
+    uint32_t m_destroyedCount = 0;
+};
@@ -25,7 +25,8 @@ void Descriptor::setupLayout(uint id, uint count) {
     m_dataMap[id] = DescriptorSetData{ .id = id, .count = count };
 }
 
-void Descriptor::addLayoutBindings(uint id, uint binding, VkDescriptorType type, VkShaderStageFlags flags) {
+void Descriptor::addLayoutBindings(uint id, uint binding, VkDescriptorType type, VkShaderStageFlags flags,
+                                   VkSampler immutableSampler) {
     if (!m_dataMap.count(id)) setupLayout(id);
     if (!m_poolSizesMap.count(type)) m_poolSizesMap[type] = VkDescriptorPoolSize{ type, 0 };
     
@@ -47,6 +48,7 @@ void Descriptor::addLayoutBindings(uint id, uint binding, VkDescriptorType type,
     
     {
         m_dataMap[id].layoutBindings.push_back(layoutBinding);
+        m_dataMap[id].immutableSamplers.push_back(immutableSampler);
         m_dataMap[id].writeSets.push_back(writeSet);
         m_poolSizesMap[type].descriptorCount += m_dataMap[id].count;
     }
@@ -57,10 +59,17 @@ void Descriptor::createLayout(uint id) {
     VkDevice          device = m_device;
     DescriptorSetData data   = m_dataMap[id];
     
+    // Pointed at only here, once the sampler list stops growing
+    std::vector<VkDescriptorSetLayoutBinding> layoutBindings = data.layoutBindings;
+    for (uint i = 0; i < layoutBindings.size(); i++) {
+        if (data.immutableSamplers[i] == VK_NULL_HANDLE) continue;
+        layoutBindings[i].pImmutableSamplers = &data.immutableSamplers[i];
+    }
+    
     VkDescriptorSetLayoutCreateInfo layoutInfo{};
     layoutInfo.sType        = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
-    layoutInfo.bindingCount = UINT32(data.layoutBindings.size());
-    layoutInfo.pBindings    = data.layoutBindings.data();
+    layoutInfo.bindingCount = UINT32(layoutBindings.size());
+    layoutInfo.pBindings    = layoutBindings.data();
     
     VkResult result = vkCreateDescriptorSetLayout(device, &layoutInfo, nullptr, &data.layout);
     CHECK_VKRESULT(result, "failed to create descriptor set layout!");
@@ -19,7 +19,9 @@ public:
     
     void setupLayout(uint layoutId, uint count = 1);
     void createLayout(uint layoutId);
-    void addLayoutBindings(uint layoutId, uint binding, VkDescriptorType type, VkShaderStageFlags flags);
+    // An immutable sampler is baked into the layout; writes to that binding then only carry the image view
+    void addLayoutBindings(uint layoutId, uint binding, VkDescriptorType type, VkShaderStageFlags flags,
+                           VkSampler immutableSampler = VK_NULL_HANDLE);
     
     void createPool();
     
@@ -43,6 +45,7 @@ private:
         VkDescriptorSetLayout layout  = VK_NULL_HANDLE;
         std::vector<VkDescriptorSet> descriptorSets;
         std::vector<VkDescriptorSetLayoutBinding> layoutBindings;
+        std::vector<VkSampler> immutableSamplers;
         std::vector<VkWriteDescriptorSet> writeSets;
     };
     
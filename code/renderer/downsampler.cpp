@@ -0,0 +1,206 @@
+//  Copyright © 2021 Subph. All rights reserved.
+//
+
+#include "downsampler.h"
+
+#include "../system.h"
+
+#define DOWNSAMPLE_GROUP_SIZE 8
+
+Downsampler::~Downsampler() {}
+Downsampler::Downsampler() {
+    m_device = System::Renderer()->getDevice();
+}
+
+void Downsampler::cleanup() {
+    LOG("Downsampler::cleanup");
+    for (auto& entry : m_pPipelines) {
+        entry.second->cleanup();
+        delete entry.second;
+    }
+    m_pPipelines.clear();
+    m_pLayoutDescriptor->cleanup();
+    delete m_pLayoutDescriptor;
+}
+
+void Downsampler::create() {
+    LOG("Downsampler::create");
+    Descriptor* pDescriptor = createDescriptor(1);
+    pDescriptor->createLayout(L0);
+    { m_pLayoutDescriptor = pDescriptor; }
+}
+
+// Levels run in lockstep across images: level i reads i - 1 through storage images, both kept in GENERAL
+void Downsampler::cmdGenerateMipmaps(VkCommandBuffer commandBuffer, std::vector<Image*> pImages) {
+    LOG("Downsampler::cmdGenerateMipmaps");
+    uint32_t maxLevels = 1;
+    std::vector<Descriptor*>          pDescriptors;
+    std::vector<VkImageView>          views;
+    std::vector<VkImageMemoryBarrier> barriers;
+
+    for (Image* pImage : pImages) {
+        uint32_t levelCount = pImage->m_imageInfo.mipLevels;
+        uint32_t layerCount = pImage->m_imageInfo.arrayLayers;
+        maxLevels = std::max(maxLevels, levelCount);
+
+        std::vector<VkImageView> levelViews;
+        for (uint32_t level = 0; level < levelCount; level++)
+            for (uint32_t layer = 0; layer < layerCount; layer++)
+                levelViews.push_back(createLevelView(pImage, level, layer));
+        views.insert(views.end(), levelViews.begin(), levelViews.end());
+
+        Descriptor* pDescriptor = createDescriptor(std::max((levelCount - 1) * layerCount, 1u));
+        pDescriptor->createLayout(L0);
+        pDescriptor->createPool();
+        pDescriptor->allocate(L0);
+        for (uint32_t level = 1; level < levelCount; level++) {
+            for (uint32_t layer = 0; layer < layerCount; layer++) {
+                uint32_t set = (level - 1) * layerCount + layer;
+                VkDescriptorImageInfo sourceInfo = { VK_NULL_HANDLE, levelViews[set]             , VK_IMAGE_LAYOUT_GENERAL };
+                VkDescriptorImageInfo targetInfo = { VK_NULL_HANDLE, levelViews[set + layerCount], VK_IMAGE_LAYOUT_GENERAL };
+                pDescriptor->setupPointerImage(L0, set, B0, &sourceInfo);
+                pDescriptor->setupPointerImage(L0, set, B1, &targetInfo);
+                pDescriptor->update(L0);
+            }
+        }
+        pDescriptors.push_back(pDescriptor);
+
+        VkImageMemoryBarrier barrier{};
+        barrier.sType               = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+        barrier.image               = pImage->getImage();
+        barrier.oldLayout           = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+        barrier.newLayout           = VK_IMAGE_LAYOUT_GENERAL;
+        barrier.srcAccessMask       = VK_ACCESS_TRANSFER_WRITE_BIT;
+        barrier.dstAccessMask       = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+        barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        barrier.subresourceRange    = { VK_IMAGE_ASPECT_COLOR_BIT, 0, levelCount, 0, layerCount };
+        barriers.push_back(barrier);
+    }
+
+    vkCmdPipelineBarrier(commandBuffer,
+                         VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0,
+                         0, nullptr,
+                         0, nullptr,
+                         UINT32(barriers.size()), barriers.data());
+
+    std::vector<VkImageMemoryBarrier> levelBarriers;
+    for (uint32_t i = 1; i < maxLevels; i++) {
+        levelBarriers.clear();
+        for (uint32_t j = 0; j < pImages.size(); j++) {
+            Image* pImage = pImages[j];
+            if (pImage->m_imageInfo.mipLevels <= i) continue;
+            uint32_t         layerCount = pImage->m_imageInfo.arrayLayers;
+            PipelineCompute* pPipeline  = getPipeline(pImage->m_imageInfo.format);
+            Constants        constants  = { int32_t(std::max(pImage->m_imageInfo.extent.width  >> i, 1u)),
+                                            int32_t(std::max(pImage->m_imageInfo.extent.height >> i, 1u)) };
+            std::vector<VkDescriptorSet> descSets = pDescriptors[j]->getDescriptorSets(L0);
+
+            vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, pPipeline->m_pipeline);
+            vkCmdPushConstants(commandBuffer, pPipeline->m_pipelineLayout, VK_SHADER_STAGE_COMPUTE_BIT,
+                               0, sizeof(Constants), &constants);
+            for (uint32_t layer = 0; layer < layerCount; layer++) {
+                VkDescriptorSet descSet = descSets[(i - 1) * layerCount + layer];
+                vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE,
+                                        pPipeline->m_pipelineLayout, 0, 1, &descSet, 0, nullptr);
+                vkCmdDispatch(commandBuffer,
+                              (constants.width  + DOWNSAMPLE_GROUP_SIZE - 1) / DOWNSAMPLE_GROUP_SIZE,
+                              (constants.height + DOWNSAMPLE_GROUP_SIZE - 1) / DOWNSAMPLE_GROUP_SIZE, 1);
+            }
+
+            VkImageMemoryBarrier barrier = barriers[j];
+            barrier.oldLayout     = VK_IMAGE_LAYOUT_GENERAL;
+            barrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+            barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+            barrier.subresourceRange.baseMipLevel = i;
+            barrier.subresourceRange.levelCount   = 1;
+            levelBarriers.push_back(barrier);
+        }
+
+        vkCmdPipelineBarrier(commandBuffer,
+                             VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0,
+                             0, nullptr,
+                             0, nullptr,
+                             UINT32(levelBarriers.size()), levelBarriers.data());
+    }
+
+    for (VkImageMemoryBarrier& barrier : barriers) {
+        barrier.oldLayout     = VK_IMAGE_LAYOUT_GENERAL;
+        barrier.newLayout     = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+        barrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+        barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+    }
+    vkCmdPipelineBarrier(commandBuffer,
+                         VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, 0,
+                         0, nullptr,
+                         0, nullptr,
+                         UINT32(barriers.size()), barriers.data());
+
+    // Views and sets stay alive until the upload batch recording them has completed
+    VkDevice device = m_device;
+    System::Uploader()->retire([device, views, pDescriptors]() {
+        for (VkImageView view : views) vkDestroyImageView(device, view, nullptr);
+        for (Descriptor* pDescriptor : pDescriptors) {
+            pDescriptor->cleanup();
+            delete pDescriptor;
+        }
+    });
+}
+
+// Storage images need a matching format qualifier, so only formats with a compiled shader variant qualify
+bool Downsampler::IsFormatSupported(VkPhysicalDevice physicalDevice, VkFormat format) {
+    if (GetShaderPath(format).empty()) return false;
+    VkFormatProperties properties;
+    vkGetPhysicalDeviceFormatProperties(physicalDevice, format, &properties);
+    return properties.optimalTilingFeatures & VK_FORMAT_FEATURE_STORAGE_IMAGE_BIT;
+}
+
+
+// Private ==================================================
+
+
+PipelineCompute* Downsampler::getPipeline(VkFormat format) {
+    if (m_pPipelines.count(format)) return m_pPipelines[format];
+    LOG("Downsampler::getPipeline");
+    Shader* computeShader = new Shader(GetShaderPath(format), VK_SHADER_STAGE_COMPUTE_BIT);
+
+    PipelineCompute* pPipeline = new PipelineCompute();
+    pPipeline->setShader(computeShader);
+    pPipeline->setupPushConstant(sizeof(Constants));
+    pPipeline->createPipelineLayout({ m_pLayoutDescriptor->getDescriptorLayout(L0) });
+    pPipeline->create();
+
+    { m_pPipelines[format] = pPipeline; }
+    return pPipeline;
+}
+
+// Identically defined set layouts are compatible, so per-image descriptors bind against the shared pipeline layout
+Descriptor* Downsampler::createDescriptor(uint32_t setCount) {
+    Descriptor* pDescriptor = new Descriptor();
+    pDescriptor->setupLayout(L0, setCount);
+    pDescriptor->addLayoutBindings(L0, B0, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, VK_SHADER_STAGE_COMPUTE_BIT);
+    pDescriptor->addLayoutBindings(L0, B1, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, VK_SHADER_STAGE_COMPUTE_BIT);
+    return pDescriptor;
+}
+
+VkImageView Downsampler::createLevelView(Image* pImage, uint32_t level, uint32_t layer) {
+    VkImageViewCreateInfo viewInfo{};
+    viewInfo.sType            = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+    viewInfo.image            = pImage->getImage();
+    viewInfo.viewType         = VK_IMAGE_VIEW_TYPE_2D;
+    viewInfo.format           = pImage->m_imageInfo.format;
+    viewInfo.subresourceRange = { VK_IMAGE_ASPECT_COLOR_BIT, level, 1, layer, 1 };
+
+    VkImageView view;
+    VkResult result = vkCreateImageView(m_device, &viewInfo, nullptr, &view);
+    CHECK_VKRESULT(result, "failed to create mip level view!");
+    return view;
+}
+
+std::string Downsampler::GetShaderPath(VkFormat format) {
+    switch (format) {
+        case VK_FORMAT_R16G16B16A16_SFLOAT: return "shaders/downsample_rgba16f.comp.spv";
+        case VK_FORMAT_R32G32B32A32_SFLOAT: return "shaders/downsample_rgba32f.comp.spv";
+        default: return "";
+    }
+}
@@ -0,0 +1,44 @@
+//  Copyright © 2021 Subph. All rights reserved.
+//
+
+#pragma once
+
+#include <map>
+
+#include "../common.h"
+#include "descriptor.h"
+#include "pipeline_compute.h"
+
+class Image;
+
+class Downsampler {
+
+public:
+    ~Downsampler();
+    Downsampler();
+
+    void cleanup();
+    void create();
+
+    void cmdGenerateMipmaps(VkCommandBuffer commandBuffer, std::vector<Image*> pImages);
+
+    static bool IsFormatSupported(VkPhysicalDevice physicalDevice, VkFormat format);
+
+private:
+
+    struct Constants {
+        int32_t width;
+        int32_t height;
+    };
+
+    VkDevice    m_device            = VK_NULL_HANDLE;
+    Descriptor* m_pLayoutDescriptor = nullptr;
+
+    std::map<VkFormat, PipelineCompute*> m_pPipelines;
+
+    PipelineCompute* getPipeline  (VkFormat format);
+    Descriptor*      createDescriptor(uint32_t setCount);
+    VkImageView      createLevelView(Image* pImage, uint32_t level, uint32_t layer);
+
+    static std::string GetShaderPath(VkFormat format);
+};
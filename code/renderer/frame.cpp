@@ -12,15 +12,13 @@ Frame::Frame() {
 
 void Frame::cleanup() {
     LOG("Frame::cleanup");
-    vkWaitForFences(m_device, 1, &m_commandFence, VK_TRUE, UINT64_MAX);
-    
-    vkDestroyFence(m_device, m_commandFence, nullptr);
     vkDestroySemaphore(m_device, m_renderSemaphore, nullptr);
     vkDestroyFramebuffer(m_device, m_framebuffer, nullptr);
     
-    m_uniformBuffer->cleanup();
     m_depthImage->cleanup();
     m_image->cleanupImageView();
+    delete m_depthImage;
+    delete m_image;
 }
 
 void Frame::createImageResource(VkImage image, VkFormat format) {
@@ -71,40 +69,7 @@ void Frame::createFinishSignal() {
     VkResult result = vkCreateSemaphore(device, &semaphoreInfo, nullptr, &semaphore);
     CHECK_VKRESULT(result, "failed to create semaphores!");
     
-    VkFenceCreateInfo fenceInfo{};
-    fenceInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
-    fenceInfo.flags = VK_FENCE_CREATE_SIGNALED_BIT;
-    
-    VkFence fence;
-    result = vkCreateFence(device, &fenceInfo, nullptr, &fence);
-    CHECK_VKRESULT(result, "failed to create fences!");
-    
-    {
-        m_renderSemaphore = semaphore;
-        m_commandFence    = fence;
-    }
-}
-
-void Frame::createUniformBuffer(VkDeviceSize bufferSize) {
-    m_uniformBuffer = new Buffer();
-    m_uniformBuffer->setup(bufferSize, VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT);
-    m_uniformBuffer->create();
-}
-
-void Frame::updateUniformBuffer(void* address, size_t size) {
-    m_uniformBuffer->fillBuffer(address, size);
-}
-
-VkDescriptorBufferInfo Frame::getBufferInfo() {
-    return m_uniformBuffer->getBufferInfo();
-}
-
-void Frame::setDescriptorSet(VkDescriptorSet descriptorSet) {
-    m_descriptorSet = descriptorSet;
-}
-
-void Frame::setCommandBuffer(VkCommandBuffer commandBuffers) {
-    m_commandBuffer = commandBuffers;
+    { m_renderSemaphore = semaphore; }
 }
 
 void Frame::setSize(Size<uint32_t> size) {
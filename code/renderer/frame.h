@@ -18,15 +18,11 @@ public:
     VkDevice m_device = VK_NULL_HANDLE;
     
     VkFramebuffer   m_framebuffer   = VK_NULL_HANDLE;
-    VkCommandBuffer m_commandBuffer = VK_NULL_HANDLE;
-    VkDescriptorSet m_descriptorSet = VK_NULL_HANDLE;
-    Buffer* m_uniformBuffer = nullptr;
     Image*  m_image         = nullptr;
     Image*  m_depthImage    = nullptr;
     Size<uint32_t>  m_size{};
     
     VkSemaphore m_renderSemaphore;
-    VkFence     m_commandFence;
     
     
     void createDepthResource();
@@ -34,13 +30,5 @@ public:
     void createFramebuffer(VkRenderPass renderPass);
     void createFinishSignal();
     
-    void createUniformBuffer(VkDeviceSize bufferSize);
-    void updateUniformBuffer(void* address, size_t size);
-    
-    void setDescriptorSet(VkDescriptorSet descriptorSet);
-    void setCommandBuffer(VkCommandBuffer commandBuffers);
-    
     void setSize(Size<uint32_t> size);
-    
-    VkDescriptorBufferInfo getBufferInfo();
 };
@@ -18,11 +18,11 @@ void PipelineGraphic::cleanup() {
     vkDestroyPipelineLayout(m_device, m_pipelineLayout, nullptr);
 }
 
-void PipelineGraphic::setupPushConstant(uint size) {
+void PipelineGraphic::setupPushConstant(uint size, VkShaderStageFlags stages) {
     VkPushConstantRange constantRange{};
     constantRange.size = size;
     constantRange.offset = 0;
-    constantRange.stageFlags = VK_SHADER_STAGE_VERTEX_BIT;
+    constantRange.stageFlags = stages;
     { m_constantRange = constantRange; }
 }
 
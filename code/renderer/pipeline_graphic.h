@@ -41,7 +41,7 @@ public:
     void setShaders(std::vector<Shader*> shaders);
     void setVertexInputInfo(VkPipelineVertexInputStateCreateInfo* vertexInputInfo);
     
-    void setupPushConstant(uint size);
+    void setupPushConstant(uint size, VkShaderStageFlags stages = VK_SHADER_STAGE_VERTEX_BIT);
     void createPipelineLayout(std::vector<VkDescriptorSetLayout> descriptorSetLayouts);
     
     void setupViewportInfo(VkExtent2D swapchainExtent);
@@ -12,7 +12,14 @@ Renderer::~Renderer() { }
 
 void Renderer::cleanUp() {
     LOG("Renderer::cleanUp");
+    m_deletionQueue->cleanup();
+    m_uploader->cleanup();
+    m_downsampler->cleanup();
+    if (m_textureTable != nullptr) m_textureTable->cleanup();
+    m_samplerCache->cleanup();
+    m_transferCommander->cleanup();
     m_commander->cleanup();
+    m_allocator->cleanup();
     
     vkDestroyDevice(m_device, nullptr);
     DestroyDebugUtilsMessengerEXT(m_instance, m_debugMessenger, nullptr);
@@ -48,6 +55,10 @@ void Renderer::createInstance(std::vector<const char*> extensions) {
     VkDebugUtilsMessengerCreateInfoEXT debugInfo = m_debugInfo;
     std::vector<const char*> validationLayers    = m_validationLayers;
     
+    // Needed to chain VK_EXT_memory_budget into the memory properties query
+    bool hasProperties2 = CheckInstanceExtensionSupport({ VK_KHR_GET_PHYSICAL_DEVICE_PROPERTIES_2_EXTENSION_NAME });
+    if (hasProperties2) extensions.push_back(VK_KHR_GET_PHYSICAL_DEVICE_PROPERTIES_2_EXTENSION_NAME);
+    
     VkApplicationInfo appInfo{};
     appInfo.sType               = VK_STRUCTURE_TYPE_APPLICATION_INFO;
     appInfo.pApplicationName    = "Application";
@@ -69,7 +80,10 @@ void Renderer::createInstance(std::vector<const char*> extensions) {
     VkResult       result = vkCreateInstance(&instanceInfo, nullptr, &instance);
     CHECK_VKRESULT(result, "failed to create vulkan instance!");
     
-    { m_instance = instance; }
+    {
+        m_instance       = instance;
+        m_hasProperties2 = hasProperties2;
+    }
 }
 
 void Renderer::createDebugMessenger() {
@@ -93,8 +107,9 @@ void Renderer::pickPhysicalDevice(VkSurfaceKHR surface) {
     VkPhysicalDevice physicalDevice = VK_NULL_HANDLE;
     std::vector<VkSurfaceFormatKHR> surfaceFormats;
     std::vector<VkPresentModeKHR>   presentModes;
-    int graphicQueueIndex = 0;
-    int presentQueueIndex = 0;
+    int graphicQueueIndex  = 0;
+    int presentQueueIndex  = 0;
+    int transferQueueIndex = 0;
     
     for (const auto& tempDevice : physicalDevices) {
         VkPhysicalDeviceProperties properties;
@@ -109,6 +124,8 @@ void Renderer::pickPhysicalDevice(VkSurfaceKHR surface) {
         presentModes      = GetSurfaceModeKHR    (tempDevice, surface);
         presentQueueIndex = FindPresentQueueIndex(tempDevice, surface);
         graphicQueueIndex = FindGraphicQueueIndex(tempDevice);
+        transferQueueIndex = FindTransferQueueIndex(tempDevice);
+        if (transferQueueIndex < 0) transferQueueIndex = graphicQueueIndex;
         
         bool swapchainAdequate  = !surfaceFormats.empty() && !presentModes.empty();
         bool hasFamilyIndex     = graphicQueueIndex > -1 && presentQueueIndex > -1;
@@ -123,6 +140,7 @@ void Renderer::pickPhysicalDevice(VkSurfaceKHR surface) {
         m_presentModes      = presentModes;
         m_graphicQueueIndex = graphicQueueIndex;
         m_presentQueueIndex = presentQueueIndex;
+        m_transferQueueIndex = transferQueueIndex;
     }
 }
 
@@ -132,25 +150,59 @@ void Renderer::createLogicalDevice() {
     VkPhysicalDevice         physicalDevice     = m_physicalDevice;
     std::vector<const char*> deviceExtensions   = m_deviceExtensions;
     std::vector<const char*> validationLayers   = m_validationLayers;
-    std::set<uint32_t>       queueFamilyIndices = {m_graphicQueueIndex, m_presentQueueIndex};
+    std::set<uint32_t>       queueFamilyIndices = {m_graphicQueueIndex, m_presentQueueIndex, m_transferQueueIndex};
+    std::vector<VkQueueFamilyProperties> queueFamilies = GetQueueFamilyProperties(physicalDevice);
+    
+    // Without a transfer-only family, uploads take a second graphics queue when there is one
+    uint32_t transferQueueSlot = 0;
+    bool     isSharedFamily    = m_transferQueueIndex == m_graphicQueueIndex;
+    if (isSharedFamily && queueFamilies[m_graphicQueueIndex].queueCount > 1) transferQueueSlot = 1;
+    
+    bool hasMemoryBudget = m_hasProperties2 &&
+        CheckDeviceExtensionSupport(physicalDevice, { VK_EXT_MEMORY_BUDGET_EXTENSION_NAME });
+    if (hasMemoryBudget) deviceExtensions.push_back(VK_EXT_MEMORY_BUDGET_EXTENSION_NAME);
     
-    float queuePriority = 1.f;
+    // Only what the texture table uses: runtime sized, partially bound, update-after-bind sampled images
+    bool hasDescriptorIndexing = USE_BINDLESS_TEXTURES && m_hasProperties2 &&
+        CheckDeviceExtensionSupport(physicalDevice, { VK_KHR_MAINTENANCE3_EXTENSION_NAME,
+                                                      VK_EXT_DESCRIPTOR_INDEXING_EXTENSION_NAME }) &&
+        CheckDescriptorIndexingSupport(m_instance, physicalDevice);
+    VkPhysicalDeviceDescriptorIndexingFeaturesEXT indexingFeatures{};
+    indexingFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DESCRIPTOR_INDEXING_FEATURES_EXT;
+    if (hasDescriptorIndexing) {
+        deviceExtensions.push_back(VK_KHR_MAINTENANCE3_EXTENSION_NAME);
+        deviceExtensions.push_back(VK_EXT_DESCRIPTOR_INDEXING_EXTENSION_NAME);
+        indexingFeatures.runtimeDescriptorArray                        = VK_TRUE;
+        indexingFeatures.descriptorBindingPartiallyBound               = VK_TRUE;
+        indexingFeatures.descriptorBindingSampledImageUpdateAfterBind  = VK_TRUE;
+        indexingFeatures.descriptorBindingUpdateUnusedWhilePending     = VK_TRUE;
+    }
+    
+    float queuePriorities[] = { 1.f, 1.f };
     std::vector<VkDeviceQueueCreateInfo> queueInfos;
     for (uint32_t familyIndex : queueFamilyIndices) {
         VkDeviceQueueCreateInfo queueInfo{};
         queueInfo.sType             = VK_STRUCTURE_TYPE_DEVICE_QUEUE_CREATE_INFO;
         queueInfo.queueFamilyIndex  = familyIndex;
-        queueInfo.queueCount        = 1;
-        queueInfo.pQueuePriorities  = &queuePriority;
+        queueInfo.queueCount        = familyIndex == m_graphicQueueIndex ? transferQueueSlot + 1 : 1;
+        queueInfo.pQueuePriorities  = queuePriorities;
         queueInfos.push_back(queueInfo);
     }
     
+    VkPhysicalDeviceFeatures supportedFeatures;
+    vkGetPhysicalDeviceFeatures(physicalDevice, &supportedFeatures);
+    bool hasTextureCompressionBC = supportedFeatures.textureCompressionBC;
+    bool hasFragmentStores       = USE_VIRTUAL_TEXTURE && supportedFeatures.fragmentStoresAndAtomics;
+    
     VkPhysicalDeviceFeatures deviceFeatures{};
-    deviceFeatures.samplerAnisotropy = VK_TRUE;
-    deviceFeatures.multiViewport     = VK_TRUE;
+    deviceFeatures.samplerAnisotropy        = VK_TRUE;
+    deviceFeatures.multiViewport            = VK_TRUE;
+    deviceFeatures.textureCompressionBC     = hasTextureCompressionBC;
+    deviceFeatures.fragmentStoresAndAtomics = hasFragmentStores;
     
     VkDeviceCreateInfo deviceInfo{};
     deviceInfo.sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
+    deviceInfo.pNext = hasDescriptorIndexing ? &indexingFeatures : nullptr;
     deviceInfo.queueCreateInfoCount     = UINT32(queueInfos.size());
     deviceInfo.pQueueCreateInfos        = queueInfos.data();
     deviceInfo.pEnabledFeatures         = &deviceFeatures;
@@ -163,19 +215,69 @@ void Renderer::createLogicalDevice() {
     VkResult result = vkCreateDevice(physicalDevice, &deviceInfo, nullptr, &device);
     CHECK_VKRESULT(result, "failed to create logical device");
 
-    { m_device = device; }
+    {
+        m_device            = device;
+        m_transferQueueSlot = transferQueueSlot;
+        m_hasMemoryBudget   = hasMemoryBudget;
+        m_hasTextureCompressionBC = hasTextureCompressionBC;
+        m_hasDescriptorIndexing   = hasDescriptorIndexing;
+        m_hasFragmentStores       = hasFragmentStores;
+    }
 }
 
 void Renderer::createDeviceQueue() {
     vkGetDeviceQueue(m_device, m_graphicQueueIndex, 0, &m_graphicQueue);
     vkGetDeviceQueue(m_device, m_presentQueueIndex, 0, &m_presentQueue);
+    vkGetDeviceQueue(m_device, m_transferQueueIndex, m_transferQueueSlot, &m_transferQueue);
 }
 
 Commander* Renderer::getCommander() { return m_commander; }
+Commander* Renderer::getTransferCommander() { return m_transferCommander; }
 void Renderer::createCommander() {
     m_commander = new Commander();
     m_commander->setupPool(m_graphicQueue, m_graphicQueueIndex);
     m_commander->create();
+    
+    m_transferCommander = new Commander();
+    m_transferCommander->setupPool(m_transferQueue, m_transferQueueIndex);
+    m_transferCommander->create();
+}
+
+Allocator* Renderer::getAllocator() { return m_allocator; }
+void Renderer::createAllocator() {
+    m_allocator = new Allocator();
+    m_allocator->create();
+}
+
+Uploader* Renderer::getUploader() { return m_uploader; }
+void Renderer::createUploader() {
+    m_uploader = new Uploader();
+    m_uploader->create();
+}
+
+DeletionQueue* Renderer::getDeletionQueue() { return m_deletionQueue; }
+void Renderer::createDeletionQueue() {
+    m_deletionQueue = new DeletionQueue();
+}
+
+Downsampler* Renderer::getDownsampler() { return m_downsampler; }
+void Renderer::createDownsampler() {
+    m_downsampler = new Downsampler();
+    m_downsampler->create();
+}
+
+SamplerCache* Renderer::getSamplerCache() { return m_samplerCache; }
+void Renderer::createSamplerCache() {
+    m_samplerCache = new SamplerCache();
+}
+
+// Stays null without descriptor indexing, which keeps the per pipeline texture sets
+TextureTable* Renderer::getTextureTable() { return m_textureTable; }
+void Renderer::createTextureTable() {
+    if (!m_hasDescriptorIndexing) return;
+    m_textureTable = new TextureTable();
+    m_textureTable->setup(TEXTURE_TABLE_CAPACITY, TEXTURE_TABLE_FRAMES);
+    m_textureTable->create();
 }
 
 VkSurfaceFormatKHR Renderer::getSwapchainSurfaceFormat() {
@@ -199,14 +301,20 @@ VkPresentModeKHR Renderer::getSwapchainPresentMode() {
     return VK_PRESENT_MODE_FIFO_KHR;
 }
 
-uint32_t Renderer::getGraphicQueueIndex() { return m_graphicQueueIndex; }
+uint32_t Renderer::getGraphicQueueIndex()  { return m_graphicQueueIndex;  }
+uint32_t Renderer::getTransferQueueIndex() { return m_transferQueueIndex; }
 uint32_t Renderer::getPresentQueueIndex(VkSurfaceKHR surface) {
     return FindPresentQueueIndex(m_physicalDevice, surface); }
 
 VkInstance       Renderer::getInstance()       { return m_instance; }
 VkPhysicalDevice Renderer::getPhysicalDevice() { return m_physicalDevice; }
+bool             Renderer::hasMemoryBudget()   { return m_hasMemoryBudget; }
+bool             Renderer::hasDescriptorIndexing() { return m_hasDescriptorIndexing; }
+bool             Renderer::hasFragmentStores()     { return m_hasFragmentStores; }
+bool             Renderer::hasTextureCompressionBC() { return m_hasTextureCompressionBC; }
 VkDevice         Renderer::getDevice()         { return m_device; }
 VkQueue          Renderer::getGraphicQueue()   { return m_graphicQueue; }
+VkQueue          Renderer::getTransferQueue()  { return m_transferQueue; }
 
 
 // Private ==================================================
@@ -262,6 +370,17 @@ int Renderer::FindPresentQueueIndex(VkPhysicalDevice physicalDevice, VkSurfaceKH
     return -1;
 }
 
+// A family with transfer but neither graphics nor compute maps to the copy engine
+int Renderer::FindTransferQueueIndex(VkPhysicalDevice physicalDevice) {
+    std::vector<VkQueueFamilyProperties> queueFamilies = GetQueueFamilyProperties(physicalDevice);
+    VkQueueFlags otherFlags = VK_QUEUE_GRAPHICS_BIT | VK_QUEUE_COMPUTE_BIT;
+    for (int i = 0; i < queueFamilies.size(); i++) {
+        VkQueueFlags flags = queueFamilies[i].queueFlags;
+        if ((flags & VK_QUEUE_TRANSFER_BIT) && !(flags & otherFlags)) return i;
+    }
+    return -1;
+}
+
 bool Renderer::CheckLayerSupport(std::vector<const char*> layers) {
     uint32_t count;
     vkEnumerateInstanceLayerProperties(&count, nullptr);
@@ -275,6 +394,19 @@ bool Renderer::CheckLayerSupport(std::vector<const char*> layers) {
     return requiredLayers.empty();
 }
 
+bool Renderer::CheckInstanceExtensionSupport(std::vector<const char*> extensions) {
+    uint32_t count;
+    vkEnumerateInstanceExtensionProperties(nullptr, &count, nullptr);
+    std::vector<VkExtensionProperties> availableExtensions(count);
+    vkEnumerateInstanceExtensionProperties(nullptr, &count, availableExtensions.data());
+
+    std::set<std::string> requiredExtensions(extensions.begin(), extensions.end());
+    for (const auto& extension : availableExtensions) {
+        requiredExtensions.erase(extension.extensionName);
+    }
+    return requiredExtensions.empty();
+}
+
 bool Renderer::CheckDeviceExtensionSupport(VkPhysicalDevice physicalDevice, std::vector<const char*> extensions) {
     uint32_t count;
     vkEnumerateDeviceExtensionProperties(physicalDevice, nullptr, &count, nullptr);
@@ -288,6 +420,24 @@ bool Renderer::CheckDeviceExtensionSupport(VkPhysicalDevice physicalDevice, std:
     return requiredExtensions.empty();
 }
 
+bool Renderer::CheckDescriptorIndexingSupport(VkInstance instance, VkPhysicalDevice physicalDevice) {
+    auto getFeatures2 = (PFN_vkGetPhysicalDeviceFeatures2KHR)
+        vkGetInstanceProcAddr(instance, "vkGetPhysicalDeviceFeatures2KHR");
+    if (getFeatures2 == nullptr) return false;
+    
+    VkPhysicalDeviceDescriptorIndexingFeaturesEXT indexingFeatures{};
+    indexingFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DESCRIPTOR_INDEXING_FEATURES_EXT;
+    VkPhysicalDeviceFeatures2KHR features{};
+    features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2_KHR;
+    features.pNext = &indexingFeatures;
+    getFeatures2(physicalDevice, &features);
+    
+    return indexingFeatures.runtimeDescriptorArray &&
+           indexingFeatures.descriptorBindingPartiallyBound &&
+           indexingFeatures.descriptorBindingSampledImageUpdateAfterBind &&
+           indexingFeatures.descriptorBindingUpdateUnusedWhilePending;
+}
+
 VkResult Renderer::CreateDebugUtilsMessengerEXT(VkInstance instance, const VkDebugUtilsMessengerCreateInfoEXT* pCreateInfo, const VkAllocationCallbacks* pAllocator, VkDebugUtilsMessengerEXT* pDebugMessenger) {
     auto func = (PFN_vkCreateDebugUtilsMessengerEXT) vkGetInstanceProcAddr(instance, "vkCreateDebugUtilsMessengerEXT");
     if (func != nullptr) {
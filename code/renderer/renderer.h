@@ -5,6 +5,12 @@
 
 #include "../common.h"
 #include "commander.h"
+#include "allocator.h"
+#include "uploader.h"
+#include "deletion_queue.h"
+#include "downsampler.h"
+#include "texture_table.h"
+#include "sampler_cache.h"
 #include "swapchain.h"
 #include "../resources/buffer.h"
 #include "../resources/image.h"
@@ -26,6 +32,7 @@ public:
     void setupValidation(bool isEnable);
     
     VkInstance m_instance = VK_NULL_HANDLE;
+    bool m_hasProperties2 = false;
     VkInstance getInstance();
     void createInstance(std::vector<const char*> extensions);
     
@@ -40,27 +47,66 @@ public:
     VkSurfaceFormatKHR getSwapchainSurfaceFormat();
     VkPresentModeKHR   getSwapchainPresentMode();
 
-    uint32_t m_graphicQueueIndex = 0;
-    uint32_t m_presentQueueIndex = 0;
+    uint32_t m_graphicQueueIndex  = 0;
+    uint32_t m_presentQueueIndex  = 0;
+    uint32_t m_transferQueueIndex = 0;
+    uint32_t m_transferQueueSlot  = 0;
     uint32_t getGraphicQueueIndex();
     uint32_t getPresentQueueIndex(VkSurfaceKHR surface);
+    uint32_t getTransferQueueIndex();
 
     VkPhysicalDevice m_physicalDevice = VK_NULL_HANDLE;
     VkPhysicalDevice getPhysicalDevice();
     void pickPhysicalDevice(VkSurfaceKHR surface);
     
     VkDevice m_device = VK_NULL_HANDLE;
+    bool m_hasMemoryBudget = false;
+    bool m_hasTextureCompressionBC = false;
+    bool m_hasDescriptorIndexing   = false;
+    bool m_hasFragmentStores       = false;
     VkDevice getDevice();
+    bool hasMemoryBudget();
+    bool hasTextureCompressionBC();
+    bool hasDescriptorIndexing();
+    bool hasFragmentStores();
     void createLogicalDevice();
     
-    VkQueue m_graphicQueue = VK_NULL_HANDLE;
-    VkQueue m_presentQueue = VK_NULL_HANDLE;
+    VkQueue m_graphicQueue  = VK_NULL_HANDLE;
+    VkQueue m_presentQueue  = VK_NULL_HANDLE;
+    VkQueue m_transferQueue = VK_NULL_HANDLE;
     VkQueue getGraphicQueue();
+    VkQueue getTransferQueue();
     void createDeviceQueue();
     
-    Commander* m_commander = nullptr;
+    Commander* m_commander         = nullptr;
+    Commander* m_transferCommander = nullptr;
     Commander* getCommander();
+    Commander* getTransferCommander();
     void createCommander();
+    
+    Allocator* m_allocator = nullptr;
+    Allocator* getAllocator();
+    void createAllocator();
+    
+    Uploader* m_uploader = nullptr;
+    Uploader* getUploader();
+    void createUploader();
+    
+    DeletionQueue* m_deletionQueue = nullptr;
+    DeletionQueue* getDeletionQueue();
+    void createDeletionQueue();
+    
+    Downsampler* m_downsampler = nullptr;
+    Downsampler* getDownsampler();
+    void createDownsampler();
+    
+    SamplerCache* m_samplerCache = nullptr;
+    SamplerCache* getSamplerCache();
+    void createSamplerCache();
+    
+    TextureTable* m_textureTable = nullptr;
+    TextureTable* getTextureTable();
+    void createTextureTable();
 
 private:
     
@@ -72,10 +118,13 @@ private:
     
     static int FindGraphicQueueIndex(VkPhysicalDevice physicalDevice);
     static int FindPresentQueueIndex(VkPhysicalDevice physicalDevice, VkSurfaceKHR surface);
+    static int FindTransferQueueIndex(VkPhysicalDevice physicalDevice);
 
     
     static bool CheckLayerSupport(std::vector<const char*> layers);
+    static bool CheckInstanceExtensionSupport(std::vector<const char*> extensions);
     static bool CheckDeviceExtensionSupport(VkPhysicalDevice device, std::vector<const char*> extensions);
+    static bool CheckDescriptorIndexingSupport(VkInstance instance, VkPhysicalDevice physicalDevice);
 
     static VkResult CreateDebugUtilsMessengerEXT(VkInstance instance,
                                           const VkDebugUtilsMessengerCreateInfoEXT* pCreateInfo,
@@ -0,0 +1,107 @@
+//  Copyright © 2021 Subph. All rights reserved.
+//
+
+#include <cstring>
+
+#include "sampler_cache.h"
+
+#include "../system.h"
+
+SamplerCache::~SamplerCache() {}
+SamplerCache::SamplerCache() {
+    Renderer* renderer = System::Renderer();
+    m_device           = renderer->getDevice();
+    
+    VkPhysicalDeviceProperties properties;
+    vkGetPhysicalDeviceProperties(renderer->getPhysicalDevice(), &properties);
+    m_limit = properties.limits.maxSamplerAllocationCount;
+}
+
+void SamplerCache::cleanup() {
+    LOG("SamplerCache::cleanup");
+    for (auto& entry : m_samplers) vkDestroySampler(m_device, entry.second, nullptr);
+    m_samplers.clear();
+}
+
+VkSampler SamplerCache::getSampler(const VkSamplerCreateInfo& samplerInfo) {
+    CHECK_BOOL((samplerInfo.pNext == nullptr), "sampler cache does not take chained samplers!");
+    SamplerKey key = GetSamplerKey(samplerInfo);
+    auto found = m_samplers.find(key);
+    if (found != m_samplers.end()) return found->second;
+    
+    CHECK_BOOL((m_samplers.size() < m_limit), "sampler cache reached maxSamplerAllocationCount!");
+    VkSampler sampler;
+    VkResult  result = vkCreateSampler(m_device, &samplerInfo, nullptr, &sampler);
+    CHECK_VKRESULT(result, "failed to create texture sampler!");
+    PRINTLN4("SamplerCache::getSampler created", m_samplers.size() + 1, "of limit", m_limit);
+    
+    { m_samplers[key] = sampler; }
+    return sampler;
+}
+
+VkSampler SamplerCache::getTextureSampler() { return getSampler(GetTextureSamplerInfo()); }
+
+size_t SamplerCache::getSamplerCount() { return m_samplers.size(); }
+
+// maxLod is left unclamped, so images with different level counts still share the sampler
+VkSamplerCreateInfo SamplerCache::GetTextureSamplerInfo() {
+    VkSamplerCreateInfo samplerInfo{};
+    samplerInfo.sType        = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO;
+    samplerInfo.magFilter    = VK_FILTER_LINEAR;
+    samplerInfo.minFilter    = VK_FILTER_LINEAR;
+    samplerInfo.addressModeU = VK_SAMPLER_ADDRESS_MODE_REPEAT;
+    samplerInfo.addressModeV = VK_SAMPLER_ADDRESS_MODE_REPEAT;
+    samplerInfo.addressModeW = VK_SAMPLER_ADDRESS_MODE_REPEAT;
+    samplerInfo.unnormalizedCoordinates = VK_FALSE;
+    samplerInfo.anisotropyEnable = VK_TRUE;
+    samplerInfo.maxAnisotropy    = 16.0f;
+    samplerInfo.borderColor      = VK_BORDER_COLOR_INT_OPAQUE_BLACK;
+    samplerInfo.compareEnable    = VK_FALSE;
+    samplerInfo.compareOp        = VK_COMPARE_OP_ALWAYS;
+    samplerInfo.mipmapMode       = VK_SAMPLER_MIPMAP_MODE_LINEAR;
+    samplerInfo.mipLodBias       = 0.0f;
+    samplerInfo.minLod           = 0.0f;
+    samplerInfo.maxLod           = VK_LOD_CLAMP_NONE;
+    return samplerInfo;
+}
+
+
+// Private ==================================================
+
+
+bool SamplerCache::SamplerKey::operator==(const SamplerKey& other) const {
+    return memcmp(this, &other, sizeof(SamplerKey)) == 0;
+}
+
+// FNV-1a over the key; every field is 4 bytes wide, so the struct has no padding to hash
+size_t SamplerCache::SamplerKeyHash::operator()(const SamplerKey& key) const {
+    static_assert(sizeof(SamplerKey) == 16 * 4, "sampler key has padding!");
+    const unsigned char* bytes = reinterpret_cast<const unsigned char*>(&key);
+    uint64_t hash = 14695981039346656037ull;
+    for (size_t i = 0; i < sizeof(SamplerKey); i++) {
+        hash ^= bytes[i];
+        hash *= 1099511628211ull;
+    }
+    return size_t(hash);
+}
+
+SamplerCache::SamplerKey SamplerCache::GetSamplerKey(const VkSamplerCreateInfo& samplerInfo) {
+    SamplerKey key;
+    key.flags                   = samplerInfo.flags;
+    key.magFilter               = samplerInfo.magFilter;
+    key.minFilter               = samplerInfo.minFilter;
+    key.mipmapMode              = samplerInfo.mipmapMode;
+    key.addressModeU            = samplerInfo.addressModeU;
+    key.addressModeV            = samplerInfo.addressModeV;
+    key.addressModeW            = samplerInfo.addressModeW;
+    key.mipLodBias              = samplerInfo.mipLodBias;
+    key.anisotropyEnable        = samplerInfo.anisotropyEnable;
+    key.maxAnisotropy           = samplerInfo.maxAnisotropy;
+    key.compareEnable           = samplerInfo.compareEnable;
+    key.compareOp               = samplerInfo.compareOp;
+    key.minLod                  = samplerInfo.minLod;
+    key.maxLod                  = samplerInfo.maxLod;
+    key.borderColor             = samplerInfo.borderColor;
+    key.unnormalizedCoordinates = samplerInfo.unnormalizedCoordinates;
+    return key;
+}
@@ -0,0 +1,62 @@
+//  Copyright © 2021 Subph. All rights reserved.
+//
+
+#pragma once
+
+#include <unordered_map>
+
+#include "../common.h"
+
+// One shared VkSampler per distinct set of settings. Samplers live until cleanup, so callers never destroy
+// them and can bake the handles into set layouts
+class SamplerCache {
+
+public:
+    ~SamplerCache();
+    SamplerCache();
+
+    void cleanup();
+
+    VkSampler getSampler(const VkSamplerCreateInfo& samplerInfo);
+    VkSampler getTextureSampler();
+
+    size_t getSamplerCount();
+
+    // Linear, repeat and 16x anisotropy over every level
+    static VkSamplerCreateInfo GetTextureSamplerInfo();
+
+private:
+
+    // Every field of VkSamplerCreateInfo except sType and pNext; chained samplers are not cached
+    struct SamplerKey {
+        VkSamplerCreateFlags flags;
+        VkFilter             magFilter;
+        VkFilter             minFilter;
+        VkSamplerMipmapMode  mipmapMode;
+        VkSamplerAddressMode addressModeU;
+        VkSamplerAddressMode addressModeV;
+        VkSamplerAddressMode addressModeW;
+        float                mipLodBias;
+        VkBool32             anisotropyEnable;
+        float                maxAnisotropy;
+        VkBool32             compareEnable;
+        VkCompareOp          compareOp;
+        float                minLod;
+        float                maxLod;
+        VkBorderColor        borderColor;
+        VkBool32             unnormalizedCoordinates;
+
+        bool operator==(const SamplerKey& other) const;
+    };
+
+    struct SamplerKeyHash {
+        size_t operator()(const SamplerKey& key) const;
+    };
+
+    VkDevice m_device = VK_NULL_HANDLE;
+    uint32_t m_limit  = 0;
+
+    std::unordered_map<SamplerKey, VkSampler, SamplerKeyHash> m_samplers;
+
+    static SamplerKey GetSamplerKey(const VkSamplerCreateInfo& samplerInfo);
+};
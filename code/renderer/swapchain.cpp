@@ -17,20 +17,26 @@ Swapchain::Swapchain() {
 void Swapchain::cleanup() {
     LOG("Swapchain::cleanup");
     if (m_frames.size() == 0) return;
+    Commander* pCommander = System::Commander();
     
-    for (size_t i = 0; i < m_imageSemaphores.size(); i++) {
+    vkWaitForFences(m_device, UINT32(m_commandFences.size()), m_commandFences.data(), VK_TRUE, UINT64_MAX);
+    for (size_t i = 0; i < m_framesInFlight; i++) {
         vkDestroySemaphore(m_device, m_imageSemaphores[i], nullptr);
+        vkDestroyFence(m_device, m_commandFences[i], nullptr);
+        pCommander->freeCommandBuffer(m_commandBuffers[i]);
     }
     
-    for (size_t i = 0; i < m_frames.size(); i++)
+    for (size_t i = 0; i < m_frames.size(); i++) {
         m_frames[i]->cleanup();
+        delete m_frames[i];
+    }
     m_frames = {};
     
     vkDestroyRenderPass(m_device, m_renderPass, nullptr);
     vkDestroySwapchainKHR(m_device, m_swapchain, nullptr);
 }
 
-void Swapchain::setup(Size<int> size, VkSurfaceKHR surface) {
+void Swapchain::setup(Size<int> size, VkSurfaceKHR surface, VkSwapchainKHR oldSwapchain) {
     VkPhysicalDevice physicalDevice = m_physicalDevice;
     
     Renderer* renderer = System::Renderer();
@@ -61,7 +67,7 @@ void Swapchain::setup(Size<int> size, VkSurfaceKHR surface) {
     swapchainInfo.preTransform     = capabilities.currentTransform;
     swapchainInfo.presentMode      = presentMode;
     swapchainInfo.clipped          = VK_TRUE;
-    swapchainInfo.oldSwapchain     = VK_NULL_HANDLE;
+    swapchainInfo.oldSwapchain     = oldSwapchain;
     
     uint32_t queueFamilyIndices[] = { graphicFamilyIndex, presentFamilyIndex };
     if (graphicFamilyIndex != presentFamilyIndex) {
@@ -150,9 +156,8 @@ void Swapchain::createRenderPass() {
     { m_renderPass = renderPass; }
 }
 
-void Swapchain::createFrames(VkDeviceSize uniformBufferSize) {
+void Swapchain::createFrames() {
     LOG("Swapchain::createFrames");
-    Commander*     pCommander    = System::Commander();
     VkSwapchainKHR swapchain     = m_swapchain;
     VkRenderPass   renderPass    = m_renderPass;
     VkExtent2D     extent        = m_extent;
@@ -161,17 +166,13 @@ void Swapchain::createFrames(VkDeviceSize uniformBufferSize) {
     std::vector<VkImage> swapchainImages = GetSwapchainImages(swapchain);
     uint32_t totalFrame = UINT32(swapchainImages.size());
     
-    std::vector<VkCommandBuffer> commandBuffers = pCommander->createCommandBuffers(totalFrame);
-    
     std::vector<Frame*> frames;
     for (size_t i = 0; i < totalFrame; i++) {
         Frame* frame = new Frame();
         frame->setSize({extent.width, extent.height});
-        frame->setCommandBuffer(commandBuffers[i]);
         frame->createDepthResource();
         frame->createImageResource(swapchainImages[i], surfaceFormat);
         frame->createFramebuffer(renderPass);
-        frame->createUniformBuffer(uniformBufferSize);
         frame->createFinishSignal();
         frames.push_back(frame);
     }
@@ -181,22 +182,36 @@ void Swapchain::createFrames(VkDeviceSize uniformBufferSize) {
     }
 }
 
-void Swapchain::createSyncObjects() {
+void Swapchain::createSyncObjects(uint32_t framesInFlight) {
     LOG("Swapchain::createSyncObjects");
-    VkDevice device     = m_device;
-    uint32_t totalFrame = UINT32(m_frames.size());
+    VkDevice   device     = m_device;
+    Commander* pCommander = System::Commander();
     
-    std::vector<VkSemaphore> semaphore;
-    semaphore.resize(totalFrame);
+    std::vector<VkCommandBuffer> commandBuffers = pCommander->createCommandBuffers(framesInFlight);
+    std::vector<VkSemaphore> semaphores(framesInFlight);
+    std::vector<VkFence>     fences(framesInFlight);
+    std::vector<VkFence>     imageFences(m_totalFrame, VK_NULL_HANDLE);
 
     VkSemaphoreCreateInfo semaphoreInfo{};
     semaphoreInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
     
-    for (size_t i = 0; i < totalFrame; i++) {
-        VkResult result = vkCreateSemaphore(device, &semaphoreInfo, nullptr, &semaphore[i]);
+    VkFenceCreateInfo fenceInfo{};
+    fenceInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+    fenceInfo.flags = VK_FENCE_CREATE_SIGNALED_BIT;
+    
+    for (size_t i = 0; i < framesInFlight; i++) {
+        VkResult result = vkCreateSemaphore(device, &semaphoreInfo, nullptr, &semaphores[i]);
         CHECK_VKRESULT(result, "failed to create image available semaphores!");
+        result = vkCreateFence(device, &fenceInfo, nullptr, &fences[i]);
+        CHECK_VKRESULT(result, "failed to create fences!");
+    }
+    {
+        m_framesInFlight  = framesInFlight;
+        m_commandBuffers  = commandBuffers;
+        m_imageSemaphores = semaphores;
+        m_commandFences   = fences;
+        m_imageFences     = imageFences;
     }
-    { m_imageSemaphores = semaphore; }
 }
 
 VkRenderPassBeginInfo Swapchain::getRenderBeginInfo() {
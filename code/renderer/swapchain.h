@@ -26,7 +26,7 @@ public:
     VkSwapchainCreateInfoKHR m_swapchainInfo{};
     VkExtent2D m_extent;
     VkFormat m_surfaceFormat;
-    void setup(Size<int> size, VkSurfaceKHR surface);
+    void setup(Size<int> size, VkSurfaceKHR surface, VkSwapchainKHR oldSwapchain = VK_NULL_HANDLE);
     
     VkSwapchainKHR m_swapchain = VK_NULL_HANDLE;
     void create();
@@ -36,10 +36,15 @@ public:
 
     uint m_totalFrame;
     std::vector<Frame*> m_frames;
-    void createFrames(VkDeviceSize uniformBufferSize);
-    
-    std::vector<VkSemaphore> m_imageSemaphores;
-    void createSyncObjects();
+    void createFrames();
+    
+    // Frames in flight cycle independently of the swapchain images they render into
+    uint32_t m_framesInFlight = 2;
+    std::vector<VkCommandBuffer> m_commandBuffers;
+    std::vector<VkSemaphore>     m_imageSemaphores;
+    std::vector<VkFence>         m_commandFences;
+    std::vector<VkFence>         m_imageFences;
+    void createSyncObjects(uint32_t framesInFlight);
     
     VkRenderPassBeginInfo getRenderBeginInfo();
     
@@ -0,0 +1,162 @@
+//  Copyright © 2021 Subph. All rights reserved.
+//
+
+#include <algorithm>
+
+#include "texture_table.h"
+
+#include "../system.h"
+
+TextureTable::~TextureTable() {}
+TextureTable::TextureTable() {
+    m_device = System::Renderer()->getDevice();
+}
+
+void TextureTable::cleanup() {
+    LOG("TextureTable::cleanup");
+    vkDestroyDescriptorSetLayout(m_device, m_layout, nullptr);
+    vkDestroyDescriptorPool(m_device, m_pool, nullptr);
+}
+
+void TextureTable::setup(uint32_t capacity, uint32_t frameCount) {
+    CHECK_BOOL((frameCount <= 32), "texture table tracks at most 32 frames!");
+    m_capacity   = capacity;
+    m_frameCount = frameCount;
+}
+
+// Unwritten slots stay legal through partial binding; slots unused by pending frames can be rewritten
+void TextureTable::create() {
+    LOG("TextureTable::create");
+    VkDevice device     = m_device;
+    uint32_t capacity   = m_capacity;
+    uint32_t frameCount = m_frameCount;
+    
+    // Every slot bakes in the shared texture sampler, so materials only ever write image views
+    std::vector<VkSampler> immutableSamplers(capacity, System::SamplerCache()->getTextureSampler());
+
+    VkDescriptorSetLayoutBinding layoutBinding{};
+    layoutBinding.binding            = 0;
+    layoutBinding.descriptorCount    = capacity;
+    layoutBinding.descriptorType     = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+    layoutBinding.stageFlags         = VK_SHADER_STAGE_FRAGMENT_BIT;
+    layoutBinding.pImmutableSamplers = immutableSamplers.data();
+
+    VkDescriptorBindingFlagsEXT bindingFlags = VK_DESCRIPTOR_BINDING_UPDATE_AFTER_BIND_BIT_EXT |
+                                               VK_DESCRIPTOR_BINDING_UPDATE_UNUSED_WHILE_PENDING_BIT_EXT |
+                                               VK_DESCRIPTOR_BINDING_PARTIALLY_BOUND_BIT_EXT;
+    VkDescriptorSetLayoutBindingFlagsCreateInfoEXT bindingFlagsInfo{};
+    bindingFlagsInfo.sType         = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_BINDING_FLAGS_CREATE_INFO_EXT;
+    bindingFlagsInfo.bindingCount  = 1;
+    bindingFlagsInfo.pBindingFlags = &bindingFlags;
+
+    VkDescriptorSetLayoutCreateInfo layoutInfo{};
+    layoutInfo.sType        = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+    layoutInfo.pNext        = &bindingFlagsInfo;
+    layoutInfo.flags        = VK_DESCRIPTOR_SET_LAYOUT_CREATE_UPDATE_AFTER_BIND_POOL_BIT_EXT;
+    layoutInfo.bindingCount = 1;
+    layoutInfo.pBindings    = &layoutBinding;
+
+    VkDescriptorSetLayout layout;
+    VkResult result = vkCreateDescriptorSetLayout(device, &layoutInfo, nullptr, &layout);
+    CHECK_VKRESULT(result, "failed to create texture table layout!");
+
+    VkDescriptorPoolSize poolSize = { VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, capacity * frameCount };
+    VkDescriptorPoolCreateInfo poolInfo{};
+    poolInfo.sType         = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+    poolInfo.flags         = VK_DESCRIPTOR_POOL_CREATE_UPDATE_AFTER_BIND_BIT_EXT;
+    poolInfo.maxSets       = frameCount;
+    poolInfo.poolSizeCount = 1;
+    poolInfo.pPoolSizes    = &poolSize;
+
+    VkDescriptorPool pool;
+    result = vkCreateDescriptorPool(device, &poolInfo, nullptr, &pool);
+    CHECK_VKRESULT(result, "failed to create texture table pool!");
+
+    std::vector<VkDescriptorSetLayout> layouts(frameCount, layout);
+    std::vector<VkDescriptorSet>       descriptorSets(frameCount);
+    VkDescriptorSetAllocateInfo allocInfo{};
+    allocInfo.sType              = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+    allocInfo.descriptorPool     = pool;
+    allocInfo.descriptorSetCount = frameCount;
+    allocInfo.pSetLayouts        = layouts.data();
+    result = vkAllocateDescriptorSets(device, &allocInfo, descriptorSets.data());
+    CHECK_VKRESULT(result, "failed to allocate texture table sets!");
+
+    {
+        m_layout         = layout;
+        m_pool           = pool;
+        m_descriptorSets = descriptorSets;
+    }
+}
+
+uint32_t TextureTable::addMaterial(std::vector<Image*> pTextures) {
+    uint32_t materialId = m_materialCount;
+    if (!m_freeMaterials.empty()) {
+        materialId = m_freeMaterials.back();
+        m_freeMaterials.pop_back();
+    } else {
+        CHECK_BOOL(((materialId + 1) * MATERIAL_TEXTURE_COUNT <= m_capacity), "texture table is full!");
+        m_materialCount++;
+    }
+    writeMaterial(materialId, pTextures);
+    return materialId;
+}
+
+void TextureTable::updateMaterial(uint32_t materialId, std::vector<Image*> pTextures) {
+    writeMaterial(materialId, pTextures);
+}
+
+// The ID comes back only after the frames already recorded with it retire
+void TextureTable::removeMaterial(uint32_t materialId) {
+    System::DeletionQueue()->retire([this, materialId]() { m_freeMaterials.push_back(materialId); });
+}
+
+// Call once the frame's previous submission has retired, before recording it again
+void TextureTable::flush(uint32_t frameIndex) {
+    CHECK_BOOL((frameIndex < m_frameCount), "frame index outside the texture table!");
+    VkDescriptorSet descriptorSet = m_descriptorSets[frameIndex];
+    uint32_t        frameBit      = 1u << frameIndex;
+
+    std::vector<VkWriteDescriptorSet> writeSets;
+    for (PendingWrite& pending : m_pendingWrites) {
+        if (!(pending.frameMask & frameBit)) continue;
+        VkWriteDescriptorSet writeSet{};
+        writeSet.sType           = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+        writeSet.dstSet          = descriptorSet;
+        writeSet.dstBinding      = 0;
+        writeSet.dstArrayElement = pending.slot;
+        writeSet.descriptorCount = 1;
+        writeSet.descriptorType  = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+        writeSet.pImageInfo      = &pending.imageInfo;
+        writeSets.push_back(writeSet);
+        pending.frameMask &= ~frameBit;
+    }
+    if (writeSets.empty()) return;
+    vkUpdateDescriptorSets(m_device, UINT32(writeSets.size()), writeSets.data(), 0, nullptr);
+
+    m_pendingWrites.erase(std::remove_if(m_pendingWrites.begin(), m_pendingWrites.end(),
+                                         [](const PendingWrite& pending) { return pending.frameMask == 0; }),
+                          m_pendingWrites.end());
+}
+
+VkDescriptorSetLayout TextureTable::getDescriptorLayout() { return m_layout; }
+VkDescriptorSet       TextureTable::getDescriptorSet(uint32_t frameIndex) { return m_descriptorSets[frameIndex]; }
+
+
+// Private ==================================================
+
+
+// A newer write to the same slot replaces one still waiting, so a frame never sees the older image
+void TextureTable::writeMaterial(uint32_t materialId, std::vector<Image*> pTextures) {
+    CHECK_BOOL((pTextures.size() <= MATERIAL_TEXTURE_COUNT), "material has too many textures!");
+    uint32_t allFrames = m_frameCount == 32 ? ~0u : (1u << m_frameCount) - 1;
+    for (uint32_t i = 0; i < pTextures.size(); i++) {
+        CHECK_BOOL((pTextures[i]->getSampler() == System::SamplerCache()->getTextureSampler()),
+                   "texture table only holds images using the shared texture sampler!");
+        uint32_t slot = materialId * MATERIAL_TEXTURE_COUNT + i;
+        m_pendingWrites.erase(std::remove_if(m_pendingWrites.begin(), m_pendingWrites.end(),
+                                             [slot](const PendingWrite& pending) { return pending.slot == slot; }),
+                              m_pendingWrites.end());
+        m_pendingWrites.push_back({ slot, pTextures[i]->getImageInfo(), allFrames });
+    }
+}
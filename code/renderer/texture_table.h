@@ -0,0 +1,57 @@
+//  Copyright © 2021 Subph. All rights reserved.
+//
+
+#pragma once
+
+#include "../common.h"
+
+#define TEXTURE_TABLE_CAPACITY 1024
+#define TEXTURE_TABLE_FRAMES   2
+#define MATERIAL_TEXTURE_COUNT 3
+
+class Image;
+
+// One update-after-bind array of combined image samplers shared by every draw. Material i owns slots
+// i * MATERIAL_TEXTURE_COUNT onward, so shaders reach its textures from a material ID push constant
+class TextureTable {
+
+public:
+    ~TextureTable();
+    TextureTable();
+
+    void cleanup();
+
+    void setup(uint32_t capacity, uint32_t frameCount);
+    void create();
+
+    uint32_t addMaterial   (std::vector<Image*> pTextures);
+    void     updateMaterial(uint32_t materialId, std::vector<Image*> pTextures);
+    void     removeMaterial(uint32_t materialId);
+
+    void flush(uint32_t frameIndex);
+
+    VkDescriptorSetLayout getDescriptorLayout();
+    VkDescriptorSet       getDescriptorSet(uint32_t frameIndex);
+
+private:
+
+    // Applied to each frame's set once that frame's previous submission has retired
+    struct PendingWrite {
+        uint32_t              slot;
+        VkDescriptorImageInfo imageInfo;
+        uint32_t              frameMask;
+    };
+
+    VkDevice              m_device     = VK_NULL_HANDLE;
+    VkDescriptorPool      m_pool       = VK_NULL_HANDLE;
+    VkDescriptorSetLayout m_layout     = VK_NULL_HANDLE;
+    uint32_t              m_capacity   = TEXTURE_TABLE_CAPACITY;
+    uint32_t              m_frameCount = TEXTURE_TABLE_FRAMES;
+
+    std::vector<VkDescriptorSet> m_descriptorSets;
+    std::vector<PendingWrite>    m_pendingWrites;
+    std::vector<uint32_t>        m_freeMaterials;
+    uint32_t                     m_materialCount = 0;
+
+    void writeMaterial(uint32_t materialId, std::vector<Image*> pTextures);
+};
@@ -0,0 +1,300 @@
+//  Copyright © 2021 Subph. All rights reserved.
+//
+
+#include "uploader.h"
+
+#include "../system.h"
+#include "../resources/buffer.h"
+
+Uploader::~Uploader() {}
+Uploader::Uploader() {
+    Renderer* renderer = System::Renderer();
+    m_device           = renderer->getDevice();
+    m_graphicFamily    = renderer->getGraphicQueueIndex();
+    m_transferFamily   = renderer->getTransferQueueIndex();
+}
+
+void Uploader::cleanup() {
+    LOG("Uploader::cleanup");
+    wait();
+    m_pRing->cleanup();
+    delete m_pRing;
+}
+
+void Uploader::setup(VkDeviceSize ringSize) {
+    m_ringSize = ringSize;
+}
+
+void Uploader::create() {
+    LOG("Uploader::create");
+    Buffer* pRing = new Buffer();
+    pRing->setup(m_ringSize, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, Allocator::CpuToGpu);
+    pRing->create();
+    
+    { m_pRing = pRing; }
+}
+
+VkCommandBuffer Uploader::getCommandBuffer() {
+    if (m_batch.commandBuffer != VK_NULL_HANDLE) return m_batch.commandBuffer;
+    Commander* commander = System::Renderer()->getTransferCommander();
+    
+    VkCommandBuffer commandBuffer = commander->createCommandBuffer();
+    commander->beginSingleTimeCommands(commandBuffer);
+    
+    { m_batch.commandBuffer = commandBuffer; }
+    return commandBuffer;
+}
+
+// Ownership acquires and blits run on the graphics queue after the copies of the same batch
+VkCommandBuffer Uploader::getGraphicCommandBuffer() {
+    if (m_batch.graphicCommandBuffer != VK_NULL_HANDLE) return m_batch.graphicCommandBuffer;
+    Commander* commander = System::Commander();
+    
+    VkCommandBuffer commandBuffer = commander->createCommandBuffer();
+    commander->beginSingleTimeCommands(commandBuffer);
+    
+    { m_batch.graphicCommandBuffer = commandBuffer; }
+    return commandBuffer;
+}
+
+// Space of a submitted batch comes back once its fence signals; a full ring submits and waits
+Uploader::Staging Uploader::reserve(VkDeviceSize size, VkDeviceSize alignment) {
+    getCommandBuffer();
+    if (size >= m_ringSize) return reserveDedicated(size);
+    
+    VkDeviceSize offset = 0;
+    while (!fitRing(size, alignment, &offset)) {
+        if (m_pending.empty()) submit();
+        waitOldest();
+    }
+    
+    Staging staging{};
+    staging.buffer = m_pRing->getBuffer();
+    staging.offset = offset;
+    staging.mapped = static_cast<char*>(m_pRing->getMapped()) + offset;
+    return staging;
+}
+
+Uploader::Staging Uploader::stage(const void* address, VkDeviceSize size, VkDeviceSize alignment) {
+    Staging staging = reserve(size, alignment);
+    memcpy(staging.mapped, address, size);
+    if (staging.buffer == m_pRing->getBuffer()) m_pRing->flush(staging.offset, size);
+    else m_batch.pBuffers.back()->flush();
+    return staging;
+}
+
+// Flushes the staging first, so writes through reserve() reach non-coherent memory in either kind of staging
+void Uploader::copyToBuffer(const Staging& staging, VkBuffer buffer, VkDeviceSize size, VkDeviceSize offset) {
+    if (staging.buffer == m_pRing->getBuffer()) m_pRing->flush(staging.offset, size);
+    else for (Buffer* pBuffer : m_batch.pBuffers) if (pBuffer->getBuffer() == staging.buffer) pBuffer->flush();
+    VkCommandBuffer commandBuffer = getCommandBuffer();
+    
+    VkBufferCopy copyRegion = { staging.offset, offset, size };
+    vkCmdCopyBuffer(commandBuffer, staging.buffer, buffer, 1, &copyRegion);
+    
+    VkBufferMemoryBarrier barrier{};
+    barrier.sType               = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+    barrier.srcAccessMask       = VK_ACCESS_TRANSFER_WRITE_BIT;
+    barrier.dstAccessMask       = VK_ACCESS_MEMORY_READ_BIT;
+    barrier.srcQueueFamilyIndex = m_transferFamily;
+    barrier.dstQueueFamilyIndex = m_graphicFamily;
+    barrier.buffer              = buffer;
+    barrier.offset              = offset;
+    barrier.size                = size;
+    
+    { m_batch.bufferBarriers.push_back(barrier); }
+}
+
+// Hands the images to the graphics queue in one barrier batch; callers fill image, range and layouts
+void Uploader::releaseImages(std::vector<VkImageMemoryBarrier> barriers) {
+    VkCommandBuffer commandBuffer        = getCommandBuffer();
+    VkCommandBuffer graphicCommandBuffer = getGraphicCommandBuffer();
+    if (m_transferFamily == m_graphicFamily || barriers.empty()) return;
+    
+    for (VkImageMemoryBarrier& barrier : barriers) {
+        barrier.srcAccessMask       = VK_ACCESS_TRANSFER_WRITE_BIT;
+        barrier.dstAccessMask       = 0;
+        barrier.srcQueueFamilyIndex = m_transferFamily;
+        barrier.dstQueueFamilyIndex = m_graphicFamily;
+    }
+    vkCmdPipelineBarrier(commandBuffer,
+                         VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, 0,
+                         0, nullptr,
+                         0, nullptr,
+                         UINT32(barriers.size()), barriers.data());
+    
+    for (VkImageMemoryBarrier& barrier : barriers) {
+        barrier.srcAccessMask = 0;
+        barrier.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT | VK_ACCESS_TRANSFER_WRITE_BIT;
+    }
+    vkCmdPipelineBarrier(graphicCommandBuffer,
+                         VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0,
+                         0, nullptr,
+                         0, nullptr,
+                         UINT32(barriers.size()), barriers.data());
+}
+
+// Runs once the batch being recorded completes, for objects its commands still reference
+void Uploader::retire(std::function<void()>&& destroy) {
+    getCommandBuffer();
+    m_batch.retired.push_back(std::move(destroy));
+}
+
+Uploader::Token Uploader::submit() {
+    if (m_batch.commandBuffer == VK_NULL_HANDLE) return m_submitCount;
+    LOG("Uploader::submit");
+    recordOwnership();
+    
+    VkDevice   device            = m_device;
+    Commander* commander         = System::Commander();
+    Commander* transferCommander = System::Renderer()->getTransferCommander();
+    Batch      batch             = m_batch;
+    
+    VkFenceCreateInfo fenceInfo{};
+    fenceInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+    VkResult result = vkCreateFence(device, &fenceInfo, nullptr, &batch.fence);
+    CHECK_VKRESULT(result, "failed to create upload fence!");
+    
+    if (batch.graphicCommandBuffer == VK_NULL_HANDLE) {
+        transferCommander->submitCommands(batch.commandBuffer, batch.fence);
+    } else {
+        VkSemaphoreCreateInfo semaphoreInfo{};
+        semaphoreInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+        result = vkCreateSemaphore(device, &semaphoreInfo, nullptr, &batch.semaphore);
+        CHECK_VKRESULT(result, "failed to create upload semaphore!");
+        
+        transferCommander->submitCommands(batch.commandBuffer, VK_NULL_HANDLE,
+                                          VK_NULL_HANDLE, batch.semaphore);
+        commander->submitCommands(batch.graphicCommandBuffer, batch.fence,
+                                  batch.semaphore, VK_NULL_HANDLE);
+    }
+    batch.end   = m_head;
+    batch.token = m_submitCount + 1;
+    
+    {
+        m_pending.push_back(batch);
+        m_batch = {};
+        m_submitCount++;
+    }
+    return batch.token;
+}
+
+bool Uploader::isComplete(Token token) {
+    reclaim();
+    return token <= m_completed;
+}
+
+void Uploader::wait(Token token) {
+    while (!m_pending.empty() && m_pending.front().token <= token) waitOldest();
+}
+
+void Uploader::wait() {
+    submit();
+    while (!m_pending.empty()) waitOldest();
+}
+
+void Uploader::reclaim() {
+    while (!m_pending.empty() && vkGetFenceStatus(m_device, m_pending.front().fence) == VK_SUCCESS) {
+        releaseBatch(m_pending.front());
+        m_pending.pop_front();
+    }
+}
+
+
+// Private ==================================================
+
+
+// head == tail only when the ring is empty, so a wrapped head must stay strictly below tail
+bool Uploader::fitRing(VkDeviceSize size, VkDeviceSize alignment, VkDeviceSize* offset) {
+    VkDeviceSize head = m_head;
+    VkDeviceSize tail = m_tail;
+    if (head == tail) head = tail = 0;
+    
+    VkDeviceSize start = AlignUp(head, alignment);
+    if (head >= tail) {
+        if      (start + size <= m_ringSize) head = start + size;
+        else if (size < tail) start = 0, head = size;
+        else return false;
+    } else {
+        if (start + size < tail) head = start + size;
+        else return false;
+    }
+    
+    {
+        *offset = start;
+        m_head  = head;
+        m_tail  = tail;
+    }
+    return true;
+}
+
+Uploader::Staging Uploader::reserveDedicated(VkDeviceSize size) {
+    LOG("Uploader::reserveDedicated");
+    Buffer* pBuffer = new Buffer();
+    pBuffer->setup(size, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, Allocator::CpuToGpu, Allocator::Linear);
+    pBuffer->create();
+    m_batch.pBuffers.push_back(pBuffer);
+    
+    Staging staging{};
+    staging.buffer = pBuffer->getBuffer();
+    staging.offset = 0;
+    staging.mapped = pBuffer->getMapped();
+    return staging;
+}
+
+// Buffer copies release and acquire in one barrier each per batch
+void Uploader::recordOwnership() {
+    std::vector<VkBufferMemoryBarrier> barriers = m_batch.bufferBarriers;
+    if (barriers.empty()) return;
+    if (m_transferFamily == m_graphicFamily) {
+        getGraphicCommandBuffer();
+        return;
+    }
+    
+    for (VkBufferMemoryBarrier& barrier : barriers) barrier.dstAccessMask = 0;
+    vkCmdPipelineBarrier(getCommandBuffer(),
+                         VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, 0,
+                         0, nullptr,
+                         UINT32(barriers.size()), barriers.data(),
+                         0, nullptr);
+    
+    barriers = m_batch.bufferBarriers;
+    for (VkBufferMemoryBarrier& barrier : barriers) barrier.srcAccessMask = 0;
+    vkCmdPipelineBarrier(getGraphicCommandBuffer(),
+                         VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT, 0,
+                         0, nullptr,
+                         UINT32(barriers.size()), barriers.data(),
+                         0, nullptr);
+}
+
+void Uploader::waitOldest() {
+    Batch& batch = m_pending.front();
+    VkResult result = vkWaitForFences(m_device, 1, &batch.fence, VK_TRUE, UINT64_MAX);
+    CHECK_VKRESULT(result, "failed to wait for upload fence!");
+    releaseBatch(batch);
+    m_pending.pop_front();
+}
+
+void Uploader::releaseBatch(Batch& batch) {
+    Commander* commander         = System::Commander();
+    Commander* transferCommander = System::Renderer()->getTransferCommander();
+    
+    vkDestroyFence    (m_device, batch.fence    , nullptr);
+    vkDestroySemaphore(m_device, batch.semaphore, nullptr);
+    transferCommander->freeCommandBuffer(batch.commandBuffer);
+    if (batch.graphicCommandBuffer != VK_NULL_HANDLE) commander->freeCommandBuffer(batch.graphicCommandBuffer);
+    for (Buffer* pBuffer : batch.pBuffers) {
+        pBuffer->cleanup();
+        delete pBuffer;
+    }
+    for (std::function<void()>& destroy : batch.retired) destroy();
+    
+    {
+        m_tail      = batch.end;
+        m_completed = batch.token;
+    }
+}
+
+VkDeviceSize Uploader::AlignUp(VkDeviceSize value, VkDeviceSize alignment) {
+    return (value + alignment - 1) / alignment * alignment;
+}
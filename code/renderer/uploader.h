@@ -0,0 +1,83 @@
+//  Copyright © 2021 Subph. All rights reserved.
+//
+
+#pragma once
+
+#include <deque>
+
+#include "../common.h"
+
+class Buffer;
+
+class Uploader {
+    
+public:
+    ~Uploader();
+    Uploader();
+    
+    typedef uint64_t Token;
+    
+    struct Staging {
+        VkBuffer     buffer = VK_NULL_HANDLE;
+        VkDeviceSize offset = 0;
+        void*        mapped = nullptr;
+    };
+    
+    void cleanup();
+    
+    void setup(VkDeviceSize ringSize);
+    void create();
+    
+    VkCommandBuffer getCommandBuffer       ();
+    VkCommandBuffer getGraphicCommandBuffer();
+    
+    Staging reserve(VkDeviceSize size, VkDeviceSize alignment = 4);
+    Staging stage  (const void* address, VkDeviceSize size, VkDeviceSize alignment = 4);
+    void    copyToBuffer(const Staging& staging, VkBuffer buffer, VkDeviceSize size, VkDeviceSize offset = 0);
+    void    releaseImages(std::vector<VkImageMemoryBarrier> barriers);
+    void    retire      (std::function<void()>&& destroy);
+    
+    Token submit    ();
+    bool  isComplete(Token token);
+    void  wait      (Token token);
+    void  wait      ();
+    void  reclaim   ();
+    
+private:
+    
+    struct Batch {
+        VkCommandBuffer      commandBuffer        = VK_NULL_HANDLE;
+        VkCommandBuffer      graphicCommandBuffer = VK_NULL_HANDLE;
+        VkSemaphore          semaphore            = VK_NULL_HANDLE;
+        VkFence              fence                = VK_NULL_HANDLE;
+        VkDeviceSize         end                  = 0;
+        Token                token                = 0;
+        std::vector<Buffer*> pBuffers;
+        std::vector<std::function<void()>> retired;
+        std::vector<VkBufferMemoryBarrier> bufferBarriers;
+    };
+    
+    VkDevice     m_device   = VK_NULL_HANDLE;
+    
+    uint32_t     m_graphicFamily  = 0;
+    uint32_t     m_transferFamily = 0;
+    
+    Buffer*      m_pRing    = nullptr;
+    VkDeviceSize m_ringSize = 64 * 1024 * 1024;
+    VkDeviceSize m_head     = 0;
+    VkDeviceSize m_tail     = 0;
+    
+    Batch             m_batch{};
+    std::deque<Batch> m_pending;
+    
+    Token    m_completed   = 0;
+    uint32_t m_submitCount = 0;
+    
+    bool    fitRing         (VkDeviceSize size, VkDeviceSize alignment, VkDeviceSize* offset);
+    Staging reserveDedicated(VkDeviceSize size);
+    void    recordOwnership ();
+    void    waitOldest      ();
+    void    releaseBatch    (Batch& batch);
+    
+    static VkDeviceSize AlignUp(VkDeviceSize value, VkDeviceSize alignment);
+};
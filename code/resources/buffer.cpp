@@ -16,17 +16,23 @@ Buffer::Buffer() : m_bufferInfo(GetDefaultBufferCreateInfo()) {
 
 void Buffer::cleanup() {
     LOG("Buffer::cleanup");
-    vkDestroyBuffer   (m_device, m_buffer      , nullptr);
-    vkFreeMemory      (m_device, m_bufferMemory, nullptr);
+    vkDestroyBuffer(m_device, m_buffer, nullptr);
+    System::Allocator()->free(m_allocation);
+    m_bufferMemory = VK_NULL_HANDLE;
 }
 
-void Buffer::setup(VkDeviceSize size, VkBufferUsageFlags usage) {
+void Buffer::setup(VkDeviceSize size, VkBufferUsageFlags usage, Allocator::MemoryUsage memoryUsage,
+                   Allocator::Strategy strategy) {
     VkBufferCreateInfo bufferInfo = m_bufferInfo;
     
     bufferInfo.size  = size;
     bufferInfo.usage = usage;
     
-    m_bufferInfo = bufferInfo;
+    {
+        m_bufferInfo  = bufferInfo;
+        m_memoryUsage = memoryUsage;
+        m_strategy    = strategy;
+    }
 }
 
 void Buffer::create() {
@@ -42,31 +48,15 @@ void Buffer::createBuffer() {
 
 void Buffer::allocateBufferMemory() {
     LOG("Buffer::allocateBufferMemory");
-    VkDevice         device         = m_device;
-    VkPhysicalDevice physicalDevice = m_physicalDevice;
-    VkBuffer         buffer         = m_buffer;
+    Allocator* allocator = System::Allocator();
     
-    VkMemoryRequirements memoryRequirements;
-    vkGetBufferMemoryRequirements(device, buffer, &memoryRequirements);
+    Allocator::Category category = GetCategory(m_bufferInfo.usage);
     
-    uint32_t memoryTypeIndex;
-    memoryTypeIndex = FindMemoryTypeIndex(physicalDevice,
-                                          memoryRequirements.memoryTypeBits,
-                                          VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT |
-                                          VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
-    
-    VkMemoryAllocateInfo allocInfo{};
-    allocInfo.sType           = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
-    allocInfo.allocationSize  = memoryRequirements.size;
-    allocInfo.memoryTypeIndex = memoryTypeIndex;
-    
-    VkDeviceMemory bufferMemory;
-    VkResult       result = vkAllocateMemory(device, &allocInfo, nullptr, &bufferMemory);
-    CHECK_VKRESULT(result, "failed to allocate buffer memory!");
-    
-    vkBindBufferMemory(device, buffer, bufferMemory, 0);
-    
-    { m_bufferMemory = bufferMemory; }
+    Allocation allocation = allocator->allocateBuffer(m_buffer, m_memoryUsage, m_strategy, category);
+    {
+        m_allocation   = allocation;
+        m_bufferMemory = allocation.memory;
+    }
 }
 
 void Buffer::cmdCopyFromBuffer(VkBuffer sourceBuffer, VkDeviceSize size) {
@@ -81,11 +71,22 @@ void Buffer::cmdCopyFromBuffer(VkBuffer sourceBuffer, VkDeviceSize size) {
     commander->endSingleTimeCommands(commandBuffer);
 }
 
+void Buffer::cmdFillBuffer(uint32_t data) {
+    LOG("Buffer::cmdFillBuffer");
+    VkBuffer     buffer     = m_buffer;
+    Commander*   commander  = System::Commander();
+    
+    VkCommandBuffer commandBuffer = commander->createCommandBuffer();
+    commander->beginSingleTimeCommands(commandBuffer);
+    vkCmdFillBuffer(commandBuffer, buffer, 0, VK_WHOLE_SIZE, data);
+    commander->endSingleTimeCommands(commandBuffer);
+}
+
 void* Buffer::fillBuffer(const void* address, VkDeviceSize size, uint32_t shift) {
-    void* ptr = mapMemory(size);
+    void* ptr = mapMemory(size + shift);
     ptr = static_cast<char*>(ptr) + shift;
     memcpy(ptr, address, size);
-    unmapMemory();
+    flush(shift, size);
     return ptr;
 }
 
@@ -93,14 +94,23 @@ void* Buffer::fillBufferFull(const void* address) {
     return fillBuffer(address, static_cast<size_t>(m_bufferInfo.size));
 }
 
+// Memory blocks stay mapped for their lifetime, so mapping only hands out the suballocation
 void* Buffer::mapMemory(VkDeviceSize size) {
-    void* ptr;
-    vkMapMemory(m_device, m_bufferMemory, 0, size, 0, &ptr);
-    return ptr;
+    CHECK_POINTER(m_allocation.mapped, "buffer memory is not host visible!");
+    CHECK_BOOL((size <= m_allocation.size), "mapping range exceeds buffer memory!");
+    return m_allocation.mapped;
 }
 
-void Buffer::unmapMemory() {
-    vkUnmapMemory(m_device, m_bufferMemory);
+void Buffer::unmapMemory() { flush(); }
+
+void* Buffer::getMapped() { return m_allocation.mapped; }
+
+void Buffer::flush(VkDeviceSize offset, VkDeviceSize size) {
+    System::Allocator()->flush(m_allocation, offset, size);
+}
+
+void Buffer::invalidate(VkDeviceSize offset, VkDeviceSize size) {
+    System::Allocator()->invalidate(m_allocation, offset, size);
 }
 
 VkBuffer       Buffer::getBuffer      () { return m_buffer;       }
@@ -124,3 +134,11 @@ VkBufferCreateInfo Buffer::GetDefaultBufferCreateInfo() {
     bufferInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
     return bufferInfo;
 }
+
+Allocator::Category Buffer::GetCategory(VkBufferUsageFlags usage) {
+    if (usage & (VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_INDEX_BUFFER_BIT)) return Allocator::Mesh;
+    if (usage & VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT)  return Allocator::Uniform;
+    if (usage & VK_BUFFER_USAGE_STORAGE_BUFFER_BIT)  return Allocator::Compute;
+    if (usage & VK_BUFFER_USAGE_TRANSFER_SRC_BIT)    return Allocator::Staging;
+    return Allocator::Other;
+}
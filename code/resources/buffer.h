@@ -4,6 +4,7 @@
 #pragma once
 
 #include "../common.h"
+#include "../renderer/allocator.h"
 
 class Buffer {
     
@@ -20,21 +21,26 @@ public:
     
     VkBuffer         m_buffer         = VK_NULL_HANDLE;
     VkDeviceMemory   m_bufferMemory   = VK_NULL_HANDLE;
+    Allocation       m_allocation{};
     
-    VkBufferCreateInfo m_bufferInfo{};
+    VkBufferCreateInfo     m_bufferInfo{};
+    Allocator::MemoryUsage m_memoryUsage = Allocator::GpuOnly;
+    Allocator::Strategy    m_strategy    = Allocator::FreeList;
     
     VkBuffer       getBuffer();
     VkDeviceSize   getBufferSize();
     VkDeviceMemory getBufferMemory();
     VkDescriptorBufferInfo getBufferInfo();
     
-    void setup (VkDeviceSize size, VkBufferUsageFlags usage);
+    void setup (VkDeviceSize size, VkBufferUsageFlags usage, Allocator::MemoryUsage memoryUsage,
+                Allocator::Strategy strategy = Allocator::FreeList);
     void create();
     
     void createBuffer();
     void allocateBufferMemory();
     
     void cmdCopyFromBuffer(VkBuffer sourceBuffer, VkDeviceSize size);
+    void cmdFillBuffer    (uint32_t data);
     
     void* fillBuffer    (const void* address, VkDeviceSize size, uint32_t shift = 0);
     void* fillBufferFull(const void* address);
@@ -42,11 +48,16 @@ public:
     void* mapMemory(VkDeviceSize size);
     void  unmapMemory();
     
+    void* getMapped ();
+    void  flush     (VkDeviceSize offset = 0, VkDeviceSize size = VK_WHOLE_SIZE);
+    void  invalidate(VkDeviceSize offset = 0, VkDeviceSize size = VK_WHOLE_SIZE);
+    
     
 private:
     
     VkBuffer createBuffer(VkDeviceSize size, VkBufferUsageFlags usage);
     VkDeviceMemory allocateBufferMemory(VkBuffer& buffer, VkDeviceSize size, uint32_t memoryTypeIndex);
     
-    static VkBufferCreateInfo GetDefaultBufferCreateInfo();
+    static VkBufferCreateInfo  GetDefaultBufferCreateInfo();
+    static Allocator::Category GetCategory(VkBufferUsageFlags usage);
 };
@@ -0,0 +1,203 @@
+//  Copyright © 2021 Subph. All rights reserved.
+//
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <immintrin.h>
+#define HDR_SSE
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+#include <arm_neon.h>
+#define HDR_NEON
+#endif
+
+#include "hdr.h"
+
+#define E5B9G9R9_MANTISSA_BITS 9
+#define E5B9G9R9_EXPONENT_BIAS 15
+#define E5B9G9R9_MAX_VALUE     (511.f / 512.f * 65536.f)
+
+// Four floats to four halves at once. Without F16C the SSE2 version does the rounding with integer
+// math: subnormals through a magic add, normals by rebiasing the exponent and adding half an ulp
+static inline void ConvertHalf4(const float* values, uint16_t* output) {
+#if defined(HDR_SSE) && defined(__F16C__)
+    __m128i halves = _mm_cvtps_ph(_mm_loadu_ps(values), _MM_FROUND_TO_NEAREST_INT);
+    _mm_storel_epi64((__m128i*) output, halves);
+#elif defined(HDR_SSE)
+    __m128  value      = _mm_loadu_ps(values);
+    __m128  sign       = _mm_and_ps(value, _mm_castsi128_ps(_mm_set1_epi32(int32_t(0x80000000u))));
+    __m128  absolute   = _mm_xor_ps(value, sign);
+    __m128i bits       = _mm_castps_si128(absolute);
+    __m128  isNan      = _mm_cmpunord_ps(absolute, absolute);
+    __m128i isFinite   = _mm_cmpgt_epi32(_mm_set1_epi32((127 + 16) << 23), bits);
+    __m128i special    = _mm_or_si128(_mm_and_si128(_mm_castps_si128(isNan), _mm_set1_epi32(0x200)),
+                                      _mm_set1_epi32(0x7C00));
+
+    __m128i isSubnormal = _mm_cmpgt_epi32(_mm_set1_epi32((127 - 14) << 23), bits);
+    __m128i magic       = _mm_set1_epi32(((127 - 15) + (23 - 10) + 1) << 23);
+    __m128i subnormal   = _mm_sub_epi32(_mm_castps_si128(_mm_add_ps(absolute, _mm_castsi128_ps(magic))), magic);
+
+    __m128i isOdd   = _mm_srai_epi32(_mm_slli_epi32(bits, 31 - 13), 31);
+    __m128i rounded = _mm_sub_epi32(_mm_add_epi32(bits, _mm_set1_epi32(0xFFF - ((127 - 15) << 23))), isOdd);
+    __m128i normal  = _mm_srli_epi32(rounded, 13);
+
+    __m128i finite = _mm_or_si128(_mm_and_si128(isSubnormal, subnormal), _mm_andnot_si128(isSubnormal, normal));
+    __m128i halves = _mm_or_si128(_mm_and_si128(isFinite, finite), _mm_andnot_si128(isFinite, special));
+    halves = _mm_or_si128(halves, _mm_srai_epi32(_mm_castps_si128(sign), 16));
+
+    // Sign extending the low 16 bits lets the saturating pack pass every half through unchanged
+    halves = _mm_srai_epi32(_mm_slli_epi32(halves, 16), 16);
+    _mm_storel_epi64((__m128i*) output, _mm_packs_epi32(halves, halves));
+#elif defined(HDR_NEON)
+    vst1_u16(output, vreinterpret_u16_f16(vcvt_f16_f32(vld1q_f32(values))));
+#else
+    for (int c = 0; c < 4; c++) output[c] = FloatToHalf(values[c]);
+#endif
+}
+
+// Drops mantissa bits of a non-negative half with round to nearest even; finite values saturate instead of
+// rounding up to infinity
+static uint32_t HalfToUnsignedFloat(uint16_t half, uint32_t droppedBits) {
+    if (half >= 0x7C00) return half == 0x7C00 ? 0x7C00u >> droppedBits : (0x7C00u >> droppedBits) | 1;
+    uint32_t rounded = (half + (1u << (droppedBits - 1)) - 1 + ((half >> droppedBits) & 1)) >> droppedBits;
+    return std::min(rounded, 0x7BFFu >> droppedBits);
+}
+
+static uint32_t PackHalvesB10G11R11(const uint16_t halves[3]) {
+    return HalfToUnsignedFloat(halves[0], 4) | HalfToUnsignedFloat(halves[1], 4) << 11 |
+           HalfToUnsignedFloat(halves[2], 5) << 22;
+}
+
+VkFormat ChooseHDRFormat(VkPhysicalDevice physicalDevice, VkFormatFeatureFlags features) {
+    const VkFormat candidates[] = {
+        VK_FORMAT_E5B9G9R9_UFLOAT_PACK32,
+        VK_FORMAT_B10G11R11_UFLOAT_PACK32,
+        VK_FORMAT_R16G16B16A16_SFLOAT
+    };
+    for (VkFormat format : candidates) {
+        VkFormatProperties properties;
+        vkGetPhysicalDeviceFormatProperties(physicalDevice, format, &properties);
+        if ((properties.optimalTilingFeatures & features) == features) return format;
+    }
+    return VK_FORMAT_R16G16B16A16_SFLOAT;
+}
+
+// Runs serially from the front: every texel is read before its output is written, and the output
+// never overtakes the source, so converting in place is safe
+void ConvertHDR(const float* source, uint32_t channels, size_t count, VkFormat format, void* output) {
+    CHECK_BOOL((channels == 3 || channels == 4), "hdr source needs 3 or 4 channels!");
+    uint16_t* halves = static_cast<uint16_t*>(output);
+    uint32_t* packed = static_cast<uint32_t*>(output);
+
+    for (size_t i = 0; i < count; i++) {
+        float texel[4] = { source[i * channels], source[i * channels + 1], source[i * channels + 2],
+                           channels == 4 ? source[i * channels + 3] : 1.f };
+        switch (format) {
+            case VK_FORMAT_R16G16B16A16_SFLOAT:
+                ConvertHalf4(texel, halves + i * 4);
+                break;
+            case VK_FORMAT_B10G11R11_UFLOAT_PACK32: {
+                uint16_t texelHalves[4];
+                for (int c = 0; c < 3; c++) texel[c] = texel[c] > 0.f ? texel[c] : 0.f;
+                ConvertHalf4(texel, texelHalves);
+                packed[i] = PackHalvesB10G11R11(texelHalves);
+            } break;
+            case VK_FORMAT_E5B9G9R9_UFLOAT_PACK32:
+                packed[i] = PackE5B9G9R9(texel);
+                break;
+            default:
+                RUNTIME_ERROR("unsupported hdr format!");
+        }
+    }
+}
+
+uint32_t GetHDRTexelSize(VkFormat format) {
+    switch (format) {
+        case VK_FORMAT_R16G16B16A16_SFLOAT    : return 8;
+        case VK_FORMAT_B10G11R11_UFLOAT_PACK32: return 4;
+        case VK_FORMAT_E5B9G9R9_UFLOAT_PACK32 : return 4;
+        default: return 0;
+    }
+}
+
+uint16_t FloatToHalf(float value) {
+    uint32_t bits;
+    memcpy(&bits, &value, 4);
+    uint32_t sign     = (bits >> 16) & 0x8000;
+    int32_t  exponent = int32_t((bits >> 23) & 0xFF) - 112;
+    uint32_t mantissa = bits & 0x7FFFFF;
+    if (((bits >> 23) & 0xFF) == 0xFF) return uint16_t(sign | 0x7C00 | (mantissa ? 0x200 : 0));
+    if (exponent >= 0x1F) return uint16_t(sign | 0x7C00);
+    if (exponent <= 0) {
+        if (exponent < -10) return uint16_t(sign);
+        mantissa |= 0x800000;
+        uint32_t shift = uint32_t(14 - exponent);
+        uint32_t half  = mantissa >> shift;
+        uint32_t rest  = mantissa & ((1u << shift) - 1);
+        uint32_t mid   = 1u << (shift - 1);
+        if (rest > mid || (rest == mid && (half & 1))) half++;
+        return uint16_t(sign | half);
+    }
+    uint32_t half = sign | (uint32_t(exponent) << 10) | (mantissa >> 13);
+    uint32_t rest = mantissa & 0x1FFF;
+    if (rest > 0x1000 || (rest == 0x1000 && (half & 1))) half++;
+    return uint16_t(half);
+}
+
+float HalfToFloat(uint16_t half) {
+    uint32_t sign     = uint32_t(half & 0x8000) << 16;
+    uint32_t exponent = (half >> 10) & 0x1F;
+    uint32_t mantissa = half & 0x3FF;
+    uint32_t bits;
+    if (exponent == 0x1F) bits = sign | 0x7F800000 | (mantissa << 13);
+    else if (exponent != 0) bits = sign | ((exponent + 112) << 23) | (mantissa << 13);
+    else if (mantissa == 0) bits = sign;
+    else {
+        float value = mantissa / 16777216.f;
+        memcpy(&bits, &value, 4);
+        bits |= sign;
+    }
+    float value;
+    memcpy(&value, &bits, 4);
+    return value;
+}
+
+uint32_t PackB10G11R11(const float rgb[3]) {
+    uint16_t halves[3];
+    for (int c = 0; c < 3; c++) halves[c] = FloatToHalf(rgb[c] > 0.f ? rgb[c] : 0.f);
+    return PackHalvesB10G11R11(halves);
+}
+
+void UnpackB10G11R11(uint32_t packed, float rgb[3]) {
+    rgb[0] = HalfToFloat(uint16_t((packed       & 0x7FF) << 4));
+    rgb[1] = HalfToFloat(uint16_t((packed >> 11 & 0x7FF) << 4));
+    rgb[2] = HalfToFloat(uint16_t((packed >> 22 & 0x3FF) << 5));
+}
+
+// The shared exponent fits the largest channel, following the packing in the Vulkan spec
+uint32_t PackE5B9G9R9(const float rgb[3]) {
+    float clamped[3];
+    for (int c = 0; c < 3; c++) clamped[c] = rgb[c] > 0.f ? std::min(rgb[c], E5B9G9R9_MAX_VALUE) : 0.f;
+    float maxValue = std::max(clamped[0], std::max(clamped[1], clamped[2]));
+    if (maxValue == 0.f) return 0;
+
+    int exponent;
+    std::frexp(maxValue, &exponent);
+    int   shared = std::max(-E5B9G9R9_EXPONENT_BIAS - 1, exponent - 1) + 1 + E5B9G9R9_EXPONENT_BIAS;
+    float scale  = std::ldexp(1.f, shared - E5B9G9R9_EXPONENT_BIAS - E5B9G9R9_MANTISSA_BITS);
+    if (std::floor(maxValue / scale + 0.5f) == float(1 << E5B9G9R9_MANTISSA_BITS)) {
+        shared++;
+        scale *= 2.f;
+    }
+
+    uint32_t packed = uint32_t(shared) << 27;
+    for (int c = 0; c < 3; c++) packed |= uint32_t(std::floor(clamped[c] / scale + 0.5f)) << (9 * c);
+    return packed;
+}
+
+void UnpackE5B9G9R9(uint32_t packed, float rgb[3]) {
+    float scale = std::ldexp(1.f, int(packed >> 27) - E5B9G9R9_EXPONENT_BIAS - E5B9G9R9_MANTISSA_BITS);
+    for (int c = 0; c < 3; c++) rgb[c] = float(packed >> (9 * c) & 0x1FF) * scale;
+}
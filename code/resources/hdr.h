@@ -0,0 +1,24 @@
+//  Copyright © 2021 Subph. All rights reserved.
+//
+
+#pragma once
+
+#include "../common.h"
+
+// Candidates from smallest to largest; RGBA16F sampling with linear filtering is guaranteed by the spec
+VkFormat ChooseHDRFormat(VkPhysicalDevice physicalDevice, VkFormatFeatureFlags features);
+
+// Converts count texels of 3 or 4 floats; the output may alias the source, which is never smaller
+void ConvertHDR(const float* source, uint32_t channels, size_t count, VkFormat format, void* output);
+
+uint32_t GetHDRTexelSize(VkFormat format);
+
+// Round to nearest even, like the hardware conversions
+uint16_t FloatToHalf(float value);
+float    HalfToFloat(uint16_t half);
+
+// Negative values and NaN clamp to 0
+uint32_t PackB10G11R11  (const float rgb[3]);
+void     UnpackB10G11R11(uint32_t packed, float rgb[3]);
+uint32_t PackE5B9G9R9   (const float rgb[3]);
+void     UnpackE5B9G9R9 (uint32_t packed, float rgb[3]);
@@ -6,6 +6,8 @@
 #include "../helper.h"
 #include "../system.h"
 #include "buffer.h"
+#include "hdr.h"
+#include "../renderer/downsampler.h"
 
 Image::~Image() {}
 Image::Image() : m_imageInfo(GetDefaultImageCreateInfo()), m_imageViewInfo(GetDefaultImageViewCreateInfo()) {
@@ -16,17 +18,17 @@ Image::Image() : m_imageInfo(GetDefaultImageCreateInfo()), m_imageViewInfo(GetDe
 
 void Image::cleanup() {
     LOG("Image::cleanup");
+    freeRawData();
     cleanupImageView();
     if (m_image == VK_NULL_HANDLE) return;
     vkDestroyImage(m_device, m_image, nullptr);
-    if (m_sampler == VK_NULL_HANDLE) return;
-    vkDestroySampler(m_device, m_sampler, nullptr);
+    System::Allocator()->free(m_allocation);
+    m_imageMemory = VK_NULL_HANDLE;
 }
 
 void Image::cleanupImageView() {
     LOG("Image::cleanupImageView");
-    vkDestroyImageView(m_device, m_imageView  , nullptr);
-    vkFreeMemory      (m_device, m_imageMemory, nullptr);
+    vkDestroyImageView(m_device, m_imageView, nullptr);
 }
 
 void Image::setupForDepth(Size<uint32_t> size, uint32_t mipLevels) {
@@ -53,11 +55,84 @@ void Image::setupForDepth(Size<uint32_t> size, uint32_t mipLevels) {
     }
 }
 
-void Image::setupForTexture(const std::string filepath) {
+// A miss builds the chain once on the CPU, then caches and uploads it, so cold and warm launches sample the same mips.
+// Data such as normal maps loads as UNORM; a blob cached in another format counts as a miss and is rewritten
+void Image::setupForTexture(const std::string filepath, VkFormat format) {
     LOG("Image::setupForTexture");
+    std::string   cachePath = GetTextureCachePath(filepath);
+    CachedTexture cached;
+    if (MapCachedTexture(cachePath, &cached)) {
+        if (cached.format == format) {
+            setupForCachedTexture(cached);
+            return;
+        }
+        UnmapCachedTexture(&cached);
+    }
+    
+    int width, height, channels;
+    unsigned char* data = LoadImage(filepath, &width, &height, &channels);
+    CHECK_BOOL((data != nullptr), "failed to load texture!");
+    MipChain chain = GenerateMipChain(data, width, height, format, MipFilterKaiser);
+    FreeImage(data);
+    WriteCachedTexture(cachePath, chain, width, height, format);
+    setupForMipChain(std::move(chain), width, height, format);
+}
+
+// The red channel of each source goes to R, G and B in order; channels past the sources read 0, alpha reads 1
+void Image::setupForPackedTexture(const std::vector<std::string> filepaths) {
+    LOG("Image::setupForPackedTexture");
+    CHECK_BOOL((!filepaths.empty() && filepaths.size() <= 4), "packed texture takes 1 to 4 sources!");
+    std::string   cachePath = GetTextureCachePath(filepaths);
+    CachedTexture cached;
+    if (MapCachedTexture(cachePath, &cached)) {
+        setupForCachedTexture(cached);
+        return;
+    }
+    
+    ThreadPool* pool  = System::ThreadPool();
+    size_t      count = filepaths.size();
+    std::vector<unsigned char*> sources(count);
+    std::vector<Size<int>>      sizes(count);
+    std::vector<std::future<void>> decodes;
+    for (size_t i = 0; i < count; i++) {
+        decodes.push_back(pool->push([&sources, &sizes, &filepaths, i]() {
+            int channels;
+            sources[i] = LoadImage(filepaths[i], &sizes[i].width, &sizes[i].height, &channels);
+        }));
+    }
+    for (std::future<void>& decode : decodes) pool->wait(decode);
+    
+    for (size_t i = 0; i < count; i++) {
+        CHECK_BOOL((sources[i] != nullptr), "failed to load packed texture source!");
+        CHECK_BOOL((sizes[i].width == sizes[0].width && sizes[i].height == sizes[0].height),
+                   "packed texture sources differ in size!");
+    }
+    
+    // The first source's buffer becomes the packed one
+    int            width     = sizes[0].width;
+    int            height    = sizes[0].height;
+    unsigned char* data      = sources[0];
+    for (size_t texel = 0; texel < size_t(width) * height; texel++) {
+        unsigned char* output = data + texel * 4;
+        for (size_t c = 1; c < 4; c++) output[c] = c < count ? sources[c][texel * 4] : (c == 3 ? 255 : 0);
+    }
+    for (size_t i = 1; i < count; i++) FreeImage(sources[i]);
+    MipChain chain = GenerateMipChain(data, width, height, VK_FORMAT_R8G8B8A8_UNORM, MipFilterKaiser);
+    FreeImage(data);
+    WriteCachedTexture(cachePath, chain, width, height, VK_FORMAT_R8G8B8A8_UNORM);
+    setupForMipChain(std::move(chain), width, height, VK_FORMAT_R8G8B8A8_UNORM);
+}
+
+// Float texels are converted in place to the most compact filterable HDR format the device has
+void Image::setupForHDRTexture(const std::string filepath) {
+    LOG("Image::setupForHDRTexture");
     int width, height, channels;
-    unsigned char*  data      = LoadImage(filepath, &width, &height, &channels);
-    uint32_t        mipLevels = MaxMipLevel(width, height);
+    float*   data      = LoadHDR(filepath, &width, &height, &channels);
+    CHECK_BOOL((data != nullptr), "failed to load hdr texture!");
+    uint32_t mipLevels = MaxMipLevel(width, height);
+    VkFormat format    = ChooseHDRFormat(m_physicalDevice, VK_FORMAT_FEATURE_SAMPLED_IMAGE_BIT |
+                                                           VK_FORMAT_FEATURE_SAMPLED_IMAGE_FILTER_LINEAR_BIT);
+    ConvertHDR(data, channels, size_t(width) * height, format, data);
     
     VkImageCreateInfo     imageInfo      = m_imageInfo;
     VkImageViewCreateInfo imageViewInfo  = m_imageViewInfo;
@@ -65,45 +140,98 @@ void Image::setupForTexture(const std::string filepath) {
     imageInfo.extent.width  = width;
     imageInfo.extent.height = height;
     imageInfo.mipLevels     = mipLevels;
-    imageInfo.format        = VK_FORMAT_R8G8B8A8_SRGB;
+    imageInfo.format        = format;
     imageInfo.usage         = VK_IMAGE_USAGE_TRANSFER_SRC_BIT |
                               VK_IMAGE_USAGE_TRANSFER_DST_BIT |
                               VK_IMAGE_USAGE_SAMPLED_BIT;
     
-    imageViewInfo.format = VK_FORMAT_R8G8B8A8_SRGB;
+    imageViewInfo.format = format;
     imageViewInfo.subresourceRange.levelCount = mipLevels;
     imageViewInfo.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
     
     {
-        m_rawData       = data;
+        m_rawHDR        = data;
         m_imageInfo     = imageInfo;
         m_imageViewInfo = imageViewInfo;
     }
+    prepareMipmaps();
 }
 
-void Image::setupForHDRTexture(const std::string filepath) {
-    LOG("Image::setupForHDRTexture");
-    int width, height, channels;
-    float*   data      = LoadHDR(filepath, &width, &height, &channels);
-    uint32_t mipLevels = MaxMipLevel(width, height);
+void Image::setupForCachedTexture(const CachedTexture& texture) {
+    LOG("Image::setupForCachedTexture");
+    VkImageCreateInfo     imageInfo      = m_imageInfo;
+    VkImageViewCreateInfo imageViewInfo  = m_imageViewInfo;
+    uint32_t              mipLevels      = UINT32(texture.levels.size());
+    
+    imageInfo.extent.width  = texture.width;
+    imageInfo.extent.height = texture.height;
+    imageInfo.mipLevels     = mipLevels;
+    imageInfo.format        = texture.format;
+    imageInfo.usage         = VK_IMAGE_USAGE_TRANSFER_DST_BIT |
+                              VK_IMAGE_USAGE_SAMPLED_BIT;
+    
+    imageViewInfo.format = texture.format;
+    imageViewInfo.subresourceRange.levelCount = mipLevels;
+    imageViewInfo.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
     
+    {
+        m_rawCached     = texture;
+        m_hasCookedMips = true;
+        m_imageInfo     = imageInfo;
+        m_imageViewInfo = imageViewInfo;
+    }
+}
+
+void Image::setupForMipChain(MipChain chain, uint32_t width, uint32_t height, VkFormat format) {
     VkImageCreateInfo     imageInfo      = m_imageInfo;
     VkImageViewCreateInfo imageViewInfo  = m_imageViewInfo;
+    uint32_t              mipLevels      = UINT32(chain.levels.size());
     
     imageInfo.extent.width  = width;
     imageInfo.extent.height = height;
     imageInfo.mipLevels     = mipLevels;
-    imageInfo.format        = VK_FORMAT_R32G32B32_SFLOAT;
-    imageInfo.usage         = VK_IMAGE_USAGE_TRANSFER_SRC_BIT |
-                              VK_IMAGE_USAGE_TRANSFER_DST_BIT |
+    imageInfo.format        = format;
+    imageInfo.usage         = VK_IMAGE_USAGE_TRANSFER_DST_BIT |
                               VK_IMAGE_USAGE_SAMPLED_BIT;
     
-    imageViewInfo.format = VK_FORMAT_R32G32B32_SFLOAT;
+    imageViewInfo.format = format;
     imageViewInfo.subresourceRange.levelCount = mipLevels;
     imageViewInfo.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
     
     {
-        m_rawHDR        = data;
+        m_rawMips       = { std::move(chain) };
+        m_hasCookedMips = true;
+        m_imageInfo     = imageInfo;
+        m_imageViewInfo = imageViewInfo;
+    }
+}
+
+// Every level comes from the file, so no blits run
+void Image::setupForCompressedTexture(const std::string filepath) {
+    LOG("Image::setupForCompressedTexture");
+    Ktx2Image texture;
+    bool isLoaded = ReadKtx2(filepath, &texture);
+    CHECK_BOOL(isLoaded, "failed to load ktx2 texture!");
+    CHECK_BOOL(IsCompressedFormat(texture.format), "unsupported ktx2 texture format!");
+    
+    VkImageCreateInfo     imageInfo      = m_imageInfo;
+    VkImageViewCreateInfo imageViewInfo  = m_imageViewInfo;
+    uint32_t              mipLevels      = UINT32(texture.levels.size());
+    
+    imageInfo.extent.width  = texture.width;
+    imageInfo.extent.height = texture.height;
+    imageInfo.mipLevels     = mipLevels;
+    imageInfo.format        = texture.format;
+    imageInfo.usage         = VK_IMAGE_USAGE_TRANSFER_DST_BIT |
+                              VK_IMAGE_USAGE_SAMPLED_BIT;
+    
+    imageViewInfo.format = texture.format;
+    imageViewInfo.subresourceRange.levelCount = mipLevels;
+    imageViewInfo.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+    
+    {
+        m_rawCompressed = std::move(texture);
+        m_hasCookedMips = true;
         m_imageInfo     = imageInfo;
         m_imageViewInfo = imageViewInfo;
     }
@@ -111,15 +239,24 @@ void Image::setupForHDRTexture(const std::string filepath) {
 
 void Image::setupForCubemap(const std::string *filepaths) {
     LOG("Image::setupForCubemap");
+    ThreadPool* pool = System::ThreadPool();
     int width = 0, height = 0, channels = 0;
-    std::vector<unsigned char*> data;
+    std::vector<unsigned char*> data(6);
     
+    // Faces decode independently; waiting through the pool keeps this safe to call from a worker
+    std::vector<std::future<void>> decodes;
     for (int i = 0; i < 6; ++i) {
-        data.push_back(LoadImage(filepaths[i], &width, &height, &channels));
+        decodes.push_back(pool->push([&data, &width, &height, filepaths, i]() {
+            int faceWidth, faceHeight, faceChannels;
+            data[i] = LoadImage(filepaths[i], &faceWidth, &faceHeight, &faceChannels);
+            if (i == 0) { width = faceWidth; height = faceHeight; }
+        }));
     }
+    for (std::future<void>& decode : decodes) pool->wait(decode);
     setupForCubemap({ (uint)width, (uint)height });
     
     { m_rawCubemap    = data; }
+    prepareMipmaps();
 }
 
 void Image::setupForCubemap(Size<uint> size) {
@@ -150,6 +287,28 @@ void Image::setupForCubemap(Size<uint> size) {
     
 }
 
+// Filled piecewise by copies, like a virtual texture's page cache or page table
+void Image::setupForTiles(Size<uint32_t> size, uint32_t mipLevels, VkFormat format) {
+    LOG("Image::setupForTiles");
+    VkImageCreateInfo     imageInfo      = m_imageInfo;
+    VkImageViewCreateInfo imageViewInfo  = m_imageViewInfo;
+    
+    imageInfo.extent.width  = size.width;
+    imageInfo.extent.height = size.height;
+    imageInfo.mipLevels     = mipLevels;
+    imageInfo.format        = format;
+    imageInfo.usage         = VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT;
+    
+    imageViewInfo.format = format;
+    imageViewInfo.subresourceRange.levelCount = mipLevels;
+    imageViewInfo.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+    
+    {
+        m_imageInfo     = imageInfo;
+        m_imageViewInfo = imageViewInfo;
+    }
+}
+
 void Image::setupForSwapchain(VkImage image, VkFormat imageFormat) {
     LOG("Image::setupForSwapchain");
     m_image = image;
@@ -175,6 +334,7 @@ void Image::create() {
 }
 
 void Image::createForTexture() {
+    prepareStreaming();
     createImage();
     allocateImageMemory();
     createImageView();
@@ -207,291 +367,493 @@ void Image::createImageView() {
 
 void Image::allocateImageMemory() {
     LOG("Image::allocateImageMemory");
-    VkDevice         device         = m_device;
-    VkPhysicalDevice physicalDevice = m_physicalDevice;
-    VkImage          image          = m_image;
+    Allocator* allocator = System::Allocator();
+    bool       isLinear  = m_imageInfo.tiling == VK_IMAGE_TILING_LINEAR;
     
-    VkMemoryRequirements memoryRequirements;
-    vkGetImageMemoryRequirements(device, image, &memoryRequirements);
+    Allocator::Category category = GetCategory(m_imageInfo.usage);
     
-    uint32_t memoryTypeIndex;
-    memoryTypeIndex = FindMemoryTypeIndex(physicalDevice,
-                                          memoryRequirements.memoryTypeBits,
-                                          VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+    Allocation allocation = allocator->allocateImage(m_image, Allocator::GpuOnly, isLinear, category);
     
-    VkMemoryAllocateInfo allocInfo{};
-    allocInfo.sType           = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
-    allocInfo.allocationSize  = memoryRequirements.size;
-    allocInfo.memoryTypeIndex = memoryTypeIndex;
-    
-    VkDeviceMemory imageMemory;
-    VkResult       result = vkAllocateMemory(device, &allocInfo, nullptr, &imageMemory);
-    CHECK_VKRESULT(result, "failed to allocate image memory!");
-    
-    vkBindImageMemory(device, image, imageMemory, 0);
-    
-    { m_imageMemory = imageMemory; }
+    {
+        m_allocation  = allocation;
+        m_imageMemory = allocation.memory;
+    }
 }
 
 void Image::createSampler() {
     LOG("Image::createSampler");
-    VkDevice device    = m_device;
-    float    mipLevels = m_imageInfo.mipLevels;
-    
-    VkSamplerCreateInfo samplerInfo{};
-    samplerInfo.sType        = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO;
-    samplerInfo.magFilter    = VK_FILTER_LINEAR;
-    samplerInfo.minFilter    = VK_FILTER_LINEAR;
-    samplerInfo.addressModeU = VK_SAMPLER_ADDRESS_MODE_REPEAT;
-    samplerInfo.addressModeV = VK_SAMPLER_ADDRESS_MODE_REPEAT;
-    samplerInfo.addressModeW = VK_SAMPLER_ADDRESS_MODE_REPEAT;
-    samplerInfo.unnormalizedCoordinates = VK_FALSE;
-    samplerInfo.anisotropyEnable = VK_TRUE;
-    samplerInfo.maxAnisotropy    = 16.0f;
-    samplerInfo.borderColor      = VK_BORDER_COLOR_INT_OPAQUE_BLACK;
-    samplerInfo.compareEnable    = VK_FALSE;
-    samplerInfo.compareOp        = VK_COMPARE_OP_ALWAYS;
-    samplerInfo.mipmapMode       = VK_SAMPLER_MIPMAP_MODE_LINEAR;
-    samplerInfo.mipLodBias       = 0.0f;
-    samplerInfo.minLod           = 0.0f;
-    samplerInfo.maxLod           = mipLevels;
-    
-    VkSampler sampler;
-    VkResult  result = vkCreateSampler(device, &samplerInfo, nullptr, &sampler);
-    CHECK_VKRESULT(result, "failed to create texture sampler!");
-    
-    { m_sampler = sampler; }
+    m_sampler = System::SamplerCache()->getTextureSampler();
 }
 
 void Image::copyCubemapToImage() {
     LOG("Image::copyCubemapToImage");
-    std::vector<unsigned char*> rawData = m_rawCubemap;
-    
-    VkDeviceSize imageSize = getImageSize();
-    uint32_t     layerSize = imageSize / 6.0;
-    
-    Buffer *tempBuffer = new Buffer();
-    tempBuffer->setup(imageSize, VK_BUFFER_USAGE_TRANSFER_SRC_BIT);
-    tempBuffer->create();
-    for (int i = 0; i < 6; ++i) {
-        tempBuffer->fillBuffer(rawData[i], layerSize, layerSize * i);
-    }
-    
-    cmdTransitionToTransferDest();
-    cmdCopyBufferToImage(tempBuffer->m_buffer);
-    cmdGenerateMipmaps();
-    
-    tempBuffer->cleanup();
+    UploadImages({ this });
 }
 
 void Image::copyRawDataToImage() {
     LOG("Image::copyRawDataToImage");
-    unsigned char* rawData = m_rawData;
-    
-    VkDeviceSize imageSize = getImageSize();
-    
-    Buffer *tempBuffer = new Buffer();
-    tempBuffer->setup(imageSize, VK_BUFFER_USAGE_TRANSFER_SRC_BIT);
-    tempBuffer->create();
-    tempBuffer->fillBufferFull(rawData);
-    
-    cmdTransitionToTransferDest();
-    cmdCopyBufferToImage(tempBuffer->m_buffer);
-    cmdGenerateMipmaps();
-    
-    tempBuffer->cleanup();
+    UploadImages({ this });
 }
 
 void Image::copyRawHDRToImage() {
     LOG("Image::copyRawHDRToImage");
-    float* rawData = m_rawHDR;
-    
-    VkDeviceSize imageSize = getImageSize();
-    
-    Buffer *tempBuffer = new Buffer();
-    tempBuffer->setup(imageSize, VK_BUFFER_USAGE_TRANSFER_SRC_BIT);
-    tempBuffer->create();
-    tempBuffer->fillBufferFull(rawData);
-    
-    cmdTransitionToTransferDest();
-    cmdCopyBufferToImage(tempBuffer->m_buffer);
-    cmdGenerateMipmaps();
-    
-    tempBuffer->cleanup();
+    UploadImages({ this });
 }
 
-void Image::cmdTransitionToTransferDest() {
-    LOG("Image::cmdTransitionToTransferDest");
-    VkImage               image         = m_image;
-    VkImageCreateInfo     imageInfo     = m_imageInfo;
-    VkImageViewCreateInfo imageViewInfo = m_imageViewInfo;
-    
-    Commander* commander = System::Commander();
-    
-    VkCommandBuffer commandBuffer = commander->createCommandBuffer();
-    commander->beginSingleTimeCommands(commandBuffer);
-    
-    VkImageMemoryBarrier barrier = GetDefaultImageMemoryBarrier();
-    barrier.image         = image;
-    barrier.oldLayout     = imageInfo.initialLayout;
-    barrier.newLayout     = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
-    barrier.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
-    barrier.subresourceRange.levelCount = imageInfo.mipLevels;
-    barrier.subresourceRange.layerCount = imageViewInfo.subresourceRange.layerCount;
-    
-    vkCmdPipelineBarrier(commandBuffer,
-                         VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT,
-                         VK_PIPELINE_STAGE_TRANSFER_BIT,
-                         0,
-                         0, nullptr,
-                         0, nullptr,
-                         1, &barrier);
-    
-    commander->endSingleTimeCommands(commandBuffer);
+void Image::cmdTransitionToTransferDest(VkCommandBuffer commandBuffer) {
+    CmdTransitionToTransferDest(commandBuffer, { this });
 }
 
-void Image::cmdCopyBufferToImage(VkBuffer buffer) {
-    LOG("Image::cmdCopyBufferToImage");
-    VkImage               image         = m_image;
-    VkImageCreateInfo     imageInfo     = m_imageInfo;
-    VkImageViewCreateInfo imageViewInfo = m_imageViewInfo;
-    
-    Commander* commander = System::Commander();
-    
-    VkCommandBuffer commandBuffer = commander->createCommandBuffer();
-    commander->beginSingleTimeCommands(commandBuffer);
+void Image::cmdCopyBufferToImage(VkCommandBuffer commandBuffer, VkBuffer buffer, VkDeviceSize offset,
+                                 uint32_t layer, uint32_t mipLevel) {
+    VkImage           image     = m_image;
+    VkImageCreateInfo imageInfo = m_imageInfo;
     
     VkBufferImageCopy region{};
-    region.bufferOffset      = 0;
+    region.bufferOffset      = offset;
     region.bufferRowLength   = 0;
     region.bufferImageHeight = 0;
     
     region.imageSubresource.aspectMask      = VK_IMAGE_ASPECT_COLOR_BIT;
-    region.imageSubresource.mipLevel        = 0;
-    region.imageSubresource.baseArrayLayer  = 0;
-    region.imageSubresource.layerCount      = imageViewInfo.subresourceRange.layerCount;
+    region.imageSubresource.mipLevel        = mipLevel;
+    region.imageSubresource.baseArrayLayer  = layer;
+    region.imageSubresource.layerCount      = 1;
     
     region.imageOffset = {0, 0, 0};
-    region.imageExtent = {imageInfo.extent.width, imageInfo.extent.height, 1};
+    region.imageExtent = {std::max(imageInfo.extent.width  >> mipLevel, 1u),
+                          std::max(imageInfo.extent.height >> mipLevel, 1u), 1};
     
     vkCmdCopyBufferToImage(commandBuffer,
                            buffer,
                            image,
                            VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
                            1, &region);
+}
+
+void Image::cmdGenerateMipmaps(VkCommandBuffer commandBuffer) {
+    CmdGenerateMipmaps(commandBuffer, { this });
+}
+
+// Copies run on the transfer queue, mipmaps on the graphics queue once ownership moves over;
+// the images are ready when the token of the upload batch completes
+void Image::UploadImages(std::vector<Image*> pImages) {
+    LOG("Image::UploadImages");
+    Uploader* uploader = System::Uploader();
+    
+    CmdTransitionToTransferDest(uploader->getCommandBuffer(), pImages);
+    
+    std::vector<VkImageMemoryBarrier> barriers;
+    for (Image* pImage : pImages) barriers.push_back(pImage->stageRawLayers());
+    uploader->releaseImages(barriers);
     
-    commander->endSingleTimeCommands(commandBuffer);
+    CmdFinishUploads(uploader->getGraphicCommandBuffer(), pImages);
 }
 
-void Image::cmdGenerateMipmaps() {
-    LOG("Image::cmdGenerateMipmaps");
-    VkPhysicalDevice      physicalDevice = m_physicalDevice;
-    VkImage               image          = m_image;
-    VkImageCreateInfo     imageInfo      = m_imageInfo;
-    VkImageViewCreateInfo imageViewInfo  = m_imageViewInfo;
+// Each decode future fills in the matching image through one of the setupFor* calls. An image is
+// created and staged as soon as its pixels land, so the copies overlap the decodes still running
+void Image::UploadImages(std::vector<Image*> pImages, std::vector<std::future<void>>& decodes) {
+    LOG("Image::UploadImages");
+    Uploader*   uploader = System::Uploader();
+    ThreadPool* pool     = System::ThreadPool();
+    
+    std::vector<VkImageMemoryBarrier> barriers(pImages.size());
+    std::vector<bool> isStaged(pImages.size(), false);
+    size_t stagedCount = 0;
+    while (stagedCount < pImages.size()) {
+        bool isWaiting = true;
+        for (size_t i = 0; i < pImages.size(); i++) {
+            if (isStaged[i] || decodes[i].wait_for(std::chrono::seconds(0)) != std::future_status::ready) continue;
+            decodes[i].get();
+            
+            Image* pImage = pImages[i];
+            if (pImage->m_imageInfo.flags & VK_IMAGE_CREATE_CUBE_COMPATIBLE_BIT) pImage->createForCubemap();
+            else                                                             pImage->createForTexture();
+            CmdTransitionToTransferDest(uploader->getCommandBuffer(), { pImage });
+            barriers[i] = pImage->stageRawLayers();
+            
+            isStaged[i] = true;
+            isWaiting   = false;
+            stagedCount++;
+        }
+        if (isWaiting && !pool->runPending()) std::this_thread::yield();
+    }
+    uploader->releaseImages(barriers);
+    
+    CmdFinishUploads(uploader->getGraphicCommandBuffer(), pImages);
+}
+
+// Call once per frame; returns true when a view changed. A level is never sampled before it lands, so its
+// copy takes it from UNDEFINED without an ownership transfer from the graphics queue
+bool Image::StreamImages(std::vector<Image*> pImages) {
+    Uploader*    uploader      = System::Uploader();
+    VkDeviceSize budget        = STREAM_BYTES_PER_FRAME;
+    bool         isViewChanged = false;
+    
+    std::vector<Image*>               pStreamImages;
+    std::vector<VkImageMemoryBarrier> barriers;
+    for (Image* pImage : pImages) {
+        if (pImage->m_residentLevel == 0) continue;
+        if (pImage->m_streamToken != 0) {
+            if (!uploader->isComplete(pImage->m_streamToken)) continue;
+            pImage->m_streamToken = 0;
+            pImage->setResidentLevel(pImage->m_streamedLevel);
+            isViewChanged = true;
+            if (pImage->m_residentLevel == 0) {
+                pImage->freeRawData();
+                continue;
+            }
+        }
+        
+        std::vector<Ktx2Level> levels;
+        const char*            data  = nullptr;
+        uint32_t               level = pImage->m_streamedLevel - 1;
+        pImage->getCookedLevels(&levels, &data);
+        if (!pStreamImages.empty() && levels[level].size > budget) continue;
+        budget -= std::min(budget, levels[level].size);
+        
+        VkImageMemoryBarrier barrier = GetDefaultImageMemoryBarrier();
+        barrier.image         = pImage->m_image;
+        barrier.oldLayout     = VK_IMAGE_LAYOUT_UNDEFINED;
+        barrier.newLayout     = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+        barrier.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+        barrier.subresourceRange.baseMipLevel = level;
+        vkCmdPipelineBarrier(uploader->getCommandBuffer(),
+                             VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0,
+                             0, nullptr,
+                             0, nullptr,
+                             1, &barrier);
+        
+        Uploader::Staging staging = uploader->stage(data + levels[level].offset, levels[level].size, 16);
+        pImage->cmdCopyBufferToImage(uploader->getCommandBuffer(), staging.buffer, staging.offset, 0, level);
+        
+        barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+        barriers.push_back(barrier);
+        pStreamImages.push_back(pImage);
+        pImage->m_streamedLevel = level;
+    }
+    if (pStreamImages.empty()) return isViewChanged;
     
-    Commander* commander = System::Commander();
+    uploader->releaseImages(barriers);
+    for (VkImageMemoryBarrier& barrier : barriers) {
+        barrier.newLayout     = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+        barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+        barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+    }
+    vkCmdPipelineBarrier(uploader->getGraphicCommandBuffer(),
+                         VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, 0,
+                         0, nullptr,
+                         0, nullptr,
+                         UINT32(barriers.size()), barriers.data());
     
-    uint32_t layerCount = imageViewInfo.subresourceRange.layerCount;
+    Uploader::Token token = uploader->submit();
+    for (Image* pImage : pStreamImages) pImage->m_streamToken = token;
+    return isViewChanged;
+}
+
+// Records the level 0 copies into the upload batch and frees the decoded pixels, which now live in staging;
+// a streaming image stages only its coarse levels and keeps the rest around for StreamImages
+VkImageMemoryBarrier Image::stageRawLayers() {
+    uint32_t baseLevel = m_streamedLevel;
+    if      (!m_rawCompressed.levels.empty()) stageRawLevels(m_rawCompressed.levels, m_rawCompressed.data.data(), 0, baseLevel);
+    else if (m_rawCached.data != nullptr)     stageRawLevels(m_rawCached.levels, m_rawCached.data, 0, baseLevel);
+    else if (m_rawMips.empty())               stageRawPixels();
+    for (uint32_t i = 0; i < m_rawMips.size(); i++)
+        stageRawLevels(m_rawMips[i].levels, m_rawMips[i].data.data(), i, baseLevel);
+    if (baseLevel == 0) freeRawData();
     
-    // Check if image format supports linear blitting
-    VkFormatProperties formatProperties;
-    vkGetPhysicalDeviceFormatProperties(physicalDevice, imageInfo.format, &formatProperties);
+    VkImageMemoryBarrier barrier = GetDefaultImageMemoryBarrier();
+    barrier.image     = m_image;
+    barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+    barrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+    barrier.subresourceRange.levelCount = m_imageInfo.mipLevels;
+    barrier.subresourceRange.layerCount = m_imageViewInfo.subresourceRange.layerCount;
+    return barrier;
+}
+
+void Image::stageRawPixels() {
+    Uploader* uploader = System::Uploader();
+    std::vector<const void*> layers = getRawLayers();
+    VkDeviceSize layerSize = getImageSize() / layers.size();
+    VkDeviceSize texelSize = std::max(getChannelSize(), 1u);
+    VkDeviceSize alignment = texelSize % 4 == 0 ? texelSize : texelSize * 4;
     
-    if (!(formatProperties.optimalTilingFeatures & VK_FORMAT_FEATURE_SAMPLED_IMAGE_FILTER_LINEAR_BIT)) {
-        throw std::runtime_error("texture image format does not support linear blitting!");
+    for (uint32_t i = 0; i < layers.size(); i++) {
+        Uploader::Staging staging = uploader->stage(layers[i], layerSize, alignment);
+        cmdCopyBufferToImage(uploader->getCommandBuffer(), staging.buffer, staging.offset, i);
+    }
+}
+
+// Block offsets must be a multiple of the block size, which 16 covers for every BC format and RGBA8
+void Image::stageRawLevels(const std::vector<Ktx2Level>& levels, const char* data,
+                           uint32_t layer, uint32_t baseLevel) {
+    Uploader* uploader = System::Uploader();
+    for (uint32_t level = baseLevel; level < levels.size(); level++) {
+        const char* address = data + levels[level].offset;
+        Uploader::Staging staging = uploader->stage(address, levels[level].size, 16);
+        cmdCopyBufferToImage(uploader->getCommandBuffer(), staging.buffer, staging.offset, layer, level);
+    }
+}
+
+void Image::freeRawData() {
+    m_rawCompressed = Ktx2Image{};
+    UnmapCachedTexture(&m_rawCached);
+    for (unsigned char* face : m_rawCubemap) FreeImage(face);
+    FreeImage(m_rawData);
+    FreeImage(m_rawHDR);
+    m_rawCubemap.clear();
+    m_rawMips.clear();
+    m_rawData = nullptr;
+    m_rawHDR  = nullptr;
+}
+
+bool Image::getCookedLevels(std::vector<Ktx2Level>* levels, const char** data) {
+    if      (!m_rawCompressed.levels.empty()) { *levels = m_rawCompressed.levels; *data = m_rawCompressed.data.data(); }
+    else if (m_rawCached.data != nullptr)     { *levels = m_rawCached.levels;     *data = m_rawCached.data; }
+    else if (m_rawMips.size() == 1)           { *levels = m_rawMips[0].levels;    *data = m_rawMips[0].data.data(); }
+    else return false;
+    return true;
+}
+
+// Only single layer images with every level on the CPU stream; the rest still upload in one go
+void Image::prepareStreaming() {
+    std::vector<Ktx2Level> levels;
+    const char*            data      = nullptr;
+    uint32_t               baseLevel = 0;
+    if (m_hasCookedMips && getCookedLevels(&levels, &data)) {
+        uint32_t size = std::max(m_imageInfo.extent.width, m_imageInfo.extent.height);
+        while (baseLevel + 1 < levels.size() && (size >> baseLevel) > STREAM_BASE_SIZE) baseLevel++;
     }
     
-    VkCommandBuffer commandBuffer = commander->createCommandBuffer();
-    commander->beginSingleTimeCommands(commandBuffer);
+    VkImageViewCreateInfo imageViewInfo = m_imageViewInfo;
+    imageViewInfo.subresourceRange.baseMipLevel = baseLevel;
+    imageViewInfo.subresourceRange.levelCount   = m_imageInfo.mipLevels - baseLevel;
+    
+    {
+        m_imageViewInfo = imageViewInfo;
+        m_residentLevel = baseLevel;
+        m_streamedLevel = baseLevel;
+        m_streamToken   = 0;
+    }
+}
 
-    VkImageMemoryBarrier barrier{};
-    barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
-    barrier.image = image;
-    barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
-    barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
-    barrier.subresourceRange.aspectMask     = VK_IMAGE_ASPECT_COLOR_BIT;
-    barrier.subresourceRange.levelCount     = 1;
-    barrier.subresourceRange.baseArrayLayer = 0;
-    barrier.subresourceRange.layerCount     = layerCount;
+// Frames already recorded keep the old view until they retire
+void Image::setResidentLevel(uint32_t level) {
+    VkDevice    device    = m_device;
+    VkImageView imageView = m_imageView;
+    System::DeletionQueue()->retire([device, imageView]() { vkDestroyImageView(device, imageView, nullptr); });
+    
+    {
+        m_residentLevel = level;
+        m_imageViewInfo.subresourceRange.baseMipLevel = level;
+        m_imageViewInfo.subresourceRange.levelCount   = m_imageInfo.mipLevels - level;
+    }
+    createImageView();
+}
+
+// Formats the GPU cannot filter get their chain built here, on the decoding thread; Kaiser's
+// negative lobes ring around HDR highlights, so float sources take the box filter
+void Image::prepareMipmaps() {
+    VkImageCreateInfo imageInfo = m_imageInfo;
+    MipPath           mipPath   = GetMipPath(m_physicalDevice, imageInfo.format);
+    MipFilter         filter    = m_rawHDR != nullptr ? MipFilterBox : MipFilterKaiser;
+    
+    std::vector<MipChain> rawMips;
+    if (mipPath == MipCpu) {
+        for (const void* layer : getRawLayers())
+            rawMips.push_back(GenerateMipChain(layer, imageInfo.extent.width, imageInfo.extent.height,
+                                               imageInfo.format, filter));
+        freeRawData();
+    }
+    if (mipPath == MipCompute) imageInfo.usage |= VK_IMAGE_USAGE_STORAGE_BIT;
+    
+    {
+        m_rawMips       = std::move(rawMips);
+        m_mipPath       = mipPath;
+        m_hasCookedMips = mipPath == MipCpu;
+        m_imageInfo     = imageInfo;
+    }
+}
 
-    int32_t mipWidth  = imageInfo.extent.width;
-    int32_t mipHeight = imageInfo.extent.height;
+void Image::CmdTransitionToTransferDest(VkCommandBuffer commandBuffer, std::vector<Image*> pImages) {
+    LOG("Image::CmdTransitionToTransferDest");
+    std::vector<VkImageMemoryBarrier> barriers;
+    for (Image* pImage : pImages) {
+        VkImageMemoryBarrier barrier = GetDefaultImageMemoryBarrier();
+        barrier.image         = pImage->m_image;
+        barrier.oldLayout     = pImage->m_imageInfo.initialLayout;
+        barrier.newLayout     = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+        barrier.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+        barrier.subresourceRange.levelCount = pImage->m_imageInfo.mipLevels;
+        barrier.subresourceRange.layerCount = pImage->m_imageViewInfo.subresourceRange.layerCount;
+        barriers.push_back(barrier);
+    }
+    
+    vkCmdPipelineBarrier(commandBuffer,
+                         VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT,
+                         VK_PIPELINE_STAGE_TRANSFER_BIT,
+                         0,
+                         0, nullptr,
+                         0, nullptr,
+                         UINT32(barriers.size()), barriers.data());
+}
 
-    for (uint32_t i = 1; i < imageInfo.mipLevels; i++) {
-        int32_t halfMipWidth  = ceil(mipWidth /2);
-        int32_t halfMipHeight = ceil(mipHeight/2);
-        
-        barrier.subresourceRange.baseMipLevel = i - 1;
-        barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
-        barrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+void Image::CmdFinishUploads(VkCommandBuffer commandBuffer, std::vector<Image*> pImages) {
+    std::vector<Image*> pBlitImages, pComputeImages, pCookedImages;
+    for (Image* pImage : pImages) {
+        if      (pImage->m_hasCookedMips)         pCookedImages .push_back(pImage);
+        else if (pImage->m_mipPath == MipCompute) pComputeImages.push_back(pImage);
+        else                                      pBlitImages   .push_back(pImage);
+    }
+    if (!pBlitImages   .empty()) CmdGenerateMipmaps       (commandBuffer, pBlitImages);
+    if (!pComputeImages.empty()) System::Downsampler()->cmdGenerateMipmaps(commandBuffer, pComputeImages);
+    if (!pCookedImages .empty()) CmdTransitionToShaderRead(commandBuffer, pCookedImages);
+}
+
+void Image::CmdTransitionToShaderRead(VkCommandBuffer commandBuffer, std::vector<Image*> pImages) {
+    LOG("Image::CmdTransitionToShaderRead");
+    std::vector<VkImageMemoryBarrier> barriers;
+    for (Image* pImage : pImages) {
+        VkImageMemoryBarrier barrier = GetDefaultImageMemoryBarrier();
+        barrier.image         = pImage->m_image;
+        barrier.oldLayout     = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+        barrier.newLayout     = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
         barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
-        barrier.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+        barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+        barrier.subresourceRange.levelCount = pImage->m_imageInfo.mipLevels;
+        barrier.subresourceRange.layerCount = pImage->m_imageViewInfo.subresourceRange.layerCount;
+        barriers.push_back(barrier);
+    }
+    
+    vkCmdPipelineBarrier(commandBuffer,
+                         VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, 0,
+                         0, nullptr,
+                         0, nullptr,
+                         UINT32(barriers.size()), barriers.data());
+}
 
+// Walks every image down its mip chain together, one barrier batch per level before and after the blits
+void Image::CmdGenerateMipmaps(VkCommandBuffer commandBuffer, std::vector<Image*> pImages) {
+    LOG("Image::CmdGenerateMipmaps");
+    uint32_t maxLevels = 1;
+    std::vector<Size<int32_t>> mipSizes;
+    for (Image* pImage : pImages) {
+        VkImageCreateInfo imageInfo = pImage->m_imageInfo;
+        
+        // Check if image format supports linear blitting
+        VkFormatProperties formatProperties;
+        vkGetPhysicalDeviceFormatProperties(pImage->m_physicalDevice, imageInfo.format, &formatProperties);
+        
+        if (!(formatProperties.optimalTilingFeatures & VK_FORMAT_FEATURE_SAMPLED_IMAGE_FILTER_LINEAR_BIT)) {
+            throw std::runtime_error("texture image format does not support linear blitting!");
+        }
+        
+        maxLevels = std::max(maxLevels, imageInfo.mipLevels);
+        mipSizes.push_back({ static_cast<int32_t>(imageInfo.extent.width),
+                             static_cast<int32_t>(imageInfo.extent.height) });
+    }
+    
+    std::vector<VkImageMemoryBarrier> barriers;
+    for (uint32_t i = 1; i < maxLevels; i++) {
+        barriers.clear();
+        for (Image* pImage : pImages) {
+            if (pImage->m_imageInfo.mipLevels <= i) continue;
+            VkImageMemoryBarrier barrier = GetDefaultImageMemoryBarrier();
+            barrier.image = pImage->m_image;
+            barrier.subresourceRange.baseMipLevel = i - 1;
+            barrier.subresourceRange.layerCount   = pImage->m_imageViewInfo.subresourceRange.layerCount;
+            barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+            barrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+            barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+            barrier.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+            barriers.push_back(barrier);
+        }
+        
         vkCmdPipelineBarrier(commandBuffer,
                              VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0,
                              0, nullptr,
                              0, nullptr,
-                             1, &barrier);
+                             UINT32(barriers.size()), barriers.data());
         
-        VkImageBlit blit{};
-        blit.srcOffsets[0] = { 0, 0, 0 };
-        blit.srcOffsets[1] = { mipWidth, mipHeight, 1 };
-        blit.srcSubresource.aspectMask     = VK_IMAGE_ASPECT_COLOR_BIT;
-        blit.srcSubresource.mipLevel       = i - 1;
-        blit.srcSubresource.baseArrayLayer = 0;
-        blit.srcSubresource.layerCount     = layerCount;
-        
-        blit.dstOffsets[0] = { 0, 0, 0 };
-        blit.dstOffsets[1] = { halfMipWidth, halfMipHeight, 1 };
-        blit.dstSubresource.aspectMask     = VK_IMAGE_ASPECT_COLOR_BIT;
-        blit.dstSubresource.mipLevel       = i;
-        blit.dstSubresource.baseArrayLayer = 0;
-        blit.dstSubresource.layerCount     = layerCount;
+        for (uint32_t j = 0; j < pImages.size(); j++) {
+            Image* pImage = pImages[j];
+            if (pImage->m_imageInfo.mipLevels <= i) continue;
+            VkImage       image      = pImage->m_image;
+            uint32_t      layerCount = pImage->m_imageViewInfo.subresourceRange.layerCount;
+            Size<int32_t> mipSize    = mipSizes[j];
+            Size<int32_t> halfSize   = { std::max(mipSize.width / 2, 1), std::max(mipSize.height / 2, 1) };
+            
+            VkImageBlit blit{};
+            blit.srcOffsets[0] = { 0, 0, 0 };
+            blit.srcOffsets[1] = { mipSize.width, mipSize.height, 1 };
+            blit.srcSubresource.aspectMask     = VK_IMAGE_ASPECT_COLOR_BIT;
+            blit.srcSubresource.mipLevel       = i - 1;
+            blit.srcSubresource.baseArrayLayer = 0;
+            blit.srcSubresource.layerCount     = layerCount;
+            
+            blit.dstOffsets[0] = { 0, 0, 0 };
+            blit.dstOffsets[1] = { halfSize.width, halfSize.height, 1 };
+            blit.dstSubresource.aspectMask     = VK_IMAGE_ASPECT_COLOR_BIT;
+            blit.dstSubresource.mipLevel       = i;
+            blit.dstSubresource.baseArrayLayer = 0;
+            blit.dstSubresource.layerCount     = layerCount;
+            
+            vkCmdBlitImage(commandBuffer,
+                           image, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+                           image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+                           1, &blit,
+                           VK_FILTER_LINEAR);
+            
+            mipSizes[j] = halfSize;
+        }
         
-        vkCmdBlitImage(commandBuffer,
-                       image, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
-                       image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
-                       1, &blit,
-                       VK_FILTER_LINEAR);
+        for (VkImageMemoryBarrier& barrier : barriers) {
+            barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+            barrier.newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+            barrier.srcAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+            barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+        }
         
-        barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
-        barrier.newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
-        barrier.srcAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
-        barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
-
         vkCmdPipelineBarrier(commandBuffer,
                              VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, 0,
                              0, nullptr,
                              0, nullptr,
-                             1, &barrier);
-        
-        mipWidth  = halfMipWidth;
-        mipHeight = halfMipHeight;
+                             UINT32(barriers.size()), barriers.data());
+    }
+    
+    barriers.clear();
+    for (Image* pImage : pImages) {
+        VkImageMemoryBarrier barrier = GetDefaultImageMemoryBarrier();
+        barrier.image = pImage->m_image;
+        barrier.subresourceRange.baseMipLevel = pImage->m_imageInfo.mipLevels - 1;
+        barrier.subresourceRange.layerCount   = pImage->m_imageViewInfo.subresourceRange.layerCount;
+        barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+        barrier.newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+        barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+        barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+        barriers.push_back(barrier);
     }
     
-    barrier.subresourceRange.baseMipLevel = imageInfo.mipLevels - 1;
-    barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
-    barrier.newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
-    barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
-    barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
-
     vkCmdPipelineBarrier(commandBuffer,
                          VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, 0,
                          0, nullptr,
                          0, nullptr,
-                         1, &barrier);
-    
-    commander->endSingleTimeCommands(commandBuffer);
-
+                         UINT32(barriers.size()), barriers.data());
 }
 
 VkImage         Image::getImage      () { return m_image;       }
 VkImageView     Image::getImageView  () { return m_imageView;   }
 VkDeviceMemory  Image::getImageMemory() { return m_imageMemory; }
 VkSampler       Image::getSampler    () { return m_sampler;     }
+uint32_t        Image::getResidentLevel() { return m_residentLevel; }
+bool            Image::isStreamPending() { return m_streamToken != 0 && !System::Uploader()->isComplete(m_streamToken); }
 unsigned int    Image::getChannelSize() { return GetChannelSize(m_imageInfo.format); }
+VkDeviceSize    Image::getMemorySize () { return m_allocation.size; }
 VkDeviceSize    Image::getImageSize  () { return m_imageInfo.extent.width * m_imageInfo.extent.height * getChannelSize() * m_imageInfo.arrayLayers; }
+std::vector<const void*> Image::getRawLayers() {
+    if (!m_rawCubemap.empty()) return std::vector<const void*>(m_rawCubemap.begin(), m_rawCubemap.end());
+    if (m_rawHDR != nullptr) return { m_rawHDR };
+    return { m_rawData };
+}
 VkDescriptorImageInfo Image::getImageInfo() {
     VkDescriptorImageInfo imageInfo{};
     imageInfo.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
@@ -504,10 +866,35 @@ VkDescriptorImageInfo Image::getImageInfo() {
 // Private ==================================================
 
 
+// Blits need linear filtering; otherwise a storage-capable format takes the compute pass, and the rest the CPU
+Image::MipPath Image::GetMipPath(VkPhysicalDevice physicalDevice, VkFormat format) {
+    VkFormatProperties properties;
+    vkGetPhysicalDeviceFormatProperties(physicalDevice, format, &properties);
+    VkFormatFeatureFlags blitFeatures = VK_FORMAT_FEATURE_BLIT_SRC_BIT |
+                                        VK_FORMAT_FEATURE_BLIT_DST_BIT |
+                                        VK_FORMAT_FEATURE_SAMPLED_IMAGE_FILTER_LINEAR_BIT;
+    if ((properties.optimalTilingFeatures & blitFeatures) == blitFeatures) return MipBlit;
+    if (Downsampler::IsFormatSupported(physicalDevice, format)) return MipCompute;
+    CHECK_BOOL(IsMipFormatSupported(format), "format has no way to generate mipmaps!");
+    return MipCpu;
+}
+
+bool Image::IsCompressedFormat(VkFormat format) {
+    return format >= VK_FORMAT_BC1_RGB_UNORM_BLOCK && format <= VK_FORMAT_BC7_SRGB_BLOCK;
+}
+
 unsigned int Image::GetChannelSize(VkFormat format) {
     switch (format) {
-        case VK_FORMAT_R8G8B8_SRGB  : return 3; break;
-        case VK_FORMAT_R8G8B8A8_SRGB: return 4; break;
+        case VK_FORMAT_R8_UNORM                : return 1; break;
+        case VK_FORMAT_R8G8_UNORM              : return 2; break;
+        case VK_FORMAT_R8G8B8_SRGB             : return 3; break;
+        case VK_FORMAT_R8G8B8A8_SRGB           : return 4; break;
+        case VK_FORMAT_R8G8B8A8_UNORM          : return 4; break;
+        case VK_FORMAT_B10G11R11_UFLOAT_PACK32 : return 4; break;
+        case VK_FORMAT_E5B9G9R9_UFLOAT_PACK32  : return 4; break;
+        case VK_FORMAT_R16G16B16A16_SFLOAT     : return 8; break;
+        case VK_FORMAT_R32G32B32_SFLOAT        : return 12; break;
+        case VK_FORMAT_R32G32B32A32_SFLOAT     : return 16; break;
         default: return 0; break;
     }
 }
@@ -571,3 +958,11 @@ VkImageMemoryBarrier Image::GetDefaultImageMemoryBarrier() {
     barrier.dstAccessMask = 0;
     return barrier;
 }
+
+Allocator::Category Image::GetCategory(VkImageUsageFlags usage) {
+    VkImageUsageFlags attachment = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT;
+    if (usage & VK_IMAGE_USAGE_STORAGE_BIT) return Allocator::Compute;
+    if (usage & attachment)                 return Allocator::Attachment;
+    if (usage & VK_IMAGE_USAGE_SAMPLED_BIT) return Allocator::Texture;
+    return Allocator::Other;
+}
@@ -3,7 +3,18 @@
 
 #pragma once
 
+#include <future>
+
 #include "../common.h"
+#include "../renderer/allocator.h"
+#include "../renderer/uploader.h"
+#include "ktx2.h"
+#include "texture_cache.h"
+#include "mipmap.h"
+
+// Precooked textures come up with their levels up to this size resident and stream the finer ones in
+#define STREAM_BASE_SIZE       64
+#define STREAM_BYTES_PER_FRAME (8 * 1024 * 1024)
 
 class Renderer;
 
@@ -12,16 +23,23 @@ class Image {
 public:
     ~Image();
     Image();
+    
+    enum MipPath { MipBlit = 0, MipCompute = 1, MipCpu = 2 };
 
     void cleanup();
     void cleanupImageView();
     
     void setupForDepth     (Size<uint32_t> size, uint32_t mipLevels);
     void setupForSwapchain (VkImage image, VkFormat imageFormat);
-    void setupForTexture   (const std::string filepath);
+    void setupForTexture   (const std::string filepath, VkFormat format = VK_FORMAT_R8G8B8A8_SRGB);
     void setupForHDRTexture(const std::string filepath);
+    void setupForCompressedTexture(const std::string filepath);
+    void setupForCachedTexture(const CachedTexture& texture);
+    void setupForMipChain  (MipChain chain, uint32_t width, uint32_t height, VkFormat format);
+    void setupForPackedTexture(const std::vector<std::string> filepaths);
     void setupForCubemap   (const std::string *filepaths);
     void setupForCubemap   (Size<uint> size);
+    void setupForTiles     (Size<uint32_t> size, uint32_t mipLevels, VkFormat format);
     
     void create             ();
     void createForTexture   ();
@@ -37,16 +55,30 @@ public:
     void copyRawDataToImage ();
     void copyCubemapToImage ();
     
-    void cmdTransitionToTransferDest();
-    void cmdCopyBufferToImage      (VkBuffer buffer);
-    void cmdGenerateMipmaps        ();
+    void cmdTransitionToTransferDest(VkCommandBuffer commandBuffer);
+    void cmdCopyBufferToImage      (VkCommandBuffer commandBuffer, VkBuffer buffer,
+                                    VkDeviceSize offset, uint32_t layer, uint32_t mipLevel = 0);
+    void cmdGenerateMipmaps        (VkCommandBuffer commandBuffer);
+    
+    static void UploadImages               (std::vector<Image*> pImages);
+    static void UploadImages               (std::vector<Image*> pImages, std::vector<std::future<void>>& decodes);
+    static bool StreamImages               (std::vector<Image*> pImages);
+    static void CmdTransitionToTransferDest(VkCommandBuffer commandBuffer, std::vector<Image*> pImages);
+    static void CmdGenerateMipmaps         (VkCommandBuffer commandBuffer, std::vector<Image*> pImages);
+    static void CmdTransitionToShaderRead  (VkCommandBuffer commandBuffer, std::vector<Image*> pImages);
+    static bool IsCompressedFormat         (VkFormat format);
+    static MipPath GetMipPath              (VkPhysicalDevice physicalDevice, VkFormat format);
     
     VkImage          getImage      ();
     VkImageView      getImageView  ();
     VkDeviceMemory   getImageMemory();
     VkDeviceSize     getImageSize  ();
+    VkDeviceSize     getMemorySize ();
     VkSampler        getSampler    ();
+    uint32_t         getResidentLevel();
+    bool             isStreamPending();
     unsigned int     getChannelSize();
+    std::vector<const void*> getRawLayers();
     VkDescriptorImageInfo getImageInfo();
     
     VkImageCreateInfo     m_imageInfo{};
@@ -55,10 +87,21 @@ public:
     
 private:
     
-    unsigned char* m_desc;
-    unsigned char* m_rawData;
-    float        * m_rawHDR;
+    unsigned char* m_desc    = nullptr;
+    unsigned char* m_rawData = nullptr;
+    float        * m_rawHDR  = nullptr; // holds the converted texels after setupForHDRTexture
     std::vector<unsigned char*> m_rawCubemap;
+    Ktx2Image      m_rawCompressed;
+    CachedTexture  m_rawCached;
+    bool           m_hasCookedMips = false;
+    MipPath        m_mipPath       = MipBlit;
+    std::vector<MipChain> m_rawMips;
+    
+    // Levels finer than the resident one are clamped off through the view's base level, so the sampler
+    // stays the shared one from the sampler cache
+    uint32_t         m_residentLevel = 0;
+    uint32_t         m_streamedLevel = 0;
+    Uploader::Token  m_streamToken   = 0;
     
     VkDevice         m_device         = VK_NULL_HANDLE;
     VkPhysicalDevice m_physicalDevice = VK_NULL_HANDLE;
@@ -66,14 +109,28 @@ private:
     VkImage          m_image          = VK_NULL_HANDLE;
     VkImageView      m_imageView      = VK_NULL_HANDLE;
     VkDeviceMemory   m_imageMemory    = VK_NULL_HANDLE;
+    Allocation       m_allocation{};
     
-    // For Texture
+    // For Texture, owned by the sampler cache
     VkSampler m_sampler = VK_NULL_HANDLE;
     
+    static void CmdFinishUploads(VkCommandBuffer commandBuffer, std::vector<Image*> pImages);
+    
+    VkImageMemoryBarrier stageRawLayers();
+    void                 stageRawPixels();
+    void                 stageRawLevels(const std::vector<Ktx2Level>& levels, const char* data,
+                                        uint32_t layer = 0, uint32_t baseLevel = 0);
+    bool                 getCookedLevels(std::vector<Ktx2Level>* levels, const char** data);
+    void                 prepareStreaming();
+    void                 setResidentLevel(uint32_t level);
+    void                 freeRawData();
+    void                 prepareMipmaps();
+    
     static unsigned int GetChannelSize(VkFormat format);
     static VkFormat ChooseDepthFormat(VkPhysicalDevice physicalDevice);
     static VkImageCreateInfo     GetDefaultImageCreateInfo();
     static VkImageViewCreateInfo GetDefaultImageViewCreateInfo();
     static VkImageMemoryBarrier  GetDefaultImageMemoryBarrier();
+    static Allocator::Category   GetCategory(VkImageUsageFlags usage);
     
 };
@@ -0,0 +1,155 @@
+//  Copyright © 2021 Subph. All rights reserved.
+//
+
+#include <algorithm>
+#include <fstream>
+#include <cstring>
+#include <stdexcept>
+
+#include "ktx2.h"
+
+#define KTX2_HEADER_SIZE      80
+#define KTX2_LEVEL_INDEX_SIZE 24
+#define KTX2_LEVEL_ALIGNMENT  16
+
+static const uint8_t KTX2_IDENTIFIER[12] = { 0xAB, 'K', 'T', 'X', ' ', '2', '0', 0xBB, '\r', '\n', 0x1A, '\n' };
+
+// The file puts the 64-bit sgd fields 4-byte aligned
+#pragma pack(push, 4)
+struct Ktx2Header {
+    uint32_t vkFormat;
+    uint32_t typeSize;
+    uint32_t pixelWidth;
+    uint32_t pixelHeight;
+    uint32_t pixelDepth;
+    uint32_t layerCount;
+    uint32_t faceCount;
+    uint32_t levelCount;
+    uint32_t supercompressionScheme;
+    uint32_t dfdByteOffset;
+    uint32_t dfdByteLength;
+    uint32_t kvdByteOffset;
+    uint32_t kvdByteLength;
+    uint64_t sgdByteOffset;
+    uint64_t sgdByteLength;
+};
+#pragma pack(pop)
+
+struct Ktx2LevelIndex {
+    uint64_t byteOffset;
+    uint64_t byteLength;
+    uint64_t uncompressedByteLength;
+};
+
+// Basic data format descriptor for the block formats the cooker writes
+static std::vector<uint32_t> GetDataFormatDescriptor(VkFormat format) {
+    uint32_t colorModel = 0, transfer = 1, bytesPerBlock = GetBlockByteSize(format);
+    std::vector<uint32_t> samples; // bitOffset, bitLength - 1, channel
+    switch (format) {
+        case VK_FORMAT_BC4_UNORM_BLOCK: colorModel = 131; samples = { 0, 63, 0 }; break;
+        case VK_FORMAT_BC5_UNORM_BLOCK: colorModel = 132; samples = { 0, 63, 0, 64, 63, 1 }; break;
+        case VK_FORMAT_BC7_UNORM_BLOCK: colorModel = 134; samples = { 0, 127, 0 }; break;
+        case VK_FORMAT_BC7_SRGB_BLOCK : colorModel = 134; samples = { 0, 127, 0 }; transfer = 2; break;
+        default: throw std::runtime_error("unsupported ktx2 format!");
+    }
+    uint32_t sampleCount = uint32_t(samples.size() / 3);
+    uint32_t blockSize   = 24 + 16 * sampleCount;
+
+    std::vector<uint32_t> words = {
+        4 + blockSize,
+        0,
+        2 | blockSize << 16,
+        colorModel | 1 << 8 | transfer << 16,
+        3 | 3 << 8,
+        bytesPerBlock,
+        0 };
+    for (uint32_t i = 0; i < sampleCount; i++) {
+        words.push_back(samples[i * 3] | samples[i * 3 + 1] << 16 | samples[i * 3 + 2] << 24);
+        words.push_back(0);
+        words.push_back(0);
+        words.push_back(0xFFFFFFFF);
+    }
+    return words;
+}
+
+bool ReadKtx2(const std::string filename, Ktx2Image* image) {
+    std::ifstream file(filename, std::ios::ate | std::ios::binary);
+    if (!file.is_open()) return false;
+
+    size_t fileSize = (size_t) file.tellg();
+    std::vector<char> data(fileSize);
+    file.seekg(0);
+    file.read(data.data(), fileSize);
+    if (fileSize < KTX2_HEADER_SIZE || memcmp(data.data(), KTX2_IDENTIFIER, 12) != 0) return false;
+
+    Ktx2Header header;
+    memcpy(&header, data.data() + 12, sizeof(Ktx2Header));
+    if (header.supercompressionScheme != 0 || header.faceCount != 1 || header.layerCount > 1) return false;
+
+    uint32_t levelCount = std::max(header.levelCount, 1u);
+    if (KTX2_HEADER_SIZE + levelCount * KTX2_LEVEL_INDEX_SIZE > fileSize) return false;
+
+    std::vector<Ktx2Level> levels(levelCount);
+    for (uint32_t i = 0; i < levelCount; i++) {
+        Ktx2LevelIndex index;
+        memcpy(&index, data.data() + KTX2_HEADER_SIZE + i * KTX2_LEVEL_INDEX_SIZE, sizeof(Ktx2LevelIndex));
+        if (index.byteOffset + index.byteLength > fileSize) return false;
+        levels[i] = { index.byteOffset, index.byteLength };
+    }
+
+    image->format = VkFormat(header.vkFormat);
+    image->width  = header.pixelWidth;
+    image->height = std::max(header.pixelHeight, 1u);
+    image->levels = levels;
+    image->data   = std::move(data);
+    return true;
+}
+
+// Levels are laid out smallest first, as the spec recommends for streaming
+void WriteKtx2(const std::string filename, const Ktx2Image& image) {
+    uint32_t levelCount = uint32_t(image.levels.size());
+    std::vector<uint32_t> descriptor = GetDataFormatDescriptor(image.format);
+
+    uint32_t dfdOffset = KTX2_HEADER_SIZE + levelCount * KTX2_LEVEL_INDEX_SIZE;
+    uint32_t dfdLength = uint32_t(descriptor.size() * sizeof(uint32_t));
+
+    std::vector<Ktx2LevelIndex> indices(levelCount);
+    uint64_t offset = dfdOffset + dfdLength;
+    for (int i = int(levelCount) - 1; i >= 0; i--) {
+        offset = (offset + KTX2_LEVEL_ALIGNMENT - 1) / KTX2_LEVEL_ALIGNMENT * KTX2_LEVEL_ALIGNMENT;
+        indices[i] = { offset, image.levels[i].size, image.levels[i].size };
+        offset += image.levels[i].size;
+    }
+
+    Ktx2Header header{};
+    header.vkFormat      = image.format;
+    header.typeSize      = 1;
+    header.pixelWidth    = image.width;
+    header.pixelHeight   = image.height;
+    header.faceCount     = 1;
+    header.levelCount    = levelCount;
+    header.dfdByteOffset = dfdOffset;
+    header.dfdByteLength = dfdLength;
+
+    std::vector<char> file(offset, 0);
+    memcpy(file.data(), KTX2_IDENTIFIER, 12);
+    memcpy(file.data() + 12, &header, sizeof(Ktx2Header));
+    memcpy(file.data() + KTX2_HEADER_SIZE, indices.data(), levelCount * KTX2_LEVEL_INDEX_SIZE);
+    memcpy(file.data() + dfdOffset, descriptor.data(), dfdLength);
+    for (uint32_t i = 0; i < levelCount; i++)
+        memcpy(file.data() + indices[i].byteOffset, image.data.data() + image.levels[i].offset, image.levels[i].size);
+
+    std::ofstream stream(filename, std::ios::binary);
+    if (!stream.is_open()) throw std::runtime_error("failed to open file!");
+    stream.write(file.data(), file.size());
+}
+
+uint32_t GetBlockByteSize(VkFormat format) {
+    switch (format) {
+        case VK_FORMAT_BC4_UNORM_BLOCK: return 8;
+        case VK_FORMAT_BC5_UNORM_BLOCK: return 16;
+        case VK_FORMAT_BC7_UNORM_BLOCK: return 16;
+        case VK_FORMAT_BC7_SRGB_BLOCK : return 16;
+        default: return 0;
+    }
+}
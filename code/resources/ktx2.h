@@ -0,0 +1,28 @@
+//  Copyright © 2021 Subph. All rights reserved.
+//
+
+#pragma once
+
+// Kept free of GLFW/glm so the texture cooker can build against it alone
+#include <vulkan/vulkan.h>
+#include <string>
+#include <vector>
+
+struct Ktx2Level {
+    VkDeviceSize offset = 0;
+    VkDeviceSize size   = 0;
+};
+
+// Single face, single layer, no supercompression; level 0 is the full size image
+struct Ktx2Image {
+    VkFormat               format = VK_FORMAT_UNDEFINED;
+    uint32_t               width  = 0;
+    uint32_t               height = 0;
+    std::vector<Ktx2Level> levels;
+    std::vector<char>      data;
+};
+
+bool ReadKtx2 (const std::string filename, Ktx2Image* image);
+void WriteKtx2(const std::string filename, const Ktx2Image& image);
+
+uint32_t GetBlockByteSize(VkFormat format);
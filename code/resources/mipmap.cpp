@@ -0,0 +1,366 @@
+//  Copyright © 2021 Subph. All rights reserved.
+//
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <immintrin.h>
+#define MIPMAP_SSE
+#elif defined(__ARM_NEON)
+#include <arm_neon.h>
+#define MIPMAP_NEON
+#endif
+
+#if defined(__AVX2__) && defined(__FMA__)
+#define MIPMAP_AVX2
+#endif
+
+#include "mipmap.h"
+#include "hdr.h"
+#include "../system.h"
+
+#define MIP_ALIGNMENT     16
+#define MIP_ROWS_PER_TASK 32
+#define KAISER_TAPS       8
+#define KAISER_ALPHA      4.f
+
+// Packed types hold a whole texel in one 32-bit word
+enum TexelType { TexelSrgb8 = 0, TexelUnorm8 = 1, TexelHalf = 2, TexelFloat = 3, TexelB10G11R11 = 4, TexelE5B9G9R9 = 5 };
+
+struct TexelLayout {
+    uint32_t  channels;
+    TexelType type;
+};
+
+// One RGBA texel per 128-bit register
+#if defined(MIPMAP_SSE)
+typedef __m128 Texel;
+static inline Texel LoadTexel  (const float* p)               { return _mm_loadu_ps(p); }
+static inline void  StoreTexel (float* p, Texel t)            { _mm_storeu_ps(p, t); }
+static inline Texel AddTexel   (Texel a, Texel b)             { return _mm_add_ps(a, b); }
+static inline Texel ScaleTexel (Texel a, float s)             { return _mm_mul_ps(a, _mm_set1_ps(s)); }
+static inline Texel MulAddTexel(Texel sum, Texel a, float s)  { return _mm_add_ps(sum, _mm_mul_ps(a, _mm_set1_ps(s))); }
+static inline Texel ZeroTexel  ()                             { return _mm_setzero_ps(); }
+#elif defined(MIPMAP_NEON)
+typedef float32x4_t Texel;
+static inline Texel LoadTexel  (const float* p)               { return vld1q_f32(p); }
+static inline void  StoreTexel (float* p, Texel t)            { vst1q_f32(p, t); }
+static inline Texel AddTexel   (Texel a, Texel b)             { return vaddq_f32(a, b); }
+static inline Texel ScaleTexel (Texel a, float s)             { return vmulq_n_f32(a, s); }
+static inline Texel MulAddTexel(Texel sum, Texel a, float s)  { return vmlaq_n_f32(sum, a, s); }
+static inline Texel ZeroTexel  ()                             { return vdupq_n_f32(0.f); }
+#else
+struct Texel { float v[4]; };
+static inline Texel LoadTexel  (const float* p)               { Texel t; memcpy(t.v, p, 16); return t; }
+static inline void  StoreTexel (float* p, Texel t)            { memcpy(p, t.v, 16); }
+static inline Texel AddTexel   (Texel a, Texel b)             { for (int c = 0; c < 4; c++) a.v[c] += b.v[c]; return a; }
+static inline Texel ScaleTexel (Texel a, float s)             { for (int c = 0; c < 4; c++) a.v[c] *= s; return a; }
+static inline Texel MulAddTexel(Texel sum, Texel a, float s)  { for (int c = 0; c < 4; c++) sum.v[c] += a.v[c] * s; return sum; }
+static inline Texel ZeroTexel  ()                             { return Texel{}; }
+#endif
+
+struct SrgbTables {
+    float         decode[256];
+    unsigned char encode[4096];
+
+    SrgbTables() {
+        for (int i = 0; i < 256; i++) {
+            float value = i / 255.f;
+            decode[i] = value <= 0.04045f ? value / 12.92f : std::pow((value + 0.055f) / 1.055f, 2.4f);
+        }
+        for (int i = 0; i < 4096; i++) {
+            float value = i / 4095.f;
+            value = value <= 0.0031308f ? value * 12.92f : 1.055f * std::pow(value, 1.f / 2.4f) - 0.055f;
+            encode[i] = (unsigned char) std::lround(value * 255.f);
+        }
+    }
+};
+
+static const SrgbTables& GetSrgbTables() {
+    static const SrgbTables tables;
+    return tables;
+}
+
+// 2:1 windowed sinc; taps sit at source offsets -3..4 around the left texel of each pair
+struct KaiserWeights {
+    float weights[KAISER_TAPS];
+
+    KaiserWeights() {
+        auto besselI0 = [](float x) {
+            float sum = 1.f, term = 1.f;
+            for (int k = 1; k < 16; k++) {
+                term *= (x / (2.f * k)) * (x / (2.f * k));
+                sum  += term;
+            }
+            return sum;
+        };
+        float total = 0.f;
+        for (int t = 0; t < KAISER_TAPS; t++) {
+            float distance = (t - KAISER_TAPS / 2 + 1) - 0.5f;
+            float x        = distance * 0.5f;
+            float sinc     = std::sin(float(M_PI) * x) / (float(M_PI) * x);
+            float ratio    = distance / (KAISER_TAPS / 2);
+            float window   = besselI0(KAISER_ALPHA * std::sqrt(std::max(1.f - ratio * ratio, 0.f))) / besselI0(KAISER_ALPHA);
+            weights[t] = sinc * window;
+            total     += weights[t];
+        }
+        for (float& weight : weights) weight /= total;
+    }
+};
+
+static const float* GetKaiserWeights() {
+    static const KaiserWeights kaiser;
+    return kaiser.weights;
+}
+
+static bool GetTexelLayout(VkFormat format, TexelLayout* layout) {
+    switch (format) {
+        case VK_FORMAT_R8G8B8_SRGB         : *layout = { 3, TexelSrgb8  }; return true;
+        case VK_FORMAT_R8G8B8A8_SRGB       : *layout = { 4, TexelSrgb8  }; return true;
+        case VK_FORMAT_R8_UNORM            : *layout = { 1, TexelUnorm8 }; return true;
+        case VK_FORMAT_R8G8_UNORM          : *layout = { 2, TexelUnorm8 }; return true;
+        case VK_FORMAT_R8G8B8A8_UNORM      : *layout = { 4, TexelUnorm8 }; return true;
+        case VK_FORMAT_R16G16_SFLOAT       : *layout = { 2, TexelHalf   }; return true;
+        case VK_FORMAT_R16G16B16_SFLOAT    : *layout = { 3, TexelHalf   }; return true;
+        case VK_FORMAT_R16G16B16A16_SFLOAT : *layout = { 4, TexelHalf   }; return true;
+        case VK_FORMAT_R32G32B32_SFLOAT    : *layout = { 3, TexelFloat  }; return true;
+        case VK_FORMAT_R32G32B32A32_SFLOAT : *layout = { 4, TexelFloat  }; return true;
+        case VK_FORMAT_B10G11R11_UFLOAT_PACK32: *layout = { 3, TexelB10G11R11 }; return true;
+        case VK_FORMAT_E5B9G9R9_UFLOAT_PACK32 : *layout = { 3, TexelE5B9G9R9  }; return true;
+        default: return false;
+    }
+}
+
+static uint32_t GetTexelSize(TexelLayout layout) {
+    if (layout.type == TexelB10G11R11 || layout.type == TexelE5B9G9R9) return 4;
+    uint32_t channelSize = layout.type == TexelFloat ? 4 : layout.type == TexelHalf ? 2 : 1;
+    return layout.channels * channelSize;
+}
+
+// Missing channels read as 0, except alpha which reads as 1
+static void DecodeRow(const char* source, float* texels, uint32_t count, TexelLayout layout) {
+    const SrgbTables& srgb = GetSrgbTables();
+    for (uint32_t i = 0; i < count; i++) {
+        float* texel = texels + i * 4;
+        if (layout.type == TexelB10G11R11 || layout.type == TexelE5B9G9R9) {
+            uint32_t packed;
+            memcpy(&packed, source + i * 4, 4);
+            if (layout.type == TexelB10G11R11) UnpackB10G11R11(packed, texel);
+            else                               UnpackE5B9G9R9 (packed, texel);
+            texel[3] = 1.f;
+            continue;
+        }
+        for (uint32_t c = 0; c < 4; c++) {
+            if (c >= layout.channels) { texel[c] = c == 3 ? 1.f : 0.f; continue; }
+            uint32_t index = i * layout.channels + c;
+            switch (layout.type) {
+                case TexelSrgb8 : texel[c] = c == 3 ? uint8_t(source[index]) / 255.f : srgb.decode[uint8_t(source[index])]; break;
+                case TexelUnorm8: texel[c] = uint8_t(source[index]) / 255.f; break;
+                case TexelHalf  : { uint16_t half; memcpy(&half, source + index * 2, 2); texel[c] = HalfToFloat(half); } break;
+                case TexelFloat : memcpy(&texel[c], source + index * 4, 4); break;
+                default: break;
+            }
+        }
+    }
+}
+
+static void EncodeRow(const float* texels, char* output, uint32_t count, TexelLayout layout) {
+    const SrgbTables& srgb = GetSrgbTables();
+    for (uint32_t i = 0; i < count; i++) {
+        if (layout.type == TexelB10G11R11 || layout.type == TexelE5B9G9R9) {
+            uint32_t packed = layout.type == TexelB10G11R11 ? PackB10G11R11(texels + i * 4) : PackE5B9G9R9(texels + i * 4);
+            memcpy(output + i * 4, &packed, 4);
+            continue;
+        }
+        for (uint32_t c = 0; c < layout.channels; c++) {
+            float    value = std::max(texels[i * 4 + c], 0.f);
+            uint32_t index = i * layout.channels + c;
+            switch (layout.type) {
+                case TexelSrgb8 : output[index] = c == 3 ? char(std::lround(std::min(value, 1.f) * 255.f))
+                                                         : char(srgb.encode[std::lround(std::min(value, 1.f) * 4095.f)]); break;
+                case TexelUnorm8: output[index] = char(std::lround(std::min(value, 1.f) * 255.f)); break;
+                case TexelHalf  : { uint16_t half = FloatToHalf(value); memcpy(output + index * 2, &half, 2); } break;
+                case TexelFloat : memcpy(output + index * 4, &value, 4); break;
+                default: break;
+            }
+        }
+    }
+}
+
+// Splits rows across the pool; waiting through it lets a decode task call this without starving workers
+template <class F> static void ParallelRows(uint32_t rows, F&& task) {
+    ThreadPool* pool = System::ThreadPool();
+    if (pool == nullptr || rows < MIP_ROWS_PER_TASK * 2) {
+        task(0, rows);
+        return;
+    }
+    std::vector<std::future<void>> futures;
+    for (uint32_t y = 0; y < rows; y += MIP_ROWS_PER_TASK) {
+        uint32_t end = std::min(y + MIP_ROWS_PER_TASK, rows);
+        futures.push_back(pool->push([&task, y, end]() { task(y, end); }));
+    }
+    for (std::future<void>& future : futures) pool->wait(future);
+}
+
+static void BoxRows(const float* source, uint32_t width, uint32_t height, float* output, uint32_t y0, uint32_t y1) {
+    uint32_t halfWidth = std::max(width / 2, 1u);
+    uint32_t pairCount = width / 2;
+    for (uint32_t y = y0; y < y1; y++) {
+        const float* row0 = source + std::min(y * 2    , height - 1) * width * 4;
+        const float* row1 = source + std::min(y * 2 + 1, height - 1) * width * 4;
+        float*       out  = output + y * halfWidth * 4;
+        uint32_t     x    = 0;
+#if defined(__AVX__)
+        // Two output texels per step: sum rows, then pair the 128-bit halves across registers
+        const __m256 quarter = _mm256_set1_ps(0.25f);
+        for (; x + 2 <= pairCount; x += 2) {
+            __m256 left  = _mm256_add_ps(_mm256_loadu_ps(row0 + x * 8    ), _mm256_loadu_ps(row1 + x * 8    ));
+            __m256 right = _mm256_add_ps(_mm256_loadu_ps(row0 + x * 8 + 8), _mm256_loadu_ps(row1 + x * 8 + 8));
+            __m256 even  = _mm256_permute2f128_ps(left, right, 0x20);
+            __m256 odd   = _mm256_permute2f128_ps(left, right, 0x31);
+            _mm256_storeu_ps(out + x * 4, _mm256_mul_ps(_mm256_add_ps(even, odd), quarter));
+        }
+#endif
+        for (; x < pairCount; x++) {
+            Texel sum = AddTexel(AddTexel(LoadTexel(row0 + x * 8), LoadTexel(row0 + x * 8 + 4)),
+                                 AddTexel(LoadTexel(row1 + x * 8), LoadTexel(row1 + x * 8 + 4)));
+            StoreTexel(out + x * 4, ScaleTexel(sum, 0.25f));
+        }
+        // A 1-wide source clamps its right neighbour onto itself
+        for (; x < halfWidth; x++) {
+            uint32_t x0 = std::min(x * 2, width - 1) * 4, x1 = std::min(x * 2 + 1, width - 1) * 4;
+            Texel sum = AddTexel(AddTexel(LoadTexel(row0 + x0), LoadTexel(row0 + x1)),
+                                 AddTexel(LoadTexel(row1 + x0), LoadTexel(row1 + x1)));
+            StoreTexel(out + x * 4, ScaleTexel(sum, 0.25f));
+        }
+    }
+}
+
+// Two RGBA texels per 256-bit register with AVX2
+#if defined(MIPMAP_AVX2)
+static inline __m256 LoadTexelPair(const float* first, const float* second) {
+    return _mm256_insertf128_ps(_mm256_castps128_ps256(_mm_loadu_ps(first)), _mm_loadu_ps(second), 1);
+}
+#endif
+
+static void KaiserRowsHorizontal(const float* source, uint32_t width, float* output, uint32_t y0, uint32_t y1) {
+    const float* weights   = GetKaiserWeights();
+    uint32_t     halfWidth = std::max(width / 2, 1u);
+    for (uint32_t y = y0; y < y1; y++) {
+        const float* row = source + y * width * 4;
+        float*       out = output + y * halfWidth * 4;
+        for (uint32_t x = 0; x < halfWidth; ) {
+            int32_t first = int32_t(x * 2) - KAISER_TAPS / 2 + 1;
+#if defined(MIPMAP_AVX2)
+            // Inside the row the taps of outputs x and x + 1 sit two texels apart and need no clamping
+            if (first >= 0 && first + 2 + KAISER_TAPS <= int32_t(width) && x + 1 < halfWidth) {
+                __m256 sum = _mm256_setzero_ps();
+                for (int t = 0; t < KAISER_TAPS; t++) {
+                    const float* tap = row + (first + t) * 4;
+                    sum = _mm256_fmadd_ps(LoadTexelPair(tap, tap + 8), _mm256_set1_ps(weights[t]), sum);
+                }
+                _mm256_storeu_ps(out + x * 4, sum);
+                x += 2;
+                continue;
+            }
+#endif
+            Texel sum = ZeroTexel();
+            for (int t = 0; t < KAISER_TAPS; t++) {
+                int32_t sx = std::min(std::max(first + t, 0), int32_t(width) - 1);
+                sum = MulAddTexel(sum, LoadTexel(row + sx * 4), weights[t]);
+            }
+            StoreTexel(out + x * 4, sum);
+            x++;
+        }
+    }
+}
+
+static void KaiserRowsVertical(const float* source, uint32_t width, uint32_t height, float* output, uint32_t y0, uint32_t y1) {
+    const float* weights = GetKaiserWeights();
+    for (uint32_t y = y0; y < y1; y++) {
+        const float* rows[KAISER_TAPS];
+        for (int t = 0; t < KAISER_TAPS; t++) {
+            int32_t sy = std::min(std::max(int32_t(y * 2) + t - KAISER_TAPS / 2 + 1, 0), int32_t(height) - 1);
+            rows[t] = source + sy * width * 4;
+        }
+        float*   out = output + y * width * 4;
+        uint32_t x   = 0;
+#if defined(MIPMAP_AVX2)
+        for (; x + 2 <= width; x += 2) {
+            __m256 sum = _mm256_setzero_ps();
+            for (int t = 0; t < KAISER_TAPS; t++)
+                sum = _mm256_fmadd_ps(_mm256_loadu_ps(rows[t] + x * 4), _mm256_set1_ps(weights[t]), sum);
+            _mm256_storeu_ps(out + x * 4, sum);
+        }
+#endif
+        for (; x < width; x++) {
+            Texel sum = ZeroTexel();
+            for (int t = 0; t < KAISER_TAPS; t++) sum = MulAddTexel(sum, LoadTexel(rows[t] + x * 4), weights[t]);
+            StoreTexel(out + x * 4, sum);
+        }
+    }
+}
+
+bool IsMipFormatSupported(VkFormat format) {
+    TexelLayout layout;
+    return GetTexelLayout(format, &layout);
+}
+
+MipChain GenerateMipChain(const void* pixels, uint32_t width, uint32_t height, VkFormat format, MipFilter filter) {
+    TexelLayout layout;
+    bool isSupported = GetTexelLayout(format, &layout);
+    CHECK_BOOL(isSupported, "unsupported format for cpu mipmaps!");
+    uint32_t texelSize = GetTexelSize(layout);
+
+    MipChain chain;
+    VkDeviceSize offset = 0;
+    for (uint32_t w = width, h = height; ; w = std::max(w / 2, 1u), h = std::max(h / 2, 1u)) {
+        offset = (offset + MIP_ALIGNMENT - 1) / MIP_ALIGNMENT * MIP_ALIGNMENT;
+        chain.levels.push_back({ offset, VkDeviceSize(w) * h * texelSize });
+        offset += VkDeviceSize(w) * h * texelSize;
+        if (w == 1 && h == 1) break;
+    }
+    chain.data.resize(offset);
+    memcpy(chain.data.data(), pixels, chain.levels[0].size);
+
+    std::vector<float> current(size_t(width) * height * 4), next, temp;
+    const char* source = (const char*) pixels;
+    ParallelRows(height, [&](uint32_t y0, uint32_t y1) {
+        for (uint32_t y = y0; y < y1; y++)
+            DecodeRow(source + size_t(y) * width * texelSize, current.data() + size_t(y) * width * 4, width, layout);
+    });
+
+    uint32_t levelWidth = width, levelHeight = height;
+    for (uint32_t level = 1; level < chain.levels.size(); level++) {
+        uint32_t halfWidth  = std::max(levelWidth  / 2, 1u);
+        uint32_t halfHeight = std::max(levelHeight / 2, 1u);
+        next.resize(size_t(halfWidth) * halfHeight * 4);
+
+        if (filter == MipFilterKaiser) {
+            temp.resize(size_t(halfWidth) * levelHeight * 4);
+            ParallelRows(levelHeight, [&](uint32_t y0, uint32_t y1) {
+                KaiserRowsHorizontal(current.data(), levelWidth, temp.data(), y0, y1);
+            });
+            ParallelRows(halfHeight, [&](uint32_t y0, uint32_t y1) {
+                KaiserRowsVertical(temp.data(), halfWidth, levelHeight, next.data(), y0, y1);
+            });
+        } else {
+            ParallelRows(halfHeight, [&](uint32_t y0, uint32_t y1) {
+                BoxRows(current.data(), levelWidth, levelHeight, next.data(), y0, y1);
+            });
+        }
+
+        char* output = chain.data.data() + chain.levels[level].offset;
+        ParallelRows(halfHeight, [&](uint32_t y0, uint32_t y1) {
+            for (uint32_t y = y0; y < y1; y++)
+                EncodeRow(next.data() + size_t(y) * halfWidth * 4, output + size_t(y) * halfWidth * texelSize, halfWidth, layout);
+        });
+
+        std::swap(current, next);
+        levelWidth  = halfWidth;
+        levelHeight = halfHeight;
+    }
+    return chain;
+}
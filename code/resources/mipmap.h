@@ -0,0 +1,19 @@
+//  Copyright © 2021 Subph. All rights reserved.
+//
+
+#pragma once
+
+#include "ktx2.h"
+
+enum MipFilter { MipFilterBox = 0, MipFilterKaiser = 1 };
+
+// One layer's full chain, level 0 included; level offsets are 16-byte aligned
+struct MipChain {
+    std::vector<Ktx2Level> levels;
+    std::vector<char>      data;
+};
+
+bool IsMipFormatSupported(VkFormat format);
+
+// Filters in linear float RGBA
+MipChain GenerateMipChain(const void* pixels, uint32_t width, uint32_t height, VkFormat format, MipFilter filter);
@@ -0,0 +1,183 @@
+//  Copyright © 2021 Subph. All rights reserved.
+//
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#include <iomanip>
+#include <thread>
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "texture_cache.h"
+
+#define TEXTURE_CACHE_VERSION   2
+#define TEXTURE_CACHE_ALIGNMENT 16
+
+static const char TEXTURE_CACHE_MAGIC[4] = { 'T', 'X', 'C', 'H' };
+
+struct TextureCacheHeader {
+    char     magic[4];
+    uint32_t version;
+    uint32_t format;
+    uint32_t width;
+    uint32_t height;
+    uint32_t levelCount;
+};
+
+struct TextureCacheLevel {
+    uint64_t offset;
+    uint64_t size;
+};
+
+// 64-bit multiply-xor over whole words
+uint64_t HashFile(const std::string filepath, uint64_t* fileSize, uint32_t version) {
+    std::ifstream file(filepath, std::ios::binary);
+    if (!file.is_open()) return 0;
+
+    const uint64_t prime = 0x100000001B3ull;
+    uint64_t hash = 0xCBF29CE484222325ull ^ version;
+    uint64_t size = 0;
+    std::vector<char> chunk(1 << 20);
+    while (file) {
+        file.read(chunk.data(), chunk.size());
+        size_t count = (size_t) file.gcount();
+        size_t words = count / 8;
+        for (size_t i = 0; i < words; i++) {
+            uint64_t word;
+            memcpy(&word, chunk.data() + i * 8, 8);
+            hash = (hash ^ word) * prime;
+            hash ^= hash >> 29;
+        }
+        for (size_t i = words * 8; i < count; i++) hash = (hash ^ uint8_t(chunk[i])) * prime;
+        size += count;
+    }
+    *fileSize = size;
+    return hash;
+}
+
+void CreateCacheDirectory(const std::string directory) {
+    std::string path = directory;
+    for (size_t i = path.find('/'); i != std::string::npos; i = path.find('/', i + 1))
+        mkdir(path.substr(0, i).c_str(), 0755);
+}
+
+void CreateTextureCacheDirectory() { CreateCacheDirectory(TEXTURE_CACHE_DIRECTORY); }
+
+std::string GetTextureCachePath(const std::string filepath) {
+    uint64_t fileSize = 0;
+    uint64_t hash     = HashFile(filepath, &fileSize, TEXTURE_CACHE_VERSION);
+
+    std::stringstream stream;
+    stream << TEXTURE_CACHE_DIRECTORY << std::hex << std::setfill('0')
+           << std::setw(16) << hash << "_" << fileSize << ".tex";
+    return stream.str();
+}
+
+// Packed textures key on every source in order, so swapping two channels is a different blob
+std::string GetTextureCachePath(const std::vector<std::string> filepaths) {
+    uint64_t totalSize = 0;
+    uint64_t hash      = 0;
+    for (const std::string& filepath : filepaths) {
+        uint64_t fileSize = 0;
+        hash = (hash ^ HashFile(filepath, &fileSize, TEXTURE_CACHE_VERSION)) * 0x100000001B3ull;
+        totalSize += fileSize;
+    }
+
+    std::stringstream stream;
+    stream << TEXTURE_CACHE_DIRECTORY << std::hex << std::setfill('0')
+           << std::setw(16) << hash << "_" << totalSize << "_" << filepaths.size() << ".tex";
+    return stream.str();
+}
+
+bool MapCachedTexture(const std::string cachePath, CachedTexture* texture) {
+    int file = open(cachePath.c_str(), O_RDONLY);
+    if (file < 0) return false;
+
+    struct stat status;
+    void* mapped = MAP_FAILED;
+    if (fstat(file, &status) == 0 && status.st_size >= (off_t) sizeof(TextureCacheHeader))
+        mapped = mmap(nullptr, status.st_size, PROT_READ, MAP_PRIVATE, file, 0);
+    close(file);
+    if (mapped == MAP_FAILED) return false;
+
+    const char* data    = (const char*) mapped;
+    size_t      mapSize = (size_t) status.st_size;
+    madvise(mapped, mapSize, MADV_SEQUENTIAL);
+
+    TextureCacheHeader header;
+    memcpy(&header, data, sizeof(TextureCacheHeader));
+    size_t tableEnd = sizeof(TextureCacheHeader) + header.levelCount * sizeof(TextureCacheLevel);
+    bool isValid = memcmp(header.magic, TEXTURE_CACHE_MAGIC, 4) == 0 &&
+                   header.version == TEXTURE_CACHE_VERSION &&
+                   header.levelCount > 0 && tableEnd <= mapSize;
+
+    std::vector<Ktx2Level> levels(isValid ? header.levelCount : 0);
+    for (uint32_t i = 0; i < levels.size(); i++) {
+        TextureCacheLevel level;
+        memcpy(&level, data + sizeof(TextureCacheHeader) + i * sizeof(TextureCacheLevel), sizeof(TextureCacheLevel));
+        isValid = isValid && level.offset + level.size <= mapSize;
+        levels[i] = { level.offset, level.size };
+    }
+    if (!isValid) {
+        munmap(mapped, mapSize);
+        return false;
+    }
+
+    texture->format  = VkFormat(header.format);
+    texture->width   = header.width;
+    texture->height  = header.height;
+    texture->levels  = levels;
+    texture->data    = data;
+    texture->mapSize = mapSize;
+    return true;
+}
+
+void UnmapCachedTexture(CachedTexture* texture) {
+    if (texture->data != nullptr) munmap((void*) texture->data, texture->mapSize);
+    *texture = CachedTexture{};
+}
+
+// Renaming a finished file keeps a concurrent reader from mapping half a blob
+void WriteCacheFile(const std::string cachePath, const std::vector<char>& blob) {
+    std::stringstream tempStream;
+    tempStream << cachePath << "." << getpid() << "." << std::this_thread::get_id() << ".tmp";
+    std::string tempPath = tempStream.str();
+    std::ofstream stream(tempPath, std::ios::binary);
+    if (!stream.is_open()) return;
+    stream.write(blob.data(), blob.size());
+    stream.close();
+    if (stream.fail() || std::rename(tempPath.c_str(), cachePath.c_str()) != 0) std::remove(tempPath.c_str());
+}
+
+void WriteCachedTexture(const std::string cachePath, const MipChain& chain, uint32_t width, uint32_t height,
+                        VkFormat format) {
+    uint32_t levelCount = uint32_t(chain.levels.size());
+    TextureCacheHeader header;
+    memcpy(header.magic, TEXTURE_CACHE_MAGIC, 4);
+    header.version    = TEXTURE_CACHE_VERSION;
+    header.format     = format;
+    header.width      = width;
+    header.height     = height;
+    header.levelCount = levelCount;
+
+    // The chain's own aligned offsets carry over, shifted past the header and level table
+    uint64_t tableEnd = sizeof(TextureCacheHeader) + levelCount * sizeof(TextureCacheLevel);
+    uint64_t base     = (tableEnd + TEXTURE_CACHE_ALIGNMENT - 1) / TEXTURE_CACHE_ALIGNMENT * TEXTURE_CACHE_ALIGNMENT;
+    std::vector<TextureCacheLevel> table(levelCount);
+    for (uint32_t i = 0; i < levelCount; i++) table[i] = { base + chain.levels[i].offset, chain.levels[i].size };
+    uint64_t offset = base + chain.data.size();
+
+    std::vector<char> blob(offset, 0);
+    memcpy(blob.data(), &header, sizeof(TextureCacheHeader));
+    memcpy(blob.data() + sizeof(TextureCacheHeader), table.data(), levelCount * sizeof(TextureCacheLevel));
+    memcpy(blob.data() + base, chain.data.data(), chain.data.size());
+
+    CreateTextureCacheDirectory();
+    WriteCacheFile(cachePath, blob);
+}
@@ -0,0 +1,39 @@
+//  Copyright © 2021 Subph. All rights reserved.
+//
+
+#pragma once
+
+#include "ktx2.h"
+#include "mipmap.h"
+
+#define TEXTURE_CACHE_DIRECTORY "cache/textures/"
+
+// A cache blob mapped read-only; levels point into data, level 0 is the full size image
+struct CachedTexture {
+    VkFormat               format  = VK_FORMAT_UNDEFINED;
+    uint32_t               width   = 0;
+    uint32_t               height  = 0;
+    std::vector<Ktx2Level> levels;
+    const char*            data    = nullptr;
+    size_t                 mapSize = 0;
+};
+
+// Keyed by a hash of the source file contents, so edited sources miss and stale blobs are never read
+std::string GetTextureCachePath(const std::string filepath);
+std::string GetTextureCachePath(const std::vector<std::string> filepaths);
+
+// Shared with the other caches; the version seeds the hash so a format change misses every old blob
+uint64_t HashFile(const std::string filepath, uint64_t* fileSize, uint32_t version);
+
+void CreateCacheDirectory(const std::string directory);
+void CreateTextureCacheDirectory();
+
+// Writes through a temp file named per process and thread, so readers see either no blob or a whole one
+// and concurrent writers of the same blob never share a temp file; a failed write leaves no file
+void WriteCacheFile(const std::string cachePath, const std::vector<char>& blob);
+
+bool MapCachedTexture  (const std::string cachePath, CachedTexture* texture);
+void UnmapCachedTexture(CachedTexture* texture);
+
+void WriteCachedTexture(const std::string cachePath, const MipChain& chain, uint32_t width, uint32_t height,
+                        VkFormat format);
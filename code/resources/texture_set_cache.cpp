@@ -0,0 +1,182 @@
+//  Copyright © 2021 Subph. All rights reserved.
+//
+
+#include <algorithm>
+
+#include "texture_set_cache.h"
+
+#include "../system.h"
+#include "../helper.h"
+
+TextureSetCache::~TextureSetCache() {}
+TextureSetCache::TextureSetCache() {}
+
+// Decodes still running write into their images, so they finish before anything is freed
+void TextureSetCache::cleanup() {
+    LOG("TextureSetCache::cleanup");
+    for (auto& entry : m_sets) {
+        for (std::future<void>& decode : entry.second.decodes) decode.wait();
+        for (Image* pTexture : entry.second.pTextures) pTexture->cleanup();
+    }
+    m_sets.clear();
+}
+
+void TextureSetCache::setup(std::vector<std::string> names, VkDeviceSize budget, bool hasAlbedo) {
+    m_names     = names;
+    m_budget    = budget;
+    m_hasAlbedo = hasAlbedo;
+}
+
+// Starts decoding a set that is not cached yet; either way the set becomes the most recently used
+void TextureSetCache::request(uint32_t index) {
+    CHECK_BOOL((index < m_names.size()), "texture set index out of range!");
+    if (!m_sets.count(index)) createSet(index);
+    
+    {
+        m_sets[index].lastUsed = ++m_clock;
+        m_lastRequested = index;
+    }
+}
+
+// Blocks until the set's decodes finish, then stages it in a batch of its own
+void TextureSetCache::upload(uint32_t index) {
+    TextureSet& set = m_sets[index];
+    if (set.state != Decoding) return;
+    Image::UploadImages(set.pTextures, set.decodes);
+    
+    VkDeviceSize size = 0;
+    for (Image* pTexture : set.pTextures) size += pTexture->getMemorySize();
+    
+    {
+        set.decodes.clear();
+        set.token = System::Uploader()->submit();
+        set.size  = size;
+        set.state = Uploading;
+    }
+}
+
+// Call once per frame. Decoded sets upload, finished uploads become resident, then the cache is trimmed
+void TextureSetCache::update(uint32_t displayed) {
+    Uploader* uploader = System::Uploader();
+    for (auto& entry : m_sets) {
+        TextureSet& set = entry.second;
+        if (set.state == Decoding) {
+            bool isDecoded = true;
+            for (std::future<void>& decode : set.decodes)
+                isDecoded &= decode.wait_for(std::chrono::seconds(0)) == std::future_status::ready;
+            if (isDecoded) upload(entry.first);
+        } else if (set.state == Uploading && uploader->isComplete(set.token)) {
+            set.state = Resident;
+        }
+    }
+    evict(displayed);
+}
+
+void TextureSetCache::setBudget(VkDeviceSize budget) { m_budget = budget; }
+
+bool TextureSetCache::isResident(uint32_t index) {
+    return m_sets.count(index) && m_sets[index].state == Resident;
+}
+
+// The images exist from the request on, but only sample them once the set is resident
+std::vector<Image*> TextureSetCache::getTextures(uint32_t index) {
+    return m_sets.count(index) ? m_sets[index].pTextures : std::vector<Image*>();
+}
+
+std::vector<std::string> TextureSetCache::getNames() { return m_names; }
+
+// Most recently used first
+std::vector<TextureSetCache::SetStatus> TextureSetCache::getStatus() {
+    std::vector<std::pair<uint64_t, SetStatus>> ordered;
+    for (auto& entry : m_sets)
+        ordered.push_back({ entry.second.lastUsed, { entry.first, entry.second.state, entry.second.size } });
+    std::sort(ordered.begin(), ordered.end(),
+              [](const auto& a, const auto& b) { return a.first > b.first; });
+    
+    std::vector<SetStatus> status;
+    for (auto& entry : ordered) status.push_back(entry.second);
+    return status;
+}
+
+VkDeviceSize TextureSetCache::getBudget() { return m_budget; }
+
+VkDeviceSize TextureSetCache::getCachedSize() {
+    VkDeviceSize size = 0;
+    for (auto& entry : m_sets) size += entry.second.size;
+    return size;
+}
+
+int64_t TextureSetCache::getDecodeMicroseconds() { return m_decodeMicroseconds; }
+
+
+// Private ==================================================
+
+
+// Maps cooked by tools/texture_cooker sit next to the PNGs and win when the device samples BC
+void TextureSetCache::createSet(uint32_t index) {
+    ThreadPool* pool = System::ThreadPool();
+    std::atomic<int64_t>* pDecodeTime = &m_decodeMicroseconds;
+    bool hasTextureCompressionBC = System::Renderer()->hasTextureCompressionBC();
+    
+    std::string name     = m_names[index];
+    std::string basePath = TEXTURE_SET_DIRECTORY + name + "/" + name;
+    std::vector<std::string> paths   = { basePath + "_albedo.png", basePath + "_normal.png" };
+    
+    // Normals are data, so they stay linear like their BC5 cooked form
+    std::vector<VkFormat>    formats = { VK_FORMAT_R8G8B8A8_SRGB, VK_FORMAT_R8G8B8A8_UNORM };
+    if (!m_hasAlbedo) {
+        paths  .erase(paths  .begin());
+        formats.erase(formats.begin());
+    }
+    
+    TextureSet set;
+    for (uint i = 0; i < paths.size(); i++) {
+        std::string path       = paths[i];
+        VkFormat    format     = formats[i];
+        std::string cookedPath = path.substr(0, path.find_last_of('.')) + ".ktx2";
+        bool isCooked = hasTextureCompressionBC && FileExists(cookedPath);
+        Image* pTexture = new Image();
+        set.decodes.push_back(pool->push([pTexture, path, format, cookedPath, isCooked, pDecodeTime]() {
+            auto start = Time::now();
+            if (isCooked) pTexture->setupForCompressedTexture(cookedPath);
+            else          pTexture->setupForTexture(path, format);
+            *pDecodeTime += std::chrono::duration_cast<std::chrono::microseconds>(Time::now() - start).count();
+        }));
+        set.pTextures.push_back(pTexture);
+    }
+    
+    // AO, roughness and metallic share one texture as R, G and B
+    std::vector<std::string> ormPaths  = { basePath + "_ao.png", basePath + "_roughness.png", basePath + "_metallic.png" };
+    std::string              ormCooked = basePath + "_orm.ktx2";
+    bool isOrmCooked = hasTextureCompressionBC && FileExists(ormCooked);
+    Image* pOrmTexture = new Image();
+    set.decodes.push_back(pool->push([pOrmTexture, ormPaths, ormCooked, isOrmCooked, pDecodeTime]() {
+        auto start = Time::now();
+        if (isOrmCooked) pOrmTexture->setupForCompressedTexture(ormCooked);
+        else             pOrmTexture->setupForPackedTexture(ormPaths);
+        *pDecodeTime += std::chrono::duration_cast<std::chrono::microseconds>(Time::now() - start).count();
+    }));
+    set.pTextures.push_back(pOrmTexture);
+    
+    { m_sets[index] = std::move(set); }
+}
+
+// Least recently used resident sets go first. The displayed set, the last requested one and sets still
+// streaming a level are kept; frames in flight may still sample a victim, so its images are retired
+void TextureSetCache::evict(uint32_t displayed) {
+    DeletionQueue* pDeletionQueue = System::DeletionQueue();
+    while (getCachedSize() > m_budget) {
+        auto victim = m_sets.end();
+        for (auto it = m_sets.begin(); it != m_sets.end(); it++) {
+            if (it->first == displayed || it->first == m_lastRequested || it->second.state != Resident) continue;
+            bool isStreaming = false;
+            for (Image* pTexture : it->second.pTextures) isStreaming |= pTexture->isStreamPending();
+            if (isStreaming) continue;
+            if (victim == m_sets.end() || it->second.lastUsed < victim->second.lastUsed) victim = it;
+        }
+        if (victim == m_sets.end()) return;
+        
+        for (Image* pTexture : victim->second.pTextures) pDeletionQueue->retire(pTexture);
+        m_sets.erase(victim);
+    }
+}
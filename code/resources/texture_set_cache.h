@@ -0,0 +1,72 @@
+//  Copyright © 2021 Subph. All rights reserved.
+//
+
+#pragma once
+
+#include <atomic>
+#include <future>
+#include <map>
+
+#include "../common.h"
+#include "../renderer/uploader.h"
+#include "image.h"
+
+#define TEXTURE_SET_DIRECTORY "textures/pbr/"
+#define TEXTURE_SET_BUDGET_MB 256
+
+// PBR texture sets (albedo, normal, ORM) by index into a list of set names. Sets decode on the thread
+// pool and upload in their own batch; resident sets stay cached and the least recently requested ones
+// are evicted once the cache grows past its budget. Without the albedo, sets hold only normal and ORM
+class TextureSetCache {
+
+public:
+    ~TextureSetCache();
+    TextureSetCache();
+
+    enum State { Decoding = 0, Uploading = 1, Resident = 2 };
+
+    struct SetStatus {
+        uint32_t     index;
+        State        state;
+        VkDeviceSize size;
+    };
+
+    void cleanup();
+    void setup(std::vector<std::string> names, VkDeviceSize budget, bool hasAlbedo = true);
+
+    void request(uint32_t index);
+    void upload (uint32_t index);
+    void update (uint32_t displayed);
+
+    void setBudget(VkDeviceSize budget);
+
+    bool                     isResident (uint32_t index);
+    std::vector<Image*>      getTextures(uint32_t index);
+    std::vector<std::string> getNames   ();
+    std::vector<SetStatus>   getStatus  ();
+    VkDeviceSize             getBudget  ();
+    VkDeviceSize             getCachedSize();
+    int64_t                  getDecodeMicroseconds();
+
+private:
+
+    struct TextureSet {
+        State               state    = Decoding;
+        std::vector<Image*> pTextures;
+        std::vector<std::future<void>> decodes;
+        Uploader::Token     token    = 0;
+        VkDeviceSize        size     = 0;
+        uint64_t            lastUsed = 0;
+    };
+
+    std::vector<std::string>        m_names;
+    std::map<uint32_t, TextureSet>  m_sets;
+    VkDeviceSize                    m_budget        = 0;
+    bool                            m_hasAlbedo     = true;
+    uint64_t                        m_clock         = 0;
+    uint32_t                        m_lastRequested = 0;
+    std::atomic<int64_t>            m_decodeMicroseconds{0};
+
+    void createSet(uint32_t index);
+    void evict(uint32_t displayed);
+};
@@ -0,0 +1,331 @@
+//  Copyright © 2021 Subph. All rights reserved.
+//
+
+#include <cstring>
+
+#include "virtual_texture.h"
+
+#include "../system.h"
+#include "../helper.h"
+
+VirtualTexture::~VirtualTexture() {}
+VirtualTexture::VirtualTexture() {
+    m_device = System::Renderer()->getDevice();
+}
+
+// Page reads still running write into their load buffers, so they finish before anything is freed
+void VirtualTexture::cleanup() {
+    LOG("VirtualTexture::cleanup");
+    for (auto& entry : m_loads) entry.second.done.wait();
+    m_loads.clear();
+    m_pCache->cleanup();
+    m_pPageTable->cleanup();
+    m_pFeedback->cleanup();
+    m_pStaging->cleanup();
+    UnmapVirtualTexture(&m_file);
+}
+
+// The first run tiles the source into the texture cache; later runs map the tiled file straight away
+void VirtualTexture::setup(const std::string filepath, uint32_t frameCount) {
+    LOG("VirtualTexture::setup");
+    std::string        path = GetVirtualTexturePath(filepath);
+    VirtualTextureFile file;
+    if (!MapVirtualTexture(path, &file)) {
+        int width, height, channels;
+        unsigned char* data = LoadImage(filepath, &width, &height, &channels);
+        CHECK_BOOL((data != nullptr), "failed to load virtual texture source!");
+        CHECK_BOOL((width == height), "virtual texture source must be square!");
+        WriteVirtualTexture(path, data, UINT32(width), VK_FORMAT_R8G8B8A8_SRGB);
+        FreeImage(data);
+        CHECK_BOOL(MapVirtualTexture(path, &file), "failed to map virtual texture!");
+    }
+    
+    {
+        m_file         = file;
+        m_frameCount   = frameCount;
+        m_pagesPerSide = file.size / VT_PAGE_SIZE;
+    }
+}
+
+void VirtualTexture::create() {
+    LOG("VirtualTexture::create");
+    VirtualTextureFile file         = m_file;
+    uint32_t           pagesPerSide = m_pagesPerSide;
+    uint32_t           frameCount   = m_frameCount;
+    uint32_t           cacheSize    = VT_CACHE_SLOTS_PER_SIDE * VT_SLOT_SIZE;
+    
+    VkPhysicalDeviceProperties properties;
+    vkGetPhysicalDeviceProperties(System::Renderer()->getPhysicalDevice(), &properties);
+    VkDeviceSize alignment = properties.limits.minStorageBufferOffsetAlignment;
+    
+    Image* pCache = new Image();
+    pCache->setupForTiles({ cacheSize, cacheSize }, 1, file.format);
+    pCache->create();
+    pCache->createSampler();
+    
+    // One texel per page, level by level, which is the page numbering of the tiled file
+    Image* pPageTable = new Image();
+    pPageTable->setupForTiles({ pagesPerSide, pagesPerSide }, file.levelCount, VK_FORMAT_R8G8B8A8_UINT);
+    pPageTable->create();
+    
+    VkSamplerCreateInfo samplerInfo = SamplerCache::GetTextureSamplerInfo();
+    samplerInfo.magFilter        = VK_FILTER_NEAREST;
+    samplerInfo.minFilter        = VK_FILTER_NEAREST;
+    samplerInfo.mipmapMode       = VK_SAMPLER_MIPMAP_MODE_NEAREST;
+    samplerInfo.anisotropyEnable = VK_FALSE;
+    samplerInfo.maxAnisotropy    = 1.0f;
+    VkSampler tableSampler = System::SamplerCache()->getSampler(samplerInfo);
+    
+    // Per frame in flight: a uvec4 of layout info, then one request flag per page
+    VkDeviceSize feedbackStride = (16 + file.pageCount * 4 + alignment - 1) / alignment * alignment;
+    Buffer* pFeedback = new Buffer();
+    pFeedback->setup(feedbackStride * frameCount, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, Allocator::GpuToCpu);
+    pFeedback->create();
+    for (uint32_t i = 0; i < frameCount; i++) {
+        uint32_t* feedback = (uint32_t*) ((char*) pFeedback->getMapped() + i * feedbackStride);
+        memset(feedback, 0, feedbackStride);
+        feedback[0] = pagesPerSide;
+        feedback[1] = file.levelCount;
+        feedback[2] = VT_CACHE_SLOTS_PER_SIDE;
+    }
+    pFeedback->flush();
+    
+    // Per frame in flight: the pages landing that frame, then the whole page table
+    VkDeviceSize tableBytes    = file.pageCount * 4;
+    VkDeviceSize stagingStride = (VT_PAGES_PER_FRAME * GetVirtualPageBytes() + tableBytes + 15) / 16 * 16;
+    Buffer* pStaging = new Buffer();
+    pStaging->setup(stagingStride * frameCount, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, Allocator::CpuToGpu);
+    pStaging->create();
+    
+    {
+        m_pCache         = pCache;
+        m_pPageTable     = pPageTable;
+        m_pFeedback      = pFeedback;
+        m_pStaging       = pStaging;
+        m_tableSampler   = tableSampler;
+        m_feedbackStride = feedbackStride;
+        m_stagingStride  = stagingStride;
+        m_tableBytes     = tableBytes;
+        m_pageSlots      = std::vector<int32_t>(file.pageCount, -1);
+        m_slots          = std::vector<Slot>(VT_CACHE_SLOTS_PER_SIDE * VT_CACHE_SLOTS_PER_SIDE);
+    }
+    
+    // The single page of the coarsest level stays pinned, so every lookup has something to fall back to
+    loadPage(file.pageCount - 1);
+}
+
+// Call once the frame's previous submission has retired. Requested pages that are resident count as used;
+// missing ones keep their resident ancestor alive and queue a read from the tiled file
+void VirtualTexture::update(uint32_t frameIndex) {
+    uint64_t     frame  = ++m_frameCounter;
+    VkDeviceSize offset = frameIndex * m_feedbackStride;
+    m_pFeedback->invalidate(offset, m_feedbackStride);
+    
+    uint32_t* requests = (uint32_t*) ((char*) m_pFeedback->getMapped() + offset) + 4;
+    std::vector<uint32_t> missing;
+    for (uint32_t page = 0; page < m_file.pageCount; page++) {
+        if (requests[page] == 0) continue;
+        requests[page] = 0;
+        int32_t resident = page;
+        while (resident >= 0 && m_pageSlots[resident] < 0) resident = getParentPage(resident);
+        if (resident >= 0) m_slots[m_pageSlots[resident]].lastUsed = frame;
+        if (resident != int32_t(page) && !m_loads.count(page)) missing.push_back(page);
+    }
+    m_pFeedback->flush(offset, m_feedbackStride);
+    
+    // Coarser levels sit later in the file and cover more of the screen, so they are read first
+    for (auto it = missing.rbegin(); it != missing.rend() && m_loads.size() < VT_LOADS_IN_FLIGHT; it++)
+        loadPage(*it);
+}
+
+// Copies the pages whose reads finished into free or least recently used slots, then rewrites the page table
+void VirtualTexture::cmdUpload(VkCommandBuffer commandBuffer, uint32_t frameIndex) {
+    uint32_t     topPage     = m_file.pageCount - 1;
+    VkDeviceSize pageBytes   = GetVirtualPageBytes();
+    VkDeviceSize stageOffset = frameIndex * m_stagingStride;
+    char*        staging     = (char*) m_pStaging->getMapped() + stageOffset;
+    if (m_isFirstUpload) m_loads[topPage].done.wait();
+    
+    std::vector<VkBufferImageCopy> pageCopies;
+    for (auto it = m_loads.begin(); it != m_loads.end() && pageCopies.size() < VT_PAGES_PER_FRAME;) {
+        if (it->second.done.wait_for(std::chrono::seconds(0)) != std::future_status::ready) { it++; continue; }
+        int32_t slot = acquireSlot();
+        if (slot < 0) break;
+        
+        uint32_t page = it->first;
+        if (m_slots[slot].page >= 0) m_pageSlots[m_slots[slot].page] = -1;
+        m_slots[slot]     = { int32_t(page), m_frameCounter, page == topPage };
+        m_pageSlots[page] = slot;
+        
+        VkDeviceSize pageOffset = pageCopies.size() * pageBytes;
+        memcpy(staging + pageOffset, it->second.data.data(), pageBytes);
+        
+        VkBufferImageCopy region{};
+        region.bufferOffset     = stageOffset + pageOffset;
+        region.imageSubresource = { VK_IMAGE_ASPECT_COLOR_BIT, 0, 0, 1 };
+        region.imageOffset      = { int32_t(slot % VT_CACHE_SLOTS_PER_SIDE * VT_SLOT_SIZE),
+                                    int32_t(slot / VT_CACHE_SLOTS_PER_SIDE * VT_SLOT_SIZE), 0 };
+        region.imageExtent      = { VT_SLOT_SIZE, VT_SLOT_SIZE, 1 };
+        pageCopies.push_back(region);
+        it = m_loads.erase(it);
+    }
+    if (pageCopies.empty()) return;
+    
+    VkDeviceSize tableOffset = VT_PAGES_PER_FRAME * pageBytes;
+    fillPageTable((uint8_t*) staging + tableOffset);
+    m_pStaging->flush(stageOffset, m_stagingStride);
+    
+    std::vector<VkBufferImageCopy> tableCopies;
+    for (uint32_t level = 0; level < m_file.levelCount; level++) {
+        uint32_t side = m_pagesPerSide >> level;
+        VkBufferImageCopy region{};
+        region.bufferOffset     = stageOffset + tableOffset + GetVirtualPageIndex(m_pagesPerSide, level, 0, 0) * 4;
+        region.imageSubresource = { VK_IMAGE_ASPECT_COLOR_BIT, level, 0, 1 };
+        region.imageExtent      = { side, side, 1 };
+        tableCopies.push_back(region);
+    }
+    
+    // Earlier frames may still sample the slots being replaced; the barrier orders the copies after them
+    std::array<VkImageMemoryBarrier, 2> barriers{};
+    for (VkImageMemoryBarrier& barrier : barriers) {
+        barrier.sType               = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+        barrier.oldLayout           = m_isFirstUpload ? VK_IMAGE_LAYOUT_UNDEFINED : VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+        barrier.newLayout           = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+        barrier.srcAccessMask       = 0;
+        barrier.dstAccessMask       = VK_ACCESS_TRANSFER_WRITE_BIT;
+        barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    }
+    barriers[0].image            = m_pCache->getImage();
+    barriers[0].subresourceRange = { VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1 };
+    barriers[1].image            = m_pPageTable->getImage();
+    barriers[1].subresourceRange = { VK_IMAGE_ASPECT_COLOR_BIT, 0, m_file.levelCount, 0, 1 };
+    vkCmdPipelineBarrier(commandBuffer,
+                         VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0,
+                         0, nullptr,
+                         0, nullptr,
+                         UINT32(barriers.size()), barriers.data());
+    
+    VkBuffer stagingBuffer = m_pStaging->getBuffer();
+    vkCmdCopyBufferToImage(commandBuffer, stagingBuffer, m_pCache->getImage(),
+                           VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, UINT32(pageCopies.size()), pageCopies.data());
+    vkCmdCopyBufferToImage(commandBuffer, stagingBuffer, m_pPageTable->getImage(),
+                           VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, UINT32(tableCopies.size()), tableCopies.data());
+    
+    for (VkImageMemoryBarrier& barrier : barriers) {
+        barrier.oldLayout     = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+        barrier.newLayout     = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+        barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+        barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+    }
+    vkCmdPipelineBarrier(commandBuffer,
+                         VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, 0,
+                         0, nullptr,
+                         0, nullptr,
+                         UINT32(barriers.size()), barriers.data());
+    
+    { m_isFirstUpload = false; }
+}
+
+// Makes this frame's requests visible to update() once its fence signals
+void VirtualTexture::cmdFinishFeedback(VkCommandBuffer commandBuffer) {
+    VkMemoryBarrier barrier{};
+    barrier.sType         = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+    barrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+    barrier.dstAccessMask = VK_ACCESS_HOST_READ_BIT;
+    vkCmdPipelineBarrier(commandBuffer,
+                         VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, VK_PIPELINE_STAGE_HOST_BIT, 0,
+                         1, &barrier,
+                         0, nullptr,
+                         0, nullptr);
+}
+
+VkDescriptorImageInfo VirtualTexture::getCacheInfo() { return m_pCache->getImageInfo(); }
+
+VkDescriptorImageInfo VirtualTexture::getPageTableInfo() {
+    VkDescriptorImageInfo imageInfo = m_pPageTable->getImageInfo();
+    imageInfo.sampler = m_tableSampler;
+    return imageInfo;
+}
+
+VkDescriptorBufferInfo VirtualTexture::getFeedbackInfo() {
+    VkDescriptorBufferInfo bufferInfo = m_pFeedback->getBufferInfo();
+    bufferInfo.range = m_feedbackStride;
+    return bufferInfo;
+}
+
+uint32_t  VirtualTexture::getFeedbackOffset(uint32_t frameIndex) { return UINT32(frameIndex * m_feedbackStride); }
+VkSampler VirtualTexture::getPageTableSampler() { return m_tableSampler; }
+
+uint32_t VirtualTexture::getResidentPageCount() {
+    uint32_t count = 0;
+    for (const Slot& slot : m_slots) count += slot.page >= 0;
+    return count;
+}
+
+// Writing the feedback buffer from the fragment shader needs fragmentStoresAndAtomics
+bool VirtualTexture::IsSupported() {
+    return USE_VIRTUAL_TEXTURE && System::TextureTable() == nullptr && System::Renderer()->hasFragmentStores();
+}
+
+
+// Private ==================================================
+
+
+// The read goes through the mapping on a pool thread, so page faults never stall the render thread
+void VirtualTexture::loadPage(uint32_t page) {
+    VkDeviceSize pageBytes = GetVirtualPageBytes();
+    const char*  source    = m_file.pages + page * pageBytes;
+    
+    PageLoad& load = m_loads[page];
+    load.data.resize(pageBytes);
+    char* output = load.data.data();
+    load.done = System::ThreadPool()->push([source, output, pageBytes]() { memcpy(output, source, pageBytes); });
+}
+
+// A free slot first, otherwise the least recently used one that no request touched this frame
+int32_t VirtualTexture::acquireSlot() {
+    int32_t victim = -1;
+    for (int32_t i = 0; i < int32_t(m_slots.size()); i++) {
+        const Slot& slot = m_slots[i];
+        if (slot.page < 0) return i;
+        if (slot.isPinned || slot.lastUsed >= m_frameCounter) continue;
+        if (victim < 0 || slot.lastUsed < m_slots[victim].lastUsed) victim = i;
+    }
+    return victim;
+}
+
+int32_t VirtualTexture::getParentPage(uint32_t page) {
+    uint32_t level = 0;
+    uint32_t index = page;
+    while (index >= (m_pagesPerSide >> level) * (m_pagesPerSide >> level)) {
+        index -= (m_pagesPerSide >> level) * (m_pagesPerSide >> level);
+        level++;
+    }
+    if (level + 1 >= m_file.levelCount) return -1;
+    uint32_t side = m_pagesPerSide >> level;
+    return GetVirtualPageIndex(m_pagesPerSide, level + 1, index % side / 2, index / side / 2);
+}
+
+// Entries are the slot's x and y, then the level that is actually resident there. Coarse levels fill first,
+// so a missing page copies its parent's entry, which already points at the nearest resident ancestor
+void VirtualTexture::fillPageTable(uint8_t* output) {
+    for (int32_t level = int32_t(m_file.levelCount) - 1; level >= 0; level--) {
+        uint32_t side = m_pagesPerSide >> level;
+        for (uint32_t y = 0; y < side; y++)
+        for (uint32_t x = 0; x < side; x++) {
+            uint32_t page  = GetVirtualPageIndex(m_pagesPerSide, level, x, y);
+            int32_t  slot  = m_pageSlots[page];
+            uint8_t* entry = output + page * 4;
+            if (slot < 0 && level + 1 < int32_t(m_file.levelCount)) {
+                memcpy(entry, output + GetVirtualPageIndex(m_pagesPerSide, level + 1, x / 2, y / 2) * 4, 4);
+                continue;
+            }
+            if (slot < 0) slot = 0;
+            entry[0] = uint8_t(slot % VT_CACHE_SLOTS_PER_SIDE);
+            entry[1] = uint8_t(slot / VT_CACHE_SLOTS_PER_SIDE);
+            entry[2] = uint8_t(level);
+            entry[3] = 255;
+        }
+    }
+}
@@ -0,0 +1,84 @@
+//  Copyright © 2021 Subph. All rights reserved.
+//
+
+#pragma once
+
+#include <future>
+#include <map>
+
+#include "../common.h"
+#include "virtual_texture_file.h"
+#include "image.h"
+#include "buffer.h"
+
+#define VT_CACHE_SLOTS_PER_SIDE 24
+#define VT_PAGES_PER_FRAME      16
+#define VT_LOADS_IN_FLIGHT      64
+
+// Page based virtual texture. Only the pages the GPU reports through the feedback buffer are read from the
+// tiled file and copied into the page cache; the page table sends every other page to its nearest resident
+// ancestor, so memory follows visible detail instead of the size of the source
+class VirtualTexture {
+
+public:
+    ~VirtualTexture();
+    VirtualTexture();
+
+    void cleanup();
+
+    void setup (const std::string filepath, uint32_t frameCount);
+    void create();
+
+    void update   (uint32_t frameIndex);
+    void cmdUpload(VkCommandBuffer commandBuffer, uint32_t frameIndex);
+    void cmdFinishFeedback(VkCommandBuffer commandBuffer);
+
+    VkDescriptorImageInfo  getCacheInfo();
+    VkDescriptorImageInfo  getPageTableInfo();
+    VkDescriptorBufferInfo getFeedbackInfo();
+    uint32_t               getFeedbackOffset(uint32_t frameIndex);
+    VkSampler              getPageTableSampler();
+
+    uint32_t getResidentPageCount();
+
+    static bool IsSupported();
+
+private:
+
+    struct Slot {
+        int32_t  page     = -1;
+        uint64_t lastUsed = 0;
+        bool     isPinned = false;
+    };
+
+    struct PageLoad {
+        std::vector<char>  data;
+        std::future<void>  done;
+    };
+
+    VkDevice           m_device     = VK_NULL_HANDLE;
+    VirtualTextureFile m_file;
+    uint32_t           m_frameCount = 0;
+    uint32_t           m_pagesPerSide = 0;
+
+    Image*    m_pCache       = nullptr;
+    Image*    m_pPageTable   = nullptr;
+    Buffer*   m_pFeedback    = nullptr;
+    Buffer*   m_pStaging     = nullptr;
+    VkSampler m_tableSampler = VK_NULL_HANDLE;
+
+    VkDeviceSize m_feedbackStride = 0;
+    VkDeviceSize m_stagingStride  = 0;
+    VkDeviceSize m_tableBytes     = 0;
+
+    std::vector<int32_t>         m_pageSlots;
+    std::vector<Slot>            m_slots;
+    std::map<uint32_t, PageLoad> m_loads;
+    uint64_t                     m_frameCounter = 0;
+    bool                         m_isFirstUpload = true;
+
+    void    loadPage     (uint32_t page);
+    int32_t acquireSlot  ();
+    int32_t getParentPage(uint32_t page);
+    void    fillPageTable(uint8_t* output);
+};
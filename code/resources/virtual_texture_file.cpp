@@ -0,0 +1,135 @@
+//  Copyright © 2021 Subph. All rights reserved.
+//
+
+#include <cstring>
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "virtual_texture_file.h"
+#include "texture_cache.h"
+#include "mipmap.h"
+
+#define VIRTUAL_TEXTURE_VERSION   1
+#define VIRTUAL_TEXTURE_ALIGNMENT 16
+
+static const char VIRTUAL_TEXTURE_MAGIC[4] = { 'V', 'T', 'E', 'X' };
+
+struct VirtualTextureHeader {
+    char     magic[4];
+    uint32_t version;
+    uint32_t format;
+    uint32_t pageSize;
+    uint32_t border;
+    uint32_t size;
+    uint32_t levelCount;
+};
+
+static uint64_t GetPagesOffset() {
+    uint64_t headerSize = sizeof(VirtualTextureHeader);
+    return (headerSize + VIRTUAL_TEXTURE_ALIGNMENT - 1) / VIRTUAL_TEXTURE_ALIGNMENT * VIRTUAL_TEXTURE_ALIGNMENT;
+}
+
+std::string GetVirtualTexturePath(const std::string filepath) {
+    std::string cachePath = GetTextureCachePath(filepath);
+    return cachePath.substr(0, cachePath.find_last_of('.')) + ".vtex";
+}
+
+bool MapVirtualTexture(const std::string path, VirtualTextureFile* file) {
+    int descriptor = open(path.c_str(), O_RDONLY);
+    if (descriptor < 0) return false;
+
+    struct stat status;
+    void* mapped = MAP_FAILED;
+    if (fstat(descriptor, &status) == 0 && status.st_size >= (off_t) GetPagesOffset())
+        mapped = mmap(nullptr, status.st_size, PROT_READ, MAP_PRIVATE, descriptor, 0);
+    close(descriptor);
+    if (mapped == MAP_FAILED) return false;
+
+    // Pages are read wherever the camera looks, so readahead would mostly fetch pages nobody asked for
+    const char* data    = (const char*) mapped;
+    size_t      mapSize = (size_t) status.st_size;
+    madvise(mapped, mapSize, MADV_RANDOM);
+
+    VirtualTextureHeader header;
+    memcpy(&header, data, sizeof(VirtualTextureHeader));
+    uint32_t pagesPerSide = header.size / VT_PAGE_SIZE;
+    uint32_t pageCount    = GetVirtualPageIndex(pagesPerSide, header.levelCount, 0, 0);
+    bool isValid = memcmp(header.magic, VIRTUAL_TEXTURE_MAGIC, 4) == 0 &&
+                   header.version  == VIRTUAL_TEXTURE_VERSION &&
+                   header.pageSize == VT_PAGE_SIZE && header.border == VT_BORDER &&
+                   header.levelCount > 0 && pagesPerSide >> (header.levelCount - 1) == 1 &&
+                   GetPagesOffset() + pageCount * GetVirtualPageBytes() <= mapSize;
+    if (!isValid) {
+        munmap(mapped, mapSize);
+        return false;
+    }
+
+    file->format     = VkFormat(header.format);
+    file->size       = header.size;
+    file->levelCount = header.levelCount;
+    file->pageCount  = pageCount;
+    file->pages      = data + GetPagesOffset();
+    file->data       = data;
+    file->mapSize    = mapSize;
+    return true;
+}
+
+void UnmapVirtualTexture(VirtualTextureFile* file) {
+    if (file->data != nullptr) munmap((void*) file->data, file->mapSize);
+    *file = VirtualTextureFile{};
+}
+
+// Border texels wrap around the level, matching the repeat addressing the material samplers use
+void WriteVirtualTexture(const std::string path, const unsigned char* pixels, uint32_t size, VkFormat format) {
+    CHECK_BOOL((size >= VT_PAGE_SIZE && (size & (size - 1)) == 0), "virtual texture must be a power of two!");
+    MipChain chain = GenerateMipChain(pixels, size, size, format, MipFilterBox);
+
+    uint32_t pagesPerSide = size / VT_PAGE_SIZE;
+    uint32_t levelCount   = 1;
+    while ((pagesPerSide >> (levelCount - 1)) > 1) levelCount++;
+    uint32_t pageCount = GetVirtualPageIndex(pagesPerSide, levelCount, 0, 0);
+
+    VirtualTextureHeader header;
+    memcpy(header.magic, VIRTUAL_TEXTURE_MAGIC, 4);
+    header.version    = VIRTUAL_TEXTURE_VERSION;
+    header.format     = format;
+    header.pageSize   = VT_PAGE_SIZE;
+    header.border     = VT_BORDER;
+    header.size       = size;
+    header.levelCount = levelCount;
+
+    std::vector<char> blob(GetPagesOffset() + pageCount * GetVirtualPageBytes(), 0);
+    memcpy(blob.data(), &header, sizeof(VirtualTextureHeader));
+
+    char* page = blob.data() + GetPagesOffset();
+    for (uint32_t level = 0; level < levelCount; level++) {
+        uint32_t    levelSize = size >> level;
+        uint32_t    pages     = pagesPerSide >> level;
+        const char* source    = chain.data.data() + chain.levels[level].offset;
+        for (uint32_t y = 0; y < pages; y++)
+        for (uint32_t x = 0; x < pages; x++) {
+            for (uint32_t row = 0; row < VT_SLOT_SIZE; row++) {
+                uint32_t sourceY = (y * VT_PAGE_SIZE + row + levelSize - VT_BORDER) % levelSize;
+                for (uint32_t column = 0; column < VT_SLOT_SIZE; column++) {
+                    uint32_t sourceX = (x * VT_PAGE_SIZE + column + levelSize - VT_BORDER) % levelSize;
+                    memcpy(page + (row * VT_SLOT_SIZE + column) * 4, source + (sourceY * levelSize + sourceX) * 4, 4);
+                }
+            }
+            page += GetVirtualPageBytes();
+        }
+    }
+
+    CreateTextureCacheDirectory();
+    WriteCacheFile(path, blob);
+}
+
+uint32_t GetVirtualPageIndex(uint32_t pagesPerSide, uint32_t level, uint32_t x, uint32_t y) {
+    uint32_t index = 0;
+    for (uint32_t i = 0; i < level; i++) index += (pagesPerSide >> i) * (pagesPerSide >> i);
+    return index + y * (pagesPerSide >> level) + x;
+}
+
+VkDeviceSize GetVirtualPageBytes() { return VT_SLOT_SIZE * VT_SLOT_SIZE * 4; }
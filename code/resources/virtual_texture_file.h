@@ -0,0 +1,35 @@
+//  Copyright © 2021 Subph. All rights reserved.
+//
+
+#pragma once
+
+#include "../common.h"
+
+#define VT_PAGE_SIZE 128
+#define VT_BORDER    1
+#define VT_SLOT_SIZE (VT_PAGE_SIZE + 2 * VT_BORDER)
+
+// A tiled texture mapped read-only. Every page of every level is stored with its wrapped border already
+// baked in, finest level first and rows of pages within a level, so a page is one contiguous read
+struct VirtualTextureFile {
+    VkFormat    format     = VK_FORMAT_UNDEFINED;
+    uint32_t    size       = 0;
+    uint32_t    levelCount = 0;
+    uint32_t    pageCount  = 0;
+    const char* pages      = nullptr;
+    const char* data       = nullptr;
+    size_t      mapSize    = 0;
+};
+
+// Lives in the texture cache, keyed by the source's contents like the pre-mipped blobs
+std::string GetVirtualTexturePath(const std::string filepath);
+
+bool MapVirtualTexture  (const std::string path, VirtualTextureFile* file);
+void UnmapVirtualTexture(VirtualTextureFile* file);
+
+// Tiles a square, power of two RGBA8 image down to the level that fits one page
+void WriteVirtualTexture(const std::string path, const unsigned char* pixels, uint32_t size, VkFormat format);
+
+// Pages are numbered across levels in file order
+uint32_t     GetVirtualPageIndex(uint32_t pagesPerSide, uint32_t level, uint32_t x, uint32_t y);
+VkDeviceSize GetVirtualPageBytes();
@@ -1,5 +1,8 @@
 #version 450
 #extension GL_ARB_separate_shader_objects : enable
+#ifdef BINDLESS
+#extension GL_EXT_nonuniform_qualifier : require
+#endif
 
 #include "../functions/constants.glsl"
 
@@ -14,11 +17,32 @@ layout(set = 1, binding = 1) uniform Misc {
 };
 
 // Textures ==================================================
+#ifdef BINDLESS
+// The renderer's texture table; each material owns 3 consecutive slots
+layout(set = 2, binding = 0) uniform sampler2D textures[];
+
+// Follows the vertex stage's dequantize transform in the shared push constant range
+layout(push_constant) uniform Material {
+    layout(offset = 48) uint id;
+} material;
+
+#define albedoMap textures[material.id * 3 + 0]
+#define normalMap textures[material.id * 3 + 1]
+#define ormMap    textures[material.id * 3 + 2] // r: ao, g: roughness, b: metallic
+#else
 layout(set = 2, binding = 0) uniform sampler2D albedoMap;
-layout(set = 2, binding = 1) uniform sampler2D aoMap;
-layout(set = 2, binding = 2) uniform sampler2D metallicMap;
-layout(set = 2, binding = 3) uniform sampler2D normalMap;
-layout(set = 2, binding = 4) uniform sampler2D roughnessMap;
+layout(set = 2, binding = 1) uniform sampler2D normalMap;
+layout(set = 2, binding = 2) uniform sampler2D ormMap; // r: ao, g: roughness, b: metallic
+#ifdef VIRTUAL_TEXTURE
+// albedoMap is then the page cache; see virtual_texture.glsl
+layout(set = 2, binding = 3) uniform usampler2D pageTable;
+
+layout(set = 2, binding = 4) buffer Feedback {
+    uvec4 info;
+    uint  requests[];
+} feedback;
+#endif
+#endif
 
 // Inputs ==================================================
 layout(location = 0) in vec3 fragNormal;
@@ -46,7 +70,7 @@ void main() {
     vec4 pbrColor = vec4(pbr(), 1.0);
     outColor = pbrColor;
     
-    float metallic  = texture(metallicMap, fragTexCoord).r;
+    float metallic  = texture(ormMap, fragTexCoord).b;
     if (metallic > 0.5) {
         outColor = pbrColor * imageData[idx] * 2.4;
     }
@@ -7,19 +7,52 @@ layout(set = 0, binding = 0) uniform MVP {
     mat4 proj;
 };
 
-layout(location = 0) in vec3 inPosition;
+// Undoes the vertex quantization of the mesh; identity for full precision vertices
+layout(push_constant) uniform Dequantize {
+    vec4 positionScale;
+    vec4 positionOffset;
+    vec4 texCoordTransform;
+} dequantize;
+
+// Matches the layout picked in mesh/vertex_layout.h: float or 10-10-10 normals by default, 16-bit
+// octahedral with OCTAHEDRAL_NORMAL, 8-bit octahedral in the position's w lane with NORMAL_IN_POSITION
+layout(location = 0) in vec4 inPosition;
+#if defined(OCTAHEDRAL_NORMAL)
+layout(location = 1) in vec2 inNormal;
+#elif !defined(NORMAL_IN_POSITION)
 layout(location = 1) in vec3 inNormal;
+#endif
 layout(location = 2) in vec2 inTexCoord;
 
 layout(location = 0) out vec3 fragNormal;
 layout(location = 1) out vec2 fragTexCoord;
 layout(location = 2) out vec3 fragPosition;
 
+vec3 decodeOctahedral(vec2 encoded) {
+    vec3 normal = vec3(encoded, 1.0 - abs(encoded.x) - abs(encoded.y));
+    float fold  = max(-normal.z, 0.0);
+    normal.xy  += vec2(normal.x >= 0.0 ? -fold : fold, normal.y >= 0.0 ? -fold : fold);
+    return normalize(normal);
+}
+
+vec3 decodeNormal() {
+#if defined(OCTAHEDRAL_NORMAL)
+    return decodeOctahedral(inNormal);
+#elif defined(NORMAL_IN_POSITION)
+    int bits = int(round(inPosition.w * 65535.0));
+    vec2 encoded = vec2((bits << 24) >> 24, (bits << 16) >> 24) / 127.0;
+    return decodeOctahedral(max(encoded, vec2(-1.0)));
+#else
+    return inNormal;
+#endif
+}
+
 void main() {
-    vec4 worldPos = model * vec4(inPosition, 1.0);
+    vec3 position = inPosition.xyz * dequantize.positionScale.xyz + dequantize.positionOffset.xyz;
+    vec4 worldPos = model * vec4(position, 1.0);
     fragPosition  = vec3(worldPos);
-    fragTexCoord  = inTexCoord;
-    fragNormal    = mat3(transpose(inverse(model))) * inNormal;
+    fragTexCoord  = inTexCoord * dequantize.texCoordTransform.xy + dequantize.texCoordTransform.zw;
+    fragNormal    = mat3(transpose(inverse(model))) * decodeNormal();
 
     gl_Position =  proj * view * worldPos;
 }
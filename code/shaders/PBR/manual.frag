@@ -15,10 +15,8 @@ layout(set = 1, binding = 1) uniform Misc {
 
 // Textures ==================================================
 layout(set = 2, binding = 0) uniform sampler2D albedoMap;
-layout(set = 2, binding = 1) uniform sampler2D aoMap;
-layout(set = 2, binding = 2) uniform sampler2D metallicMap;
-layout(set = 2, binding = 3) uniform sampler2D normalMap;
-layout(set = 2, binding = 4) uniform sampler2D roughnessMap;
+layout(set = 2, binding = 1) uniform sampler2D normalMap;
+layout(set = 2, binding = 2) uniform sampler2D ormMap; // r: ao, g: roughness, b: metallic
 
 // Inputs ==================================================
 layout(location = 0) in vec3 fragNormal;
@@ -46,7 +44,7 @@ void main() {
 
     outColor = pbrColor;
     
-    float metallic  = texture(metallicMap, fragTexCoord).r;
+    float metallic  = texture(ormMap, fragTexCoord).b;
     if (metallic > 0.5) {
         outColor = pbrColor * vec4(color, 1.0) * 2.4;
     }
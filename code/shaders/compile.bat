@@ -1,4 +1,22 @@
 C:/VulkanSDK/1.2.148.1/Bin/glslc.exe shader.vert -o vert.spv
 C:/VulkanSDK/1.2.148.1/Bin/glslc.exe shader.frag -o frag.spv
 C:/VulkanSDK/1.2.148.1/Bin/glslc.exe shader.comp -o comp.spv
+C:/VulkanSDK/1.2.148.1/Bin/glslc.exe skybox.vert -o skybox.vert.spv
+C:/VulkanSDK/1.2.148.1/Bin/glslc.exe skybox.frag -o skybox.frag.spv
+
+C:/VulkanSDK/1.2.148.1/Bin/glslc.exe compute/interference1d.comp -o interference1d.comp.spv
+C:/VulkanSDK/1.2.148.1/Bin/glslc.exe compute/interference2d.comp -o interference2d.comp.spv
+C:/VulkanSDK/1.2.148.1/Bin/glslc.exe -DFORMAT=rgba16f compute/downsample.comp -o downsample_rgba16f.comp.spv
+C:/VulkanSDK/1.2.148.1/Bin/glslc.exe -DFORMAT=rgba32f compute/downsample.comp -o downsample_rgba32f.comp.spv
+
+C:/VulkanSDK/1.2.148.1/Bin/glslc.exe PBR/main1d.vert -o main1d.vert.spv
+C:/VulkanSDK/1.2.148.1/Bin/glslc.exe -DOCTAHEDRAL_NORMAL PBR/main1d.vert -o main1d_oct.vert.spv
+C:/VulkanSDK/1.2.148.1/Bin/glslc.exe -DNORMAL_IN_POSITION PBR/main1d.vert -o main1d_octw.vert.spv
+C:/VulkanSDK/1.2.148.1/Bin/glslc.exe PBR/main1d.frag -o main1d.frag.spv
+C:/VulkanSDK/1.2.148.1/Bin/glslc.exe -DBINDLESS PBR/main1d.frag -o main1d_bindless.frag.spv
+C:/VulkanSDK/1.2.148.1/Bin/glslc.exe -DVIRTUAL_TEXTURE PBR/main1d.frag -o main1d_virtual.frag.spv
+C:/VulkanSDK/1.2.148.1/Bin/glslc.exe PBR/main2d.vert -o main2d.vert.spv
+C:/VulkanSDK/1.2.148.1/Bin/glslc.exe PBR/main2d.frag -o main2d.frag.spv
+C:/VulkanSDK/1.2.148.1/Bin/glslc.exe PBR/manual.vert -o manual.vert.spv
+C:/VulkanSDK/1.2.148.1/Bin/glslc.exe PBR/manual.frag -o manual.frag.spv
 pause
@@ -7,9 +7,15 @@ cd /Users/subrotoph/Developer/Vulkan/Vulkan/code/shaders
 
 /usr/local/bin/glslc compute/interference1d.comp -o ../../shaders/interference1d.comp.spv
 /usr/local/bin/glslc compute/interference2d.comp -o ../../shaders/interference2d.comp.spv
+/usr/local/bin/glslc -DFORMAT=rgba16f compute/downsample.comp -o ../../shaders/downsample_rgba16f.comp.spv
+/usr/local/bin/glslc -DFORMAT=rgba32f compute/downsample.comp -o ../../shaders/downsample_rgba32f.comp.spv
 
 /usr/local/bin/glslc PBR/main1d.vert -o ../../shaders/main1d.vert.spv
+/usr/local/bin/glslc -DOCTAHEDRAL_NORMAL PBR/main1d.vert -o ../../shaders/main1d_oct.vert.spv
+/usr/local/bin/glslc -DNORMAL_IN_POSITION PBR/main1d.vert -o ../../shaders/main1d_octw.vert.spv
 /usr/local/bin/glslc PBR/main1d.frag -o ../../shaders/main1d.frag.spv
+/usr/local/bin/glslc -DBINDLESS PBR/main1d.frag -o ../../shaders/main1d_bindless.frag.spv
+/usr/local/bin/glslc -DVIRTUAL_TEXTURE PBR/main1d.frag -o ../../shaders/main1d_virtual.frag.spv
 /usr/local/bin/glslc PBR/main2d.vert -o ../../shaders/main2d.vert.spv
 /usr/local/bin/glslc PBR/main2d.frag -o ../../shaders/main2d.frag.spv
 /usr/local/bin/glslc PBR/manual.vert -o ../../shaders/manual.vert.spv
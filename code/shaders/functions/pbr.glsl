@@ -1,5 +1,12 @@
 
 
+#ifdef VIRTUAL_TEXTURE
+#include "virtual_texture.glsl"
+#define sampleAlbedo(uv) sampleVirtual(uv)
+#else
+#define sampleAlbedo(uv) texture(albedoMap, uv)
+#endif
+
 float DistributionGGX(vec3 N, vec3 H, float roughness) {
     // UE4 use square roughness
     float a = roughness*roughness;
@@ -38,10 +45,11 @@ vec3 fresnelSchlick(float cosTheta, vec3 F0) {
 }
 
 vec3 pbr() {
-    vec3  albedo    = pow(texture(albedoMap, fragTexCoord).rgb, vec3(2.2));
-    float metallic  = texture(metallicMap, fragTexCoord).r;
-    float roughness = texture(roughnessMap, fragTexCoord).r;
-    float ao        = texture(aoMap, fragTexCoord).r;
+    vec3  albedo    = pow(sampleAlbedo(fragTexCoord).rgb, vec3(2.2));
+    vec3  orm       = texture(ormMap, fragTexCoord).rgb;
+    float ao        = orm.r;
+    float roughness = orm.g;
+    float metallic  = orm.b;
 
     vec3 N = getNormalFromMap();
     vec3 V = normalize(viewPosition - fragPosition);
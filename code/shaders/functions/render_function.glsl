@@ -1,6 +1,8 @@
 
 vec3 getNormalFromMap() {
-    vec3 tangentNormal = texture(normalMap, fragTexCoord).rgb;
+    // Only RG is stored (BC5), so Z is rebuilt from the unit length
+    vec2 tangentXY     = texture(normalMap, fragTexCoord).rg * 2.0 - 1.0;
+    vec3 tangentNormal = vec3(tangentXY, sqrt(max(1.0 - dot(tangentXY, tangentXY), 0.0)));
     
     vec3 Q1  = dFdx(fragPosition);
     vec3 Q2  = dFdy(fragPosition);
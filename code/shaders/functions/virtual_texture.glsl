@@ -0,0 +1,35 @@
+
+// Slots in the page cache hold a 128 texel page plus a 1 texel border on every side
+#define VT_PAGE_SIZE 128.0
+#define VT_SLOT_SIZE 130.0
+
+// feedback.info = (pages per side at level 0, level count, cache slots per side, unused)
+uint getVirtualPageIndex(uint pagesPerSide, uint level, uvec2 page) {
+    uint index = 0;
+    for (uint l = 0; l < level; l++) index += (pagesPerSide >> l) * (pagesPerSide >> l);
+    return index + page.y * (pagesPerSide >> level) + page.x;
+}
+
+// One fragment in sixteen reports the page it wants; the page table already points every page at its
+// nearest resident ancestor, so the lookup below never misses
+vec4 sampleVirtual(vec2 uv) {
+    uint  pagesPerSide = feedback.info.x;
+    uint  levelCount   = feedback.info.y;
+    vec2  wrapped      = fract(uv);
+    
+    vec2  texels = uv * float(pagesPerSide) * VT_PAGE_SIZE;
+    vec2  dx     = dFdx(texels);
+    vec2  dy     = dFdy(texels);
+    float lod    = 0.5 * log2(max(dot(dx, dx), dot(dy, dy)));
+    uint  level  = uint(clamp(floor(lod), 0.0, float(levelCount - 1)));
+    
+    uvec2 page = min(uvec2(wrapped * float(pagesPerSide >> level)), uvec2((pagesPerSide >> level) - 1));
+    if ((uint(gl_FragCoord.x) & 3) == 0 && (uint(gl_FragCoord.y) & 3) == 0) {
+        feedback.requests[getVirtualPageIndex(pagesPerSide, level, page)] = 1;
+    }
+    
+    uvec4 entry      = texelFetch(pageTable, ivec2(page), int(level));
+    vec2  inPage     = fract(wrapped * float(pagesPerSide >> entry.z));
+    vec2  cacheTexel = vec2(entry.xy) * VT_SLOT_SIZE + 1.0 + inPage * VT_PAGE_SIZE;
+    return textureLod(albedoMap, cacheTexel / (float(feedback.info.z) * VT_SLOT_SIZE), 0.0);
+}
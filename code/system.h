@@ -7,17 +7,30 @@
 #include "renderer/renderer.h"
 #include "renderer/swapchain.h"
 #include "renderer/commander.h"
+#include "renderer/allocator.h"
+#include "renderer/uploader.h"
+#include "renderer/deletion_queue.h"
+#include "renderer/downsampler.h"
 #include "window/settings.h"
+#include "thread_pool.h"
 
 class System {
     
 public:
     Renderer* m_pRenderer = nullptr;
     Settings* m_pSettings = nullptr;
+    ThreadPool* m_pThreadPool = nullptr;
     
     static Renderer * Renderer () { return Instance().m_pRenderer; }
     static Commander* Commander() { return Instance().m_pRenderer->getCommander(); }
+    static Allocator* Allocator() { return Instance().m_pRenderer->getAllocator(); }
+    static Uploader * Uploader () { return Instance().m_pRenderer->getUploader (); }
+    static DeletionQueue* DeletionQueue() { return Instance().m_pRenderer->getDeletionQueue(); }
+    static Downsampler* Downsampler() { return Instance().m_pRenderer->getDownsampler(); }
+    static SamplerCache* SamplerCache() { return Instance().m_pRenderer->getSamplerCache(); }
+    static TextureTable* TextureTable() { return Instance().m_pRenderer->getTextureTable(); }
     static Settings * Settings () { return Instance().m_pSettings; }
+    static ThreadPool* ThreadPool() { return Instance().m_pThreadPool; }
     
     static System& Instance() {
         static System instance; // Guaranteed to be destroyed. Instantiated on first use.
@@ -0,0 +1,70 @@
+//  Copyright © 2021 Subph. All rights reserved.
+//
+
+#include "thread_pool.h"
+
+ThreadPool::~ThreadPool() {}
+ThreadPool::ThreadPool() {}
+
+void ThreadPool::cleanup() {
+    LOG("ThreadPool::cleanup");
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_isStopping = true;
+    }
+    m_condition.notify_all();
+    for (std::thread& worker : m_workers) worker.join();
+    m_workers.clear();
+}
+
+void ThreadPool::setup(uint32_t workerCount) {
+    m_workerCount = workerCount;
+}
+
+void ThreadPool::create() {
+    LOG("ThreadPool::create");
+    uint32_t workerCount = m_workerCount;
+    if (workerCount == 0) workerCount = std::max(std::thread::hardware_concurrency(), 1u);
+
+    std::vector<std::thread> workers;
+    for (uint32_t i = 0; i < workerCount; i++)
+        workers.emplace_back(&ThreadPool::workerLoop, this);
+    PRINTLN2("ThreadPool workers:", workerCount);
+
+    {
+        m_workerCount = workerCount;
+        m_workers     = std::move(workers);
+    }
+}
+
+bool ThreadPool::runPending() {
+    std::function<void()> task;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (m_tasks.empty()) return false;
+        task = std::move(m_tasks.front());
+        m_tasks.pop_front();
+    }
+    task();
+    return true;
+}
+
+uint32_t ThreadPool::getWorkerCount() { return m_workerCount; }
+
+
+// Private ==================================================
+
+
+void ThreadPool::workerLoop() {
+    while (true) {
+        std::function<void()> task;
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_condition.wait(lock, [this]() { return m_isStopping || !m_tasks.empty(); });
+            if (m_tasks.empty()) return;
+            task = std::move(m_tasks.front());
+            m_tasks.pop_front();
+        }
+        task();
+    }
+}
@@ -0,0 +1,59 @@
+//  Copyright © 2021 Subph. All rights reserved.
+//
+
+#pragma once
+
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <future>
+#include <deque>
+
+#include "common.h"
+
+class ThreadPool {
+
+public:
+    ~ThreadPool();
+    ThreadPool();
+
+    void cleanup();
+
+    void setup(uint32_t workerCount);
+    void create();
+
+    template <class F> auto push(F&& task) -> std::future<decltype(task())> {
+        typedef decltype(task()) Result;
+        auto packaged = std::make_shared<std::packaged_task<Result()>>(std::forward<F>(task));
+        std::future<Result> future = packaged->get_future();
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_tasks.push_back([packaged]() { (*packaged)(); });
+        }
+        m_condition.notify_one();
+        return future;
+    }
+
+    // Runs queued work on the caller while waiting, so a task may wait on the tasks it pushed
+    template <class T> T wait(std::future<T>& future) {
+        while (future.wait_for(std::chrono::seconds(0)) != std::future_status::ready) {
+            if (!runPending()) future.wait();
+        }
+        return future.get();
+    }
+
+    bool     runPending();
+    uint32_t getWorkerCount();
+
+private:
+
+    uint32_t m_workerCount = 0;
+
+    std::vector<std::thread>          m_workers;
+    std::deque<std::function<void()>> m_tasks;
+    std::mutex                        m_mutex;
+    std::condition_variable           m_condition;
+    bool                              m_isStopping = false;
+
+    void workerLoop();
+};
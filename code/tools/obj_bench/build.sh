@@ -0,0 +1,6 @@
+cd "$(dirname "$0")"
+clang++ -std=c++17 -O2 -I"$VULKAN_SDK/include" \
+    main.cpp ../../mesh/obj_parser.cpp ../../thread_pool.cpp ../../libraries/tiny_obj_loader/tiny_obj_loader.cpp \
+    -o ../../../obj_bench
+
+# ../../../obj_bench
@@ -0,0 +1,112 @@
+//  Copyright © 2021 Subph. All rights reserved.
+//
+//  Compares ParseObj with tiny_obj_loader on one OBJ, the bunny by default.
+//  usage: obj_bench [model.obj] [runs]
+//  Both triangulate. The attribute arrays must match bit for bit and every corner must carry the same
+//  attribute indices, so the welded mesh is the same. Prints the best time of tiny_obj_loader and of
+//  ParseObj with 1 to 8 pool workers over the runs. Exits with 1 when anything differs.
+
+#include <algorithm>
+#include <iostream>
+#include <string>
+#include <chrono>
+#include <cstring>
+
+#include "../../libraries/tiny_obj_loader/tiny_obj_loader.h"
+#include "../../mesh/obj_parser.h"
+#include "../../thread_pool.h"
+
+typedef std::chrono::high_resolution_clock Clock;
+
+static float MillisecondsSince(Clock::time_point start) {
+    return std::chrono::duration<float>(Clock::now() - start).count() * 1000.f;
+}
+
+struct TinyObjModel {
+    tinyobj::attrib_t                attrib;
+    std::vector<tinyobj::shape_t>    shapes;
+    std::vector<tinyobj::material_t> materials;
+};
+
+static bool LoadTinyObj(const std::string& path, TinyObjModel* model) {
+    std::string warn, err;
+    if (!tinyobj::LoadObj(&model->attrib, &model->shapes, &model->materials, &warn, &err, path.c_str())) {
+        std::cout << "failed to load " << path << ": " << warn << err << std::endl;
+        return false;
+    }
+    return true;
+}
+
+template <class T> static bool IsSameBits(const std::vector<float>& expected, const std::vector<T>& values) {
+    return expected.size() * sizeof(float) == values.size() * sizeof(T) &&
+           memcmp(expected.data(), values.data(), expected.size() * sizeof(float)) == 0;
+}
+
+// Returns the first corner that differs, the corner count when all match
+static size_t FindCornerMismatch(const TinyObjModel& expected, const ObjModel& model) {
+    size_t corner = 0;
+    for (const auto& shape : expected.shapes) {
+        for (const auto& index : shape.mesh.indices) {
+            if (corner >= model.corners.size()) return corner;
+            const ObjCorner& parsed = model.corners[corner];
+            if (parsed.position != index.vertex_index || parsed.texCoord != index.texcoord_index ||
+                parsed.normal   != index.normal_index) return corner;
+            corner++;
+        }
+    }
+    return corner == model.corners.size() ? corner : std::min(corner, model.corners.size());
+}
+
+int main(int argc, char** argv) {
+    std::string path = argc > 1 ? argv[1] : "models/bunny/bunny.obj";
+    int         runs = argc > 2 ? std::max(std::stoi(argv[2]), 1) : 5;
+    
+    float tinyTime = INFINITY;
+    TinyObjModel expected;
+    for (int run = 0; run < runs; run++) {
+        expected = TinyObjModel();
+        auto start = Clock::now();
+        if (!LoadTinyObj(path, &expected)) return 1;
+        tinyTime = std::min(tinyTime, MillisecondsSince(start));
+    }
+    size_t cornerCount = 0;
+    for (const auto& shape : expected.shapes) cornerCount += shape.mesh.indices.size();
+    std::cout << path << ": " << expected.attrib.vertices.size() / 3 << " positions, " << cornerCount
+              << " corners, best of " << runs << " runs" << std::endl;
+    std::cout << "  tiny_obj_loader: " << tinyTime << " ms" << std::endl;
+    
+    // The waiting caller runs tasks too, so n workers parse on up to n + 1 threads
+    bool  isMatching = true;
+    float firstTime  = 0.f;
+    for (uint32_t workerCount = 1; workerCount <= 8; workerCount *= 2) {
+        ThreadPool threadPool;
+        threadPool.setup(workerCount);
+        threadPool.create();
+        
+        float    parseTime = INFINITY;
+        ObjModel model;
+        for (int run = 0; run < runs; run++) {
+            model = ObjModel();
+            auto start = Clock::now();
+            ParseObj(path, &model, &threadPool);
+            parseTime = std::min(parseTime, MillisecondsSince(start));
+        }
+        threadPool.cleanup();
+        if (workerCount == 1) firstTime = parseTime;
+        
+        bool isSameAttributes = IsSameBits(expected.attrib.vertices,  model.positions) &&
+                                IsSameBits(expected.attrib.texcoords, model.texCoords) &&
+                                IsSameBits(expected.attrib.normals,   model.normals);
+        size_t mismatch = FindCornerMismatch(expected, model);
+        bool isSameCorners = mismatch == cornerCount && model.corners.size() == cornerCount;
+        isMatching &= isSameAttributes && isSameCorners;
+        
+        std::cout << "  ParseObj, " << workerCount << " workers: " << parseTime << " ms, "
+                  << (parseTime > 0.f ? tinyTime / parseTime : 0.f) << "x over tiny_obj_loader, "
+                  << (parseTime > 0.f ? firstTime / parseTime : 0.f) << "x over 1 worker";
+        if (!isSameAttributes) std::cout << ", attributes DIFFER";
+        if (!isSameCorners)    std::cout << ", corners DIFFER from corner " << mismatch;
+        std::cout << std::endl;
+    }
+    return isMatching ? 0 : 1;
+}
@@ -0,0 +1,6 @@
+cd "$(dirname "$0")"
+clang++ -std=c++17 -O2 -I"$VULKAN_SDK/include" \
+    main.cpp ../../mesh/mesh_optimizer.cpp ../../mesh/obj_parser.cpp ../../mesh/vertex_weld.cpp ../../thread_pool.cpp \
+    -o ../../../optimize_bench
+
+# ../../../optimize_bench
@@ -0,0 +1,139 @@
+//  Copyright © 2021 Subph. All rights reserved.
+//
+//  Runs OptimizeMesh on the sphere Mesh::createSphere builds and on one welded OBJ, the bunny by default.
+//  usage: optimize_bench [model.obj] [runs]
+//  Prints ACMR and ATVR before and after and the best time over the runs. ACMR must not get worse, and
+//  every triangle must survive with its winding once its vertices follow the remap. Exits with 1 when
+//  either check fails.
+
+#include <algorithm>
+#include <array>
+#include <iostream>
+#include <string>
+#include <chrono>
+
+#include "../../mesh/mesh_optimizer.h"
+#include "../../mesh/obj_parser.h"
+#include "../../mesh/vertex_weld.h"
+#include "../../thread_pool.h"
+
+struct Vertex {
+    glm::vec3 position;
+    glm::vec3 normal;
+    glm::vec2 texCoord;
+};
+
+typedef std::chrono::high_resolution_clock Clock;
+
+static float MillisecondsSince(Clock::time_point start) {
+    return std::chrono::duration<float>(Clock::now() - start).count() * 1000.f;
+}
+
+// The grid of Mesh::createSphere, positions and indices only
+static void CreateSphere(int wedge, int segment, std::vector<glm::vec3>* positions, std::vector<uint32_t>* indices) {
+    float segmentStep = -2 * PI / segment;
+    float wedgeStep   = PI / wedge;
+    for (int i = 0; i <= wedge; i++) {
+        float y  = cosf(i * wedgeStep);
+        float xz = sinf(i * wedgeStep);
+        for (int j = 0; j <= segment; j++)
+            positions->emplace_back(xz * cosf(j * segmentStep), y, xz * sinf(j * segmentStep));
+    }
+    
+    uint32_t segmentVertices = segment + 1;
+    for (uint32_t i = 0; i < uint32_t(wedge); i++) {
+        uint32_t w1 = i  * segmentVertices;
+        uint32_t w2 = w1 + segmentVertices;
+        for (uint32_t j = 0; j < uint32_t(segment); j++) {
+            uint32_t d = j + 1;
+            indices->insert(indices->end(), { w1+j, w2+j, w1+d });
+            indices->insert(indices->end(), { w1+d, w2+j, w2+d });
+        }
+    }
+}
+
+// The vertices Mesh::parseModel ends with; one weld over whole vertices gives the same first use order
+static bool LoadModel(const std::string& path, std::vector<glm::vec3>* positions, std::vector<uint32_t>* indices) {
+    ThreadPool threadPool;
+    threadPool.setup(4);
+    threadPool.create();
+    ObjModel model;
+    ParseObj(path, &model, &threadPool);
+    threadPool.cleanup();
+    if (model.corners.empty()) {
+        std::cout << "no triangles in " << path << std::endl;
+        return false;
+    }
+    
+    std::vector<Vertex> corners(model.corners.size());
+    for (size_t i = 0; i < corners.size(); i++) {
+        const ObjCorner& corner = model.corners[i];
+        Vertex& vertex  = corners[i];
+        vertex.position = model.positions[corner.position];
+        vertex.normal   = corner.normal   >= 0 ? model.normals[corner.normal] : glm::vec3(0.f);
+        vertex.texCoord = corner.texCoord >= 0 ? glm::vec2(model.texCoords[corner.texCoord].x,
+                                                           1.0f - model.texCoords[corner.texCoord].y) : glm::vec2(0.f);
+    }
+    indices->resize(corners.size());
+    std::vector<uint32_t> uniqueVertices = WeldVertices(corners.data(), uint32_t(corners.size()), sizeof(Vertex),
+                                                        indices->data());
+    for (uint32_t vertex : uniqueVertices) positions->push_back(corners[vertex].position);
+    return true;
+}
+
+// Every triangle rotated to start at its smallest index, which keeps the winding, then sorted
+typedef std::array<uint32_t, 3> Triangle;
+static std::vector<Triangle> SortedTriangles(const std::vector<uint32_t>& indices, const std::vector<uint32_t>* remap) {
+    std::vector<Triangle> triangles;
+    triangles.reserve(indices.size() / 3);
+    for (size_t i = 0; i + 2 < indices.size(); i += 3) {
+        Triangle t = { indices[i], indices[i + 1], indices[i + 2] };
+        if (remap) t = { (*remap)[t[0]], (*remap)[t[1]], (*remap)[t[2]] };
+        std::rotate(t.begin(), std::min_element(t.begin(), t.end()), t.end());
+        triangles.push_back(t);
+    }
+    std::sort(triangles.begin(), triangles.end());
+    return triangles;
+}
+
+static bool CheckOptimize(const std::string& name, const std::vector<glm::vec3>& positions,
+                          const std::vector<uint32_t>& indices, int runs) {
+    uint32_t vertexCount = uint32_t(positions.size());
+    VertexCacheStats before = AnalyzeVertexCache(indices, vertexCount, VERTEX_CACHE_SIZE);
+    
+    float time = INFINITY;
+    std::vector<uint32_t> optimized, remap;
+    for (int run = 0; run < runs; run++) {
+        optimized = indices;
+        auto start = Clock::now();
+        remap = OptimizeMesh(&optimized, positions);
+        time = std::min(time, MillisecondsSince(start));
+    }
+    VertexCacheStats after = AnalyzeVertexCache(optimized, vertexCount, VERTEX_CACHE_SIZE);
+    
+    bool isAcmrKept      = after.acmr <= before.acmr;
+    bool isEveryTriangle = SortedTriangles(indices, &remap) == SortedTriangles(optimized, nullptr);
+    std::cout << name << ": " << vertexCount << " vertices, " << indices.size() / 3 << " triangles, "
+              << time << " ms" << std::endl;
+    std::cout << "  ACMR " << before.acmr << " -> " << after.acmr << (isAcmrKept ? "" : ", WORSE") << std::endl;
+    std::cout << "  ATVR " << before.atvr << " -> " << after.atvr << std::endl;
+    std::cout << "  " << (isEveryTriangle ? "every triangle kept" : "triangles CHANGED") << std::endl;
+    return isAcmrKept && isEveryTriangle;
+}
+
+int main(int argc, char** argv) {
+    std::string path = argc > 1 ? argv[1] : "models/bunny/bunny.obj";
+    int         runs = argc > 2 ? std::max(std::stoi(argv[2]), 1) : 5;
+    std::cout << "best of " << runs << " runs, cache size " << VERTEX_CACHE_SIZE << std::endl;
+    
+    std::vector<glm::vec3> spherePositions;
+    std::vector<uint32_t>  sphereIndices;
+    CreateSphere(50, 50, &spherePositions, &sphereIndices);
+    bool isSphereOptimized = CheckOptimize("sphere 50x50", spherePositions, sphereIndices, runs);
+    
+    std::vector<glm::vec3> modelPositions;
+    std::vector<uint32_t>  modelIndices;
+    if (!LoadModel(path, &modelPositions, &modelIndices)) return 1;
+    bool isModelOptimized = CheckOptimize(path, modelPositions, modelIndices, runs);
+    return isSphereOptimized && isModelOptimized ? 0 : 1;
+}
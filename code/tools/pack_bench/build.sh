@@ -0,0 +1,7 @@
+cd "$(dirname "$0")"
+clang++ -std=c++17 -O2 -I"$VULKAN_SDK/include" \
+    main.cpp ../../mesh/vertex_layout.cpp ../../mesh/obj_parser.cpp ../../mesh/vertex_weld.cpp \
+    ../../resources/hdr.cpp ../../thread_pool.cpp \
+    -L"$VULKAN_SDK/lib" -lvulkan -o ../../../pack_bench
+
+# ../../../pack_bench
@@ -0,0 +1,143 @@
+//  Copyright © 2021 Subph. All rights reserved.
+//
+//  Compares the per-vertex fill path Mesh::cmdCreateVertexBuffer used with the layout Pack functions on
+//  one welded OBJ, the bunny by default.
+//  usage: pack_bench [model.obj] [runs]
+//  The fill path made three Buffer::fillBuffer calls per vertex, each one a vkMapMemory, a memcpy and a
+//  vkUnmapMemory. There is no device here, so the map calls are left out and its time is a lower bound.
+//  Both sides write plain memory. Prints the best time of each over the runs. The float layout must give
+//  the bytes the fill path gives, and exits with 1 when it does not.
+
+#include <algorithm>
+#include <iostream>
+#include <string>
+#include <chrono>
+#include <cstring>
+
+#include "../../mesh/obj_parser.h"
+#include "../../mesh/vertex_layout.h"
+#include "../../mesh/vertex_weld.h"
+#include "../../thread_pool.h"
+
+struct Vertex {
+    glm::vec3 position;
+    glm::vec3 normal;
+    glm::vec2 texCoord;
+};
+
+typedef std::chrono::high_resolution_clock Clock;
+
+static float MillisecondsSince(Clock::time_point start) {
+    return std::chrono::duration<float>(Clock::now() - start).count() * 1000.f;
+}
+
+struct Streams {
+    std::vector<glm::vec3> positions;
+    std::vector<glm::vec3> normals;
+    std::vector<glm::vec2> texCoords;
+};
+
+// The streams Mesh::parseModel ends with; one weld over whole vertices gives the same first use order
+static bool LoadStreams(const std::string& path, Streams* streams) {
+    ThreadPool threadPool;
+    threadPool.setup(4);
+    threadPool.create();
+    ObjModel model;
+    ParseObj(path, &model, &threadPool);
+    threadPool.cleanup();
+    if (model.corners.empty()) {
+        std::cout << "no triangles in " << path << std::endl;
+        return false;
+    }
+    
+    std::vector<Vertex> corners(model.corners.size());
+    for (size_t i = 0; i < corners.size(); i++) {
+        const ObjCorner& corner = model.corners[i];
+        Vertex& vertex  = corners[i];
+        vertex.position = model.positions[corner.position];
+        vertex.normal   = corner.normal   >= 0 ? model.normals[corner.normal] : glm::vec3(0.f);
+        vertex.texCoord = corner.texCoord >= 0 ? glm::vec2(model.texCoords[corner.texCoord].x,
+                                                           1.0f - model.texCoords[corner.texCoord].y) : glm::vec2(0.f);
+    }
+    std::vector<uint32_t> indices(corners.size());
+    std::vector<uint32_t> uniqueVertices = WeldVertices(corners.data(), uint32_t(corners.size()), sizeof(Vertex),
+                                                        indices.data());
+    for (uint32_t vertex : uniqueVertices) {
+        streams->positions.push_back(corners[vertex].position);
+        streams->normals  .push_back(corners[vertex].normal);
+        streams->texCoords.push_back(corners[vertex].texCoord);
+    }
+    return true;
+}
+
+// Buffer::fillBuffer without its vkMapMemory and vkUnmapMemory. Kept out of line like the member call
+__attribute__((noinline)) static void* FillBuffer(void* mapped, const void* address, size_t size, uint32_t shift) {
+    void* ptr = static_cast<char*>(mapped) + shift;
+    memcpy(ptr, address, size);
+    return ptr;
+}
+
+static void FillVertices(const Streams& streams, void* mapped) {
+    uint32_t shift = 0;
+    for (size_t i = 0; i < streams.positions.size(); i++) {
+        FillBuffer(mapped, &streams.positions[i], sizeof(glm::vec3), shift);
+        shift += sizeof(glm::vec3);
+        FillBuffer(mapped, &streams.normals  [i], sizeof(glm::vec3), shift);
+        shift += sizeof(glm::vec3);
+        FillBuffer(mapped, &streams.texCoords[i], sizeof(glm::vec2), shift);
+        shift += sizeof(glm::vec2);
+    }
+}
+
+// Best time of one layout's dequantize setup and pack, the way Mesh::packVertices runs them
+template <class Layout> static float TimePack(const VertexStreams& streams, int runs, std::vector<char>* output) {
+    output->assign(streams.count * sizeof(typename Layout::Vertex), 0);
+    float time = INFINITY;
+    for (int run = 0; run < runs; run++) {
+        auto start = Clock::now();
+        VertexDequantize dequantize = Layout::GetDequantize(streams);
+        Layout::Pack(streams, dequantize, output->data());
+        time = std::min(time, MillisecondsSince(start));
+    }
+    return time;
+}
+
+int main(int argc, char** argv) {
+    std::string path = argc > 1 ? argv[1] : "models/bunny/bunny.obj";
+    int         runs = argc > 2 ? std::max(std::stoi(argv[2]), 1) : 5;
+    
+    Streams streams;
+    if (!LoadStreams(path, &streams)) return 1;
+    size_t count = streams.positions.size();
+    std::cout << path << ": " << count << " vertices, best of " << runs << " runs" << std::endl;
+    
+    float fillTime = INFINITY;
+    std::vector<char> filled(count * sizeof(Vertex));
+    for (int run = 0; run < runs; run++) {
+        auto start = Clock::now();
+        FillVertices(streams, filled.data());
+        fillTime = std::min(fillTime, MillisecondsSince(start));
+    }
+    
+    VertexStreams vertexStreams;
+    vertexStreams.positions = streams.positions.data();
+    vertexStreams.normals   = streams.normals  .data();
+    vertexStreams.texCoords = streams.texCoords.data();
+    vertexStreams.count     = count;
+    
+    std::vector<char> packed;
+    float floatTime   = TimePack<FloatVertexLayout>(vertexStreams, runs, &packed);
+    bool  isMatching  = packed == filled;
+    float meshTime    = TimePack<MeshVertexLayout>  (vertexStreams, runs, &packed);
+    float packedTime  = TimePack<PackedVertexLayout>(vertexStreams, runs, &packed);
+    std::cout << "  fillBuffer per attribute:   " << fillTime   << " ms, " << count * sizeof(Vertex) << " bytes"
+              << std::endl;
+    std::cout << "  FloatVertexLayout::Pack:    " << floatTime  << " ms, "
+              << (fillTime > 0.f && floatTime > 0.f ? fillTime / floatTime : 0.f) << "x, "
+              << (isMatching ? "matches" : "DIFFERS from") << " the fill path" << std::endl;
+    std::cout << "  MeshVertexLayout::Pack:     " << meshTime   << " ms, "
+              << count * sizeof(MeshVertexLayout::Vertex) << " bytes" << std::endl;
+    std::cout << "  PackedVertexLayout::Pack:   " << packedTime << " ms, "
+              << count * sizeof(PackedVertexLayout::Vertex) << " bytes" << std::endl;
+    return isMatching ? 0 : 1;
+}
@@ -0,0 +1,212 @@
+//  Copyright © 2021 Subph. All rights reserved.
+//
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+#include "bc_encoder.h"
+
+static const int BC7_WEIGHTS4[16] = { 0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64 };
+
+struct BitWriter {
+    uint8_t* output;
+    uint32_t position = 0;
+
+    void write(uint32_t value, uint32_t count) {
+        for (uint32_t i = 0; i < count; i++, position++)
+            if ((value >> i) & 1) output[position >> 3] |= uint8_t(1 << (position & 7));
+    }
+};
+
+void EncodeBC4Block(const uint8_t values[16], uint8_t output[8]) {
+    uint8_t low  = *std::min_element(values, values + 16);
+    uint8_t high = *std::max_element(values, values + 16);
+    memset(output, 0, 8);
+    output[0] = high;
+    output[1] = low;
+    if (high == low) return;
+
+    // high > low selects the eight value palette: both ends, then six steps from high to low
+    int palette[8] = { high, low };
+    for (int i = 1; i < 7; i++) palette[i + 1] = ((7 - i) * high + i * low + 3) / 7;
+
+    uint64_t indices = 0;
+    for (int i = 0; i < 16; i++) {
+        int best = 0, bestError = 256;
+        for (int j = 0; j < 8; j++) {
+            int error = std::abs(palette[j] - values[i]);
+            if (error < bestError) { best = j; bestError = error; }
+        }
+        indices |= uint64_t(best) << (i * 3);
+    }
+    for (int i = 0; i < 6; i++) output[2 + i] = uint8_t(indices >> (i * 8));
+}
+
+void EncodeBC5Block(const uint8_t red[16], const uint8_t green[16], uint8_t output[16]) {
+    EncodeBC4Block(red  , output);
+    EncodeBC4Block(green, output + 8);
+}
+
+// Mode 6 only: one subset, RGBA endpoints at 7 bits plus a p-bit each, 4-bit indices
+void EncodeBC7Block(const uint8_t rgba[64], uint8_t output[16]) {
+    float mean[4] = {};
+    for (int i = 0; i < 16; i++)
+        for (int c = 0; c < 4; c++) mean[c] += rgba[i * 4 + c] / 16.f;
+
+    float covariance[4][4] = {};
+    for (int i = 0; i < 16; i++)
+        for (int a = 0; a < 4; a++)
+            for (int b = 0; b < 4; b++)
+                covariance[a][b] += (rgba[i * 4 + a] - mean[a]) * (rgba[i * 4 + b] - mean[b]);
+
+    // Principal axis by power iteration
+    float axis[4] = { 1.f, 1.f, 1.f, 1.f };
+    for (int iteration = 0; iteration < 8; iteration++) {
+        float next[4] = {}, length = 0.f;
+        for (int a = 0; a < 4; a++) {
+            for (int b = 0; b < 4; b++) next[a] += covariance[a][b] * axis[b];
+            length += next[a] * next[a];
+        }
+        length = std::sqrt(length);
+        if (length < 1e-6f) break;
+        for (int a = 0; a < 4; a++) axis[a] = next[a] / length;
+    }
+
+    float minProjection = 0.f, maxProjection = 0.f;
+    for (int i = 0; i < 16; i++) {
+        float projection = 0.f;
+        for (int c = 0; c < 4; c++) projection += (rgba[i * 4 + c] - mean[c]) * axis[c];
+        minProjection = std::min(minProjection, projection);
+        maxProjection = std::max(maxProjection, projection);
+    }
+
+    int quantized[2][4], pbits[2];
+    float projections[2] = { minProjection, maxProjection };
+    for (int e = 0; e < 2; e++) {
+        float endpoint[4];
+        for (int c = 0; c < 4; c++) endpoint[c] = std::min(std::max(mean[c] + projections[e] * axis[c], 0.f), 255.f);
+
+        float bestError = 1e30f;
+        for (int p = 0; p < 2; p++) {
+            int   candidate[4];
+            float error = 0.f;
+            for (int c = 0; c < 4; c++) {
+                candidate[c] = std::min(std::max(int(std::lround((endpoint[c] - p) / 2.f)), 0), 127);
+                float difference = float(candidate[c] * 2 + p) - endpoint[c];
+                error += difference * difference;
+            }
+            if (error >= bestError) continue;
+            bestError = error;
+            pbits[e]  = p;
+            memcpy(quantized[e], candidate, sizeof(candidate));
+        }
+    }
+
+    int palette[16][4];
+    for (int i = 0; i < 16; i++)
+        for (int c = 0; c < 4; c++) {
+            int e0 = quantized[0][c] * 2 + pbits[0];
+            int e1 = quantized[1][c] * 2 + pbits[1];
+            palette[i][c] = ((64 - BC7_WEIGHTS4[i]) * e0 + BC7_WEIGHTS4[i] * e1 + 32) >> 6;
+        }
+
+    int indices[16];
+    for (int i = 0; i < 16; i++) {
+        int best = 0, bestError = 1 << 30;
+        for (int j = 0; j < 16; j++) {
+            int error = 0;
+            for (int c = 0; c < 4; c++) {
+                int difference = palette[j][c] - rgba[i * 4 + c];
+                error += difference * difference;
+            }
+            if (error < bestError) { best = j; bestError = error; }
+        }
+        indices[i] = best;
+    }
+
+    // The anchor index is stored without its top bit, so flip the endpoints when it is set
+    if (indices[0] >= 8) {
+        std::swap(quantized[0], quantized[1]);
+        std::swap(pbits[0], pbits[1]);
+        for (int& index : indices) index = 15 - index;
+    }
+
+    memset(output, 0, 16);
+    BitWriter writer{ output };
+    writer.write(1 << 6, 7);
+    for (int c = 0; c < 4; c++) {
+        writer.write(quantized[0][c], 7);
+        writer.write(quantized[1][c], 7);
+    }
+    writer.write(pbits[0], 1);
+    writer.write(pbits[1], 1);
+    writer.write(indices[0], 3);
+    for (int i = 1; i < 16; i++) writer.write(indices[i], 4);
+}
+
+std::vector<uint8_t> EncodeLevel(const std::vector<uint8_t>& rgba, uint32_t width, uint32_t height, TextureKind kind) {
+    uint32_t blocksX    = (width  + 3) / 4;
+    uint32_t blocksY    = (height + 3) / 4;
+    uint32_t blockBytes = kind == KindMask ? 8 : 16;
+
+    std::vector<uint8_t> encoded(blocksX * blocksY * blockBytes);
+    for (uint32_t by = 0; by < blocksY; by++) {
+        for (uint32_t bx = 0; bx < blocksX; bx++) {
+            uint8_t block[64], red[16], green[16];
+            for (uint32_t i = 0; i < 16; i++) {
+                uint32_t x = std::min(bx * 4 + i % 4, width  - 1);
+                uint32_t y = std::min(by * 4 + i / 4, height - 1);
+                memcpy(block + i * 4, rgba.data() + (y * width + x) * 4, 4);
+                red  [i] = block[i * 4];
+                green[i] = block[i * 4 + 1];
+            }
+            uint8_t* output = encoded.data() + (by * blocksX + bx) * blockBytes;
+            if      (kind == KindColor || kind == KindPacked) EncodeBC7Block(block, output);
+            else if (kind == KindNormal) EncodeBC5Block(red, green, output);
+            else                         EncodeBC4Block(red, output);
+        }
+    }
+    return encoded;
+}
+
+static float SrgbToLinear(float value) {
+    return value <= 0.04045f ? value / 12.92f : std::pow((value + 0.055f) / 1.055f, 2.4f);
+}
+
+static float LinearToSrgb(float value) {
+    return value <= 0.0031308f ? value * 12.92f : 1.055f * std::pow(value, 1.f / 2.4f) - 0.055f;
+}
+
+std::vector<uint8_t> DownsampleLevel(const std::vector<uint8_t>& rgba, uint32_t width, uint32_t height, TextureKind kind) {
+    uint32_t halfWidth  = std::max(width  / 2, 1u);
+    uint32_t halfHeight = std::max(height / 2, 1u);
+
+    std::vector<uint8_t> result(halfWidth * halfHeight * 4);
+    for (uint32_t y = 0; y < halfHeight; y++) {
+        for (uint32_t x = 0; x < halfWidth; x++) {
+            float sum[4] = {};
+            for (uint32_t i = 0; i < 4; i++) {
+                uint32_t sx = std::min(x * 2 + i % 2, width  - 1);
+                uint32_t sy = std::min(y * 2 + i / 2, height - 1);
+                const uint8_t* texel = rgba.data() + (sy * width + sx) * 4;
+                for (int c = 0; c < 4; c++) {
+                    float value = texel[c] / 255.f;
+                    if      (kind == KindColor  && c < 3) value = SrgbToLinear(value);
+                    else if (kind == KindNormal && c < 3) value = value * 2.f - 1.f;
+                    sum[c] += value / 4.f;
+                }
+            }
+            if (kind == KindNormal) {
+                float length = std::sqrt(sum[0] * sum[0] + sum[1] * sum[1] + sum[2] * sum[2]);
+                for (int c = 0; c < 3; c++) sum[c] = (length > 1e-6f ? sum[c] / length : 0.f) * 0.5f + 0.5f;
+            }
+            if (kind == KindColor)
+                for (int c = 0; c < 3; c++) sum[c] = LinearToSrgb(sum[c]);
+
+            uint8_t* output = result.data() + (y * halfWidth + x) * 4;
+            for (int c = 0; c < 4; c++) output[c] = uint8_t(std::lround(std::min(std::max(sum[c], 0.f), 1.f) * 255.f));
+        }
+    }
+    return result;
+}
@@ -0,0 +1,21 @@
+//  Copyright © 2021 Subph. All rights reserved.
+//
+
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+// Blocks are 4x4 texels in row order; inputs are 8-bit
+void EncodeBC4Block(const uint8_t values[16], uint8_t output[8]);
+void EncodeBC5Block(const uint8_t red[16], const uint8_t green[16], uint8_t output[16]);
+void EncodeBC7Block(const uint8_t rgba[64], uint8_t output[16]);
+
+// Packed maps hold unrelated linear channels (e.g. ORM), so they are BC7 encoded and box filtered as is
+enum TextureKind { KindColor = 0, KindNormal = 1, KindMask = 2, KindPacked = 3 };
+
+// Encodes a whole RGBA8 level, clamping the edge blocks of sizes that are not multiples of 4
+std::vector<uint8_t> EncodeLevel(const std::vector<uint8_t>& rgba, uint32_t width, uint32_t height, TextureKind kind);
+
+// 2x2 box filter: sRGB colors are averaged in linear space, normals renormalized
+std::vector<uint8_t> DownsampleLevel(const std::vector<uint8_t>& rgba, uint32_t width, uint32_t height, TextureKind kind);
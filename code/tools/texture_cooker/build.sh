@@ -0,0 +1,9 @@
+cd "$(dirname "$0")"
+clang++ -std=c++17 -O2 -I"$VULKAN_SDK/include" \
+    main.cpp bc_encoder.cpp ../../resources/ktx2.cpp ../../libraries/stb_image/stb_image.cpp \
+    -o ../../../texture_cooker
+
+# ../../../texture_cooker textures/pbr/*/*_albedo.png textures/pbr/*/*_normal.png
+# for map in textures/pbr/*/*_ao.png; do
+#     ../../../texture_cooker --orm "$map" "${map%_ao.png}_roughness.png" "${map%_ao.png}_metallic.png"
+# done
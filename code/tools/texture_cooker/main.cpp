@@ -0,0 +1,143 @@
+//  Copyright © 2021 Subph. All rights reserved.
+//
+//  Cooks PBR maps into block compressed KTX2 files with full mip chains.
+//  usage: texture_cooker <map.png>...
+//         texture_cooker --orm <ao.png> <roughness.png> <metallic.png>
+//  Writes <map>.ktx2 next to each input; the kind comes from the file suffix:
+//  _albedo -> BC7 sRGB, _normal -> BC5, _ao/_metallic/_roughness -> BC4.
+//  --orm packs the red channel of the three maps into R, G, B of one BC7 <base>_orm.ktx2.
+
+#include <iostream>
+#include <string>
+#include <chrono>
+
+#include "../../libraries/stb_image/stb_image.h"
+#include "../../resources/ktx2.h"
+#include "bc_encoder.h"
+
+static bool EndsWith(const std::string& text, const std::string& suffix) {
+    return text.size() >= suffix.size() && text.compare(text.size() - suffix.size(), suffix.size(), suffix) == 0;
+}
+
+static bool GetKind(const std::string& stem, TextureKind* kind, VkFormat* format) {
+    if (EndsWith(stem, "_albedo")) { *kind = KindColor ; *format = VK_FORMAT_BC7_SRGB_BLOCK ; return true; }
+    if (EndsWith(stem, "_normal")) { *kind = KindNormal; *format = VK_FORMAT_BC5_UNORM_BLOCK; return true; }
+    if (EndsWith(stem, "_ao") || EndsWith(stem, "_metallic") || EndsWith(stem, "_roughness")) {
+        *kind = KindMask; *format = VK_FORMAT_BC4_UNORM_BLOCK; return true;
+    }
+    return false;
+}
+
+static bool LoadLevel(const std::string& path, std::vector<uint8_t>* level, int* width, int* height) {
+    int channels;
+    unsigned char* pixels = stbi_load(path.c_str(), width, height, &channels, STBI_rgb_alpha);
+    if (pixels == nullptr) {
+        std::cout << "failed to load image " << path << std::endl;
+        return false;
+    }
+    level->assign(pixels, pixels + *width * *height * 4);
+    stbi_image_free(pixels);
+    return true;
+}
+
+static void CookLevels(std::vector<uint8_t> level, int width, int height, TextureKind kind, VkFormat format,
+                       const std::string& output, uint64_t* sourceBytes, uint64_t* cookedBytes) {
+    auto start = std::chrono::high_resolution_clock::now();
+    Ktx2Image image;
+    image.format = format;
+    image.width  = uint32_t(width);
+    image.height = uint32_t(height);
+
+    uint32_t levelWidth = image.width, levelHeight = image.height;
+    uint64_t rgbaBytes  = 0;
+    while (true) {
+        std::vector<uint8_t> encoded = EncodeLevel(level, levelWidth, levelHeight, kind);
+        image.levels.push_back({ image.data.size(), encoded.size() });
+        image.data.insert(image.data.end(), encoded.begin(), encoded.end());
+        rgbaBytes += level.size();
+        if (levelWidth == 1 && levelHeight == 1) break;
+
+        level       = DownsampleLevel(level, levelWidth, levelHeight, kind);
+        levelWidth  = std::max(levelWidth  / 2, 1u);
+        levelHeight = std::max(levelHeight / 2, 1u);
+    }
+
+    WriteKtx2(output, image);
+
+    float seconds = std::chrono::duration<float>(std::chrono::high_resolution_clock::now() - start).count();
+    std::cout << output << ": " << width << "x" << height << ", " << image.levels.size() << " levels, "
+              << rgbaBytes / 1024 << "KB -> " << image.data.size() / 1024 << "KB ("
+              << float(rgbaBytes) / float(image.data.size()) << "x) in " << seconds << "s" << std::endl;
+
+    *sourceBytes += rgbaBytes;
+    *cookedBytes += image.data.size();
+}
+
+static bool CookTexture(const std::string& path, uint64_t* sourceBytes, uint64_t* cookedBytes) {
+    std::string stem = path.substr(0, path.find_last_of('.'));
+    TextureKind kind;
+    VkFormat    format;
+    if (!GetKind(stem, &kind, &format)) {
+        std::cout << "skipping " << path << ": unknown map suffix" << std::endl;
+        return false;
+    }
+
+    int width, height;
+    std::vector<uint8_t> level;
+    if (!LoadLevel(path, &level, &width, &height)) return false;
+    CookLevels(level, width, height, kind, format, stem + ".ktx2", sourceBytes, cookedBytes);
+    return true;
+}
+
+// The output is named after the first map with its suffix swapped, e.g. rust_ao.png -> rust_orm.ktx2
+static bool CookOrm(const std::string paths[3], uint64_t* sourceBytes, uint64_t* cookedBytes) {
+    int width = 0, height = 0;
+    std::vector<uint8_t> packed;
+    for (int i = 0; i < 3; i++) {
+        int mapWidth, mapHeight;
+        std::vector<uint8_t> level;
+        if (!LoadLevel(paths[i], &level, &mapWidth, &mapHeight)) return false;
+        if (i == 0) {
+            width  = mapWidth;
+            height = mapHeight;
+            packed.assign(level.size(), 255);
+        }
+        if (mapWidth != width || mapHeight != height) {
+            std::cout << "skipping " << paths[i] << ": size differs from " << paths[0] << std::endl;
+            return false;
+        }
+        for (size_t texel = 0; texel < level.size() / 4; texel++) packed[texel * 4 + i] = level[texel * 4];
+    }
+
+    std::string stem = paths[0].substr(0, paths[0].find_last_of('.'));
+    stem = stem.substr(0, stem.find_last_of('_')) + "_orm";
+    CookLevels(packed, width, height, KindPacked, VK_FORMAT_BC7_UNORM_BLOCK, stem + ".ktx2", sourceBytes, cookedBytes);
+    return true;
+}
+
+int main(int argc, char** argv) {
+    if (argc < 2) {
+        std::cout << "usage: texture_cooker <map.png>..." << std::endl;
+        return 1;
+    }
+
+    uint64_t sourceBytes = 0, cookedBytes = 0;
+    int      failures    = 0;
+    if (std::string(argv[1]) == "--orm") {
+        if (argc != 5) {
+            std::cout << "usage: texture_cooker --orm <ao.png> <roughness.png> <metallic.png>" << std::endl;
+            return 1;
+        }
+        const std::string paths[3] = { argv[2], argv[3], argv[4] };
+        failures += !CookOrm(paths, &sourceBytes, &cookedBytes);
+    }
+    else {
+        for (int i = 1; i < argc; i++)
+            failures += !CookTexture(argv[i], &sourceBytes, &cookedBytes);
+    }
+
+    if (cookedBytes > 0)
+        std::cout << "total " << sourceBytes / 1024 << "KB RGBA8 with mips -> " << cookedBytes / 1024
+                  << "KB (" << float(sourceBytes) / float(cookedBytes) << "x)" << std::endl;
+    return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,175 @@
+//  Copyright © 2021 Subph. All rights reserved.
+//
+//  Compares the original vertex dedupe of Mesh::loadModel with WeldVertices on one OBJ, the bunny by default.
+//  usage: weld_bench [model.obj] [runs]
+//  All read the same tiny_obj_loader corners. Prints the unique vertex counts, the best time of each
+//  over the runs, and how many corners the old dedupe mapped to a vertex with other attributes.
+//  WeldVertices must give exactly the vertices and indices of a reference dedupe keyed on the whole
+//  vertex; then WeldVerticesParallel is timed with 1 to 8 pool workers and must match too.
+//  Exits with 1 when any check fails.
+
+#define GLM_ENABLE_EXPERIMENTAL
+
+#include <algorithm>
+#include <iostream>
+#include <string>
+#include <chrono>
+#include <cstring>
+#include <unordered_map>
+
+#include <glm/gtx/hash.hpp>
+
+#include "../../libraries/tiny_obj_loader/tiny_obj_loader.h"
+#include "../../mesh/vertex_weld.h"
+#include "../../thread_pool.h"
+
+struct Vertex {
+    glm::vec3 position;
+    glm::vec3 normal;
+    glm::vec2 texCoord;
+};
+
+typedef std::chrono::high_resolution_clock Clock;
+
+static float MillisecondsSince(Clock::time_point start) {
+    return std::chrono::duration<float>(Clock::now() - start).count() * 1000.f;
+}
+
+static bool LoadCorners(const std::string& path, std::vector<Vertex>* corners) {
+    tinyobj::attrib_t attrib;
+    std::vector<tinyobj::shape_t> shapes;
+    std::vector<tinyobj::material_t> materials;
+    std::string warn, err;
+    if (!tinyobj::LoadObj(&attrib, &shapes, &materials, &warn, &err, path.c_str())) {
+        std::cout << "failed to load " << path << ": " << warn << err << std::endl;
+        return false;
+    }
+    
+    for (const auto& shape : shapes) {
+        for (const auto& index : shape.mesh.indices) {
+            Vertex vertex{};
+            vertex.position = glm::vec3(attrib.vertices[3 * index.vertex_index + 0],
+                                        attrib.vertices[3 * index.vertex_index + 1],
+                                        attrib.vertices[3 * index.vertex_index + 2]);
+            if (index.normal_index >= 0)
+                vertex.normal = glm::vec3(attrib.normals[3 * index.normal_index + 0],
+                                          attrib.normals[3 * index.normal_index + 1],
+                                          attrib.normals[3 * index.normal_index + 2]);
+            if (index.texcoord_index >= 0)
+                vertex.texCoord = glm::vec2(attrib.texcoords[2 * index.texcoord_index + 0],
+                                            1.0f - attrib.texcoords[2 * index.texcoord_index + 1]);
+            corners->push_back(vertex);
+        }
+    }
+    return true;
+}
+
+// The loop Mesh::loadModel used: position and texcoord hashes XORed into one key, so colliding keys
+// and vertices differing only in their normal share a vertex
+static uint32_t DedupeXor(const std::vector<Vertex>& corners, std::vector<Vertex>* vertices,
+                          std::vector<uint32_t>* indices) {
+    std::unordered_map<size_t, uint32_t> uniqueVertices;
+    for (const Vertex& corner : corners) {
+        size_t hash = std::hash<glm::vec3>()(corner.position) ^
+                     (std::hash<glm::vec2>()(corner.texCoord) << 1);
+        if (uniqueVertices.count(hash) == 0) {
+            uniqueVertices[hash] = uint32_t(vertices->size());
+            vertices->push_back(corner);
+        }
+        indices->push_back(uniqueVertices[hash]);
+    }
+    return uint32_t(vertices->size());
+}
+
+// Keyed on every byte of the vertex, so only identical vertices share an index; slow but obviously right
+static void DedupeExact(const std::vector<Vertex>& corners, std::vector<Vertex>* vertices,
+                        std::vector<uint32_t>* indices) {
+    std::unordered_map<std::string, uint32_t> uniqueVertices;
+    for (const Vertex& corner : corners) {
+        std::string key((const char*) &corner, sizeof(Vertex));
+        auto inserted = uniqueVertices.insert({ key, uint32_t(vertices->size()) });
+        if (inserted.second) vertices->push_back(corner);
+        indices->push_back(inserted.first->second);
+    }
+}
+
+// Corners whose welded vertex is not byte for byte the corner itself
+static uint32_t CountMismatches(const std::vector<Vertex>& corners, const std::vector<Vertex>& vertices,
+                                const std::vector<uint32_t>& indices) {
+    uint32_t mismatches = 0;
+    for (size_t i = 0; i < corners.size(); i++)
+        mismatches += indices[i] >= vertices.size() || memcmp(&vertices[indices[i]], &corners[i], sizeof(Vertex)) != 0;
+    return mismatches;
+}
+
+int main(int argc, char** argv) {
+    std::string path = argc > 1 ? argv[1] : "models/bunny/bunny.obj";
+    int         runs = argc > 2 ? std::max(std::stoi(argv[2]), 1) : 5;
+    
+    std::vector<Vertex> corners;
+    if (!LoadCorners(path, &corners)) return 1;
+    uint32_t count = uint32_t(corners.size());
+    std::cout << path << ": " << count << " corners, best of " << runs << " runs" << std::endl;
+    
+    float xorTime = INFINITY, exactTime = INFINITY, weldTime = INFINITY;
+    std::vector<Vertex>   xorVertices, exactVertices, weldVertices;
+    std::vector<uint32_t> xorIndices, exactIndices, weldIndices;
+    for (int run = 0; run < runs; run++) {
+        xorVertices.clear();
+        xorIndices .clear();
+        auto start = Clock::now();
+        DedupeXor(corners, &xorVertices, &xorIndices);
+        xorTime = std::min(xorTime, MillisecondsSince(start));
+        
+        exactVertices.clear();
+        exactIndices .clear();
+        start = Clock::now();
+        DedupeExact(corners, &exactVertices, &exactIndices);
+        exactTime = std::min(exactTime, MillisecondsSince(start));
+        
+        start = Clock::now();
+        weldIndices.assign(count, 0);
+        std::vector<uint32_t> uniqueCorners = WeldVertices(corners.data(), count, sizeof(Vertex), weldIndices.data());
+        weldTime = std::min(weldTime, MillisecondsSince(start));
+        
+        weldVertices.clear();
+        for (uint32_t corner : uniqueCorners) weldVertices.push_back(corners[corner]);
+    }
+    
+    uint32_t xorMismatches  = CountMismatches(corners, xorVertices,  xorIndices);
+    uint32_t weldMismatches = CountMismatches(corners, weldVertices, weldIndices);
+    bool     isWeldMatching = weldIndices == exactIndices && weldVertices.size() == exactVertices.size() &&
+                              memcmp(weldVertices.data(), exactVertices.data(), weldVertices.size() * sizeof(Vertex)) == 0;
+    std::cout << "  xor + unordered_map:  " << xorVertices.size()   << " vertices, " << xorTime   << " ms, "
+              << xorMismatches  << " corners changed" << std::endl;
+    std::cout << "  exact unordered_map:  " << exactVertices.size() << " vertices, " << exactTime << " ms" << std::endl;
+    std::cout << "  WeldVertices:         " << weldVertices.size()  << " vertices, " << weldTime  << " ms, "
+              << weldMismatches << " corners changed, "
+              << (isWeldMatching ? "matches" : "DIFFERS from") << " the exact dedupe" << std::endl;
+    std::cout << "  speedup " << (weldTime > 0.f ? xorTime / weldTime : 0.f) << "x over xor, "
+              << (weldTime > 0.f ? exactTime / weldTime : 0.f) << "x over exact" << std::endl;
+    
+    // The waiting caller runs tasks too, so n workers weld on up to n + 1 threads
+    bool isParallelMatching = true;
+    for (uint32_t workerCount = 1; workerCount <= 8; workerCount *= 2) {
+        ThreadPool threadPool;
+        threadPool.setup(workerCount);
+        threadPool.create();
+        
+        float parallelTime = INFINITY;
+        std::vector<uint32_t> parallelIndices(count), uniqueCorners;
+        for (int run = 0; run < runs; run++) {
+            auto start = Clock::now();
+            uniqueCorners = WeldVerticesParallel(&threadPool, corners.data(), count, sizeof(Vertex), parallelIndices.data());
+            parallelTime = std::min(parallelTime, MillisecondsSince(start));
+        }
+        threadPool.cleanup();
+        
+        bool isMatching = parallelIndices == weldIndices && uniqueCorners.size() == weldVertices.size();
+        isParallelMatching &= isMatching;
+        std::cout << "  WeldVerticesParallel, " << workerCount << " workers: " << parallelTime << " ms, "
+                  << (parallelTime > 0.f ? weldTime / parallelTime : 0.f) << "x"
+                  << (isMatching ? "" : ", DIFFERS from WeldVertices") << std::endl;
+    }
+    return weldMismatches == 0 && isWeldMatching && isParallelMatching ? 0 : 1;
+}
@@ -11,6 +11,7 @@ Settings::Settings() { }
 void Settings::cleanup() { m_cleaner.flush(); }
 
 void Settings::setWindow(Window* window) { m_pWindow = window; }
+void Settings::setTextureSets(TextureSetCache* pTextureSets) { m_pTextureSets = pTextureSets; }
 
 void Settings::initGUI(VkRenderPass renderPass) {
     LOG("Settings::init");
@@ -118,9 +119,65 @@ void Settings::drawStatusWindow() {
     
     ImGui::Checkbox("Show ImGUI demo", &ShowDemo);
     
+    drawTextureStatus();
+    drawMemoryStatus();
+    
     ImGui::End();
 }
 
+void Settings::drawMemoryStatus() {
+    Allocator* allocator = System::Allocator();
+    if (allocator == nullptr || !ImGui::CollapsingHeader("Memory")) return;
+    
+    ImGui::Text("Budget source: %s", allocator->hasMemoryBudget() ? "VK_EXT_memory_budget" : "estimate");
+    
+    std::vector<Allocator::HeapBudget> budgets = allocator->getHeapBudgets();
+    for (uint32_t i = 0; i < budgets.size(); i++) {
+        const Allocator::HeapBudget& budget = budgets[i];
+        float fraction = budget.budget == 0 ? 0.f : float(budget.usage) / float(budget.budget);
+        std::string usage = Allocator::GetSizeString(budget.usage) + " / " + Allocator::GetSizeString(budget.budget);
+        ImGui::Text("Heap %u%s (ours %s)", i, budget.isDeviceLocal ? " DeviceLocal" : "",
+                    Allocator::GetSizeString(budget.allocated).c_str());
+        ImGui::ProgressBar(fraction, ImVec2(-1, 0), usage.c_str());
+    }
+    
+    for (uint32_t i = 0; i < Allocator::CategoryCount; i++) {
+        Allocator::Category      category = Allocator::Category(i);
+        Allocator::CategoryStats stats    = allocator->getCategoryStats(category);
+        if (stats.peak == 0) continue;
+        ImGui::Text("%-10s %4u  %10s  (peak %s)", Allocator::GetCategoryName(category), stats.count,
+                    Allocator::GetSizeString(stats.size).c_str(), Allocator::GetSizeString(stats.peak).c_str());
+    }
+}
+
+void Settings::drawTextureStatus() {
+    TextureSetCache* pTextureSets = m_pTextureSets;
+    if (pTextureSets == nullptr || !ImGui::CollapsingHeader("Textures")) return;
+    
+    std::vector<std::string> names = pTextureSets->getNames();
+    if (TextureSetLocked) ImGui::Text("Texture Set: %s (fixed by the virtual albedo)", names[TextureSet].c_str());
+    else if (ImGui::BeginCombo("Texture Set", names[TextureSet].c_str())) {
+        for (uint i = 0; i < names.size(); i++) {
+            if (ImGui::Selectable(names[i].c_str(), int(i) == TextureSet)) TextureSet = int(i);
+        }
+        ImGui::EndCombo();
+    }
+    ImGui::SliderInt("Budget (MB)", &TextureBudgetMB, 16, 2048);
+    
+    VkDeviceSize cached   = pTextureSets->getCachedSize();
+    VkDeviceSize budget   = pTextureSets->getBudget();
+    float        fraction = budget == 0 ? 0.f : std::min(float(cached) / float(budget), 1.f);
+    std::string  usage    = Allocator::GetSizeString(cached) + " / " + Allocator::GetSizeString(budget);
+    ImGui::ProgressBar(fraction, ImVec2(-1, 0), usage.c_str());
+    
+    // Most recently used first, so eviction works up from the bottom
+    const char* stateNames[] = { "decoding", "uploading", "resident" };
+    for (TextureSetCache::SetStatus status : pTextureSets->getStatus()) {
+        ImGui::Text("%-26s %-9s %10s", names[status.index].c_str(), stateNames[status.state],
+                    Allocator::GetSizeString(status.size).c_str());
+    }
+}
+
 void Settings::renderGUI(VkCommandBuffer commandBuffer) {
     ImGui_ImplVulkan_RenderDrawData(ImGui::GetDrawData(), commandBuffer);
 }
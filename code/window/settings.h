@@ -5,6 +5,7 @@
 
 #include "../common.h"
 #include "window.h"
+#include "../resources/texture_set_cache.h"
 
 #include "../libraries/imgui/imgui.h"
 #include "../libraries/imgui/backends/imgui_impl_glfw.h"
@@ -17,6 +18,10 @@ public:
     bool LockFPS   = false;
     bool LockFocus = false;
     
+    int  TextureSet       = 0;
+    bool TextureSetLocked = false;
+    int  TextureBudgetMB  = TEXTURE_SET_BUDGET_MB;
+    
     float ClearColor[4] = {0.1f, 0.1f, 0.1f, 1.0f};
     float ClearDepth    = 1.0f;
     uint  ClearStencil  = 0;
@@ -30,6 +35,7 @@ public:
     void initGUI(VkRenderPass renderPass);
     
     void setWindow(Window* window);
+    void setTextureSets(TextureSetCache* pTextureSets);
     
     void drawGUI();
     void renderGUI(VkCommandBuffer commandBuffer);
@@ -38,9 +44,12 @@ private:
     
     Cleaner m_cleaner;
     Window* m_pWindow;
+    TextureSetCache* m_pTextureSets = nullptr;
     
 
     VkDescriptorPool m_imguiPool;
     
     void drawStatusWindow();
+    void drawMemoryStatus();
+    void drawTextureStatus();
 };